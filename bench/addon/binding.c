@@ -0,0 +1,1460 @@
+// Measure typed functions called through the trampoline against their untyped
+// callback.
+#define JS_TYPED_FUNCTION_TRAMPOLINE
+
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+/**
+ * Each case pairs an operation implemented with the shim against the same
+ * operation implemented with Node-API directly. Both run the same loop, with
+ * a handle scope per iteration, over the same fixture. Cases over the elements
+ * of an array take the number of elements as a parameter.
+ */
+
+#define BENCH_RECORDS 10000
+
+typedef struct {
+  js_value_t *number;
+  js_value_t *string;
+  js_value_t *long_string;
+  js_value_t *object;
+  js_value_t *array;
+  js_value_t *arraybuffer;
+  js_value_t *typedarray;
+  js_value_t *function;
+  js_value_t *wrapped;
+  js_value_t *records;
+  js_ref_t *reference;
+  uint32_t len;
+  js_value_t **elements;
+} bench_fixture_t;
+
+typedef void (*bench_op_t)(js_env_t *env, bench_fixture_t *fixture, uint32_t i);
+
+typedef struct {
+  const char *category;
+  const char *name;
+  bench_op_t js;
+  bench_op_t napi;
+  bool elements;
+} bench_case_t;
+
+static int bench_wrapped_data;
+
+static const char bench_ascii[] =
+  "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+  "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+  "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy";
+
+static void
+bench_noop_finalize(js_env_t *env, void *data, void *finalize_hint) {}
+
+static void
+bench_get_fixture(js_env_t *env, js_value_t *input, uint32_t len, bench_fixture_t *fixture) {
+  napi_status status;
+
+#define V(name) \
+  status = napi_get_named_property(env, input, #name, &fixture->name); \
+  assert(status == napi_ok);
+
+  V(number)
+  V(string)
+  V(long_string)
+  V(object)
+  V(arraybuffer)
+  V(typedarray)
+  V(function)
+  V(wrapped)
+  V(records)
+#undef V
+
+  status = napi_wrap(env, fixture->wrapped, &bench_wrapped_data, NULL, NULL, NULL);
+  assert(status == napi_ok);
+
+  status = napi_create_reference(env, fixture->object, 1, &fixture->reference);
+  assert(status == napi_ok);
+
+  fixture->len = len;
+  fixture->elements = malloc(sizeof(js_value_t *) * (len ? len : 1));
+  assert(fixture->elements);
+
+  status = napi_create_array_with_length(env, len, &fixture->array);
+  assert(status == napi_ok);
+
+  for (uint32_t i = 0; i < len; i++) {
+    status = napi_create_uint32(env, i, &fixture->elements[i]);
+    assert(status == napi_ok);
+
+    status = napi_set_element(env, fixture->array, i, fixture->elements[i]);
+    assert(status == napi_ok);
+  }
+}
+
+static void
+bench_release_fixture(js_env_t *env, bench_fixture_t *fixture) {
+  napi_status status;
+
+  status = napi_remove_wrap(env, fixture->wrapped, NULL);
+  assert(status == napi_ok);
+
+  status = napi_delete_reference(env, fixture->reference);
+  assert(status == napi_ok);
+
+  free(fixture->elements);
+}
+
+static js_value_t *
+bench_run(js_env_t *env, js_callback_info_t *info) {
+  napi_status status;
+
+  size_t argc = 3;
+  js_value_t *argv[3];
+
+  bench_op_t *op;
+
+  status = napi_get_cb_info(env, info, &argc, argv, NULL, (void **) &op);
+  assert(status == napi_ok);
+
+  assert(argc >= 2);
+
+  uint32_t iterations;
+  status = napi_get_value_uint32(env, argv[1], &iterations);
+  assert(status == napi_ok);
+
+  uint32_t len = 0;
+
+  if (argc > 2) {
+    status = napi_get_value_uint32(env, argv[2], &len);
+    assert(status == napi_ok);
+  }
+
+  bench_fixture_t *fixture = malloc(sizeof(bench_fixture_t));
+  assert(fixture);
+
+  bench_get_fixture(env, argv[0], len, fixture);
+
+  // Only time the loop, as setting up a large array can take longer than
+  // running the operation over it.
+  uint64_t start = uv_hrtime();
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+    assert(status == napi_ok);
+
+    (*op)(env, fixture, i);
+
+    status = napi_close_handle_scope(env, scope);
+    assert(status == napi_ok);
+  }
+
+  uint64_t elapsed = uv_hrtime() - start;
+
+  bench_release_fixture(env, fixture);
+
+  free(fixture);
+
+  napi_value result;
+  status = napi_create_double(env, (double) elapsed, &result);
+  assert(status == napi_ok);
+
+  return result;
+}
+
+// Value creation
+
+static void
+bench_js_create_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_int32(env, (int32_t) i, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_int32(env, (int32_t) i, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_double(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_double(env, i * 0.5, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_double(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_double(env, i * 0.5, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_string_utf8(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_string_utf8(env, (const utf8_t *) "hello world", 11, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_string_utf8(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_string_utf8(env, "hello world", 11, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_string_utf8_256(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_string_utf8(env, (const utf8_t *) bench_ascii, sizeof(bench_ascii) - 1, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_string_utf8_256(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_string_utf8(env, bench_ascii, sizeof(bench_ascii) - 1, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_object(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_object(env, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_object(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_object(env, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_array(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_create_array_with_length(env, 16, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_array(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_array_with_length(env, 16, &result);
+  assert(status == napi_ok);
+}
+
+// Conversion
+
+static void
+bench_js_get_value_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int32_t result;
+  int err = js_get_value_int32(env, fixture->number, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_value_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int32_t result;
+  napi_status status = napi_get_value_int32(env, fixture->number, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_get_value_double(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  double result;
+  int err = js_get_value_double(env, fixture->number, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_value_double(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  double result;
+  napi_status status = napi_get_value_double(env, fixture->number, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_get_value_string_utf8(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  utf8_t buffer[64];
+  size_t len;
+  int err = js_get_value_string_utf8(env, fixture->string, buffer, sizeof(buffer), &len);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_value_string_utf8(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  char buffer[64];
+  size_t len;
+  napi_status status = napi_get_value_string_utf8(env, fixture->string, buffer, sizeof(buffer), &len);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_typeof(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_type_t result;
+  int err = js_typeof(env, fixture->object, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_typeof(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_valuetype result;
+  napi_status status = napi_typeof(env, fixture->object, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_is_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bool result;
+  int err = js_is_int32(env, fixture->number, &result);
+  assert(err == 0 && result);
+}
+
+static void
+bench_napi_is_int32(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_valuetype type;
+  napi_status status = napi_typeof(env, fixture->number, &type);
+  assert(status == napi_ok && type == napi_number);
+
+  double number, integral;
+  status = napi_get_value_double(env, fixture->number, &number);
+  assert(status == napi_ok);
+
+  bool result = modf(number, &integral) == 0.0 && integral >= INT32_MIN && integral <= INT32_MAX;
+  assert(result);
+}
+
+static void
+bench_js_is_uint8array(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bool result;
+  int err = js_is_uint8array(env, fixture->typedarray, &result);
+  assert(err == 0 && result);
+}
+
+static void
+bench_napi_is_uint8array(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bool result;
+  napi_status status = napi_is_typedarray(env, fixture->typedarray, &result);
+  assert(status == napi_ok && result);
+
+  napi_typedarray_type type;
+  status = napi_get_typedarray_info(env, fixture->typedarray, &type, NULL, NULL, NULL, NULL);
+  assert(status == napi_ok && type == napi_uint8_array);
+}
+
+static void
+bench_js_classify_value(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_classification_t result = {0};
+  int err = js_classify_value(env, fixture->typedarray, &result);
+  assert(err == 0 && result.kind == js_kind_uint8array);
+}
+
+static void
+bench_napi_classify_value(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_valuetype type;
+  napi_status status = napi_typeof(env, fixture->typedarray, &type);
+  assert(status == napi_ok && type == napi_object);
+
+  bool result;
+  status = napi_is_typedarray(env, fixture->typedarray, &result);
+  assert(status == napi_ok && result);
+
+  napi_typedarray_type typedarray_type;
+  void *data;
+  size_t len;
+  status = napi_get_typedarray_info(env, fixture->typedarray, &typedarray_type, &len, &data, NULL, NULL);
+  assert(status == napi_ok && typedarray_type == napi_uint8_array);
+}
+
+// Property access
+
+static void
+bench_js_get_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_get_named_property(env, fixture->object, "width", &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_get_named_property(env, fixture->object, "width", &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_set_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int err = js_set_named_property(env, fixture->object, "depth", fixture->number);
+  assert(err == 0);
+}
+
+static void
+bench_napi_set_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_status status = napi_set_named_property(env, fixture->object, "depth", fixture->number);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_has_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bool result;
+  int err = js_has_named_property(env, fixture->object, "format", &result);
+  assert(err == 0 && result);
+}
+
+static void
+bench_napi_has_named_property(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bool result;
+  napi_status status = napi_has_named_property(env, fixture->object, "format", &result);
+  assert(status == napi_ok && result);
+}
+
+static void
+bench_js_get_element(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_get_element(env, fixture->array, i % fixture->len, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_element(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_get_element(env, fixture->array, i % fixture->len, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_set_array_elements(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int err = js_set_array_elements(env, fixture->array, (const js_value_t **) fixture->elements, fixture->len, 0);
+  assert(err == 0);
+}
+
+static void
+bench_napi_set_array_elements(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  for (uint32_t j = 0; j < fixture->len; j++) {
+    napi_status status = napi_set_element(env, fixture->array, j, fixture->elements[j]);
+    assert(status == napi_ok);
+  }
+}
+
+// String views
+
+static void
+bench_js_get_string_view(js_env_t *env, js_value_t *string) {
+  js_string_encoding_t encoding;
+  const void *str;
+  size_t len;
+  js_string_view_t *view;
+  int err = js_get_string_view(env, string, &encoding, &str, &len, &view);
+  assert(err == 0);
+
+  err = js_release_string_view(env, view);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_string_view(js_env_t *env, js_value_t *string) {
+  size_t len;
+  napi_status status = napi_get_value_string_utf16(env, string, NULL, 0, &len);
+  assert(status == napi_ok);
+
+  char16_t *str = malloc((len + 1) * sizeof(char16_t));
+  assert(str);
+
+  status = napi_get_value_string_utf16(env, string, str, len + 1, &len);
+  assert(status == napi_ok);
+
+  free(str);
+}
+
+static void
+bench_js_string_view(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_get_string_view(env, fixture->string);
+}
+
+static void
+bench_napi_string_view(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_get_string_view(env, fixture->string);
+}
+
+static void
+bench_js_string_view_4k(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_get_string_view(env, fixture->long_string);
+}
+
+static void
+bench_napi_string_view_4k(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_get_string_view(env, fixture->long_string);
+}
+
+// Typed arrays
+
+static void
+bench_js_get_typedarray_info(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_typedarray_type_t type;
+  void *data;
+  size_t len;
+  int err = js_get_typedarray_info(env, fixture->typedarray, &type, &data, &len, NULL, NULL);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_typedarray_info(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_typedarray_type type;
+  void *data;
+  size_t len;
+  napi_status status = napi_get_typedarray_info(env, fixture->typedarray, &type, &len, &data, NULL, NULL);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_get_arraybuffer_info(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  size_t len;
+  int err = js_get_arraybuffer_info(env, fixture->arraybuffer, &data, &len);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_arraybuffer_info(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  size_t len;
+  napi_status status = napi_get_arraybuffer_info(env, fixture->arraybuffer, &data, &len);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_typedarray(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  js_value_t *arraybuffer;
+  int err = js_create_arraybuffer(env, 64, &data, &arraybuffer);
+  assert(err == 0);
+
+  js_value_t *result;
+  err = js_create_typedarray(env, js_uint8array, 64, arraybuffer, 0, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_typedarray(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  napi_value arraybuffer;
+  napi_status status = napi_create_arraybuffer(env, 64, &data, &arraybuffer);
+  assert(status == napi_ok);
+
+  napi_value result;
+  status = napi_create_typedarray(env, napi_uint8_array, 64, arraybuffer, 0, &result);
+  assert(status == napi_ok);
+}
+
+// Network framing allocates a lot of small buffers that are filled right away,
+// and occasionally a large one.
+
+static void
+bench_js_create_unsafe_arraybuffer_64k(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  js_value_t *arraybuffer;
+  int err = js_create_unsafe_arraybuffer(env, 65536, &data, &arraybuffer);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_unsafe_arraybuffer_64k(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  napi_value arraybuffer;
+  napi_status status = napi_create_arraybuffer(env, 65536, &data, &arraybuffer);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_pooled_typedarray(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *data;
+  js_value_t *result;
+  int err = js_create_pooled_typedarray(env, js_uint8array, 64, &data, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_pooled_typedarray(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_create_typedarray(env, fixture, i);
+}
+
+// Calls
+
+static void
+bench_js_call_function(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_call_function(env, fixture->object, fixture->function, 1, &fixture->number, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_call_function(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_call_function(env, fixture->object, fixture->function, 1, &fixture->number, &result);
+  assert(status == napi_ok);
+}
+
+// References
+
+static void
+bench_js_get_reference_value(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_get_reference_value(env, fixture->reference, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_reference_value(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_get_reference_value(env, fixture->reference, &result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_create_reference(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_ref_t *reference;
+  int err = js_create_reference(env, fixture->object, 1, &reference);
+  assert(err == 0);
+
+  err = js_delete_reference(env, reference);
+  assert(err == 0);
+}
+
+static void
+bench_napi_create_reference(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_ref reference;
+  napi_status status = napi_create_reference(env, fixture->object, 1, &reference);
+  assert(status == napi_ok);
+
+  status = napi_delete_reference(env, reference);
+  assert(status == napi_ok);
+}
+
+// Wrapping
+
+static void
+bench_js_unwrap(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *result;
+  int err = js_unwrap(env, fixture->wrapped, &result);
+  assert(err == 0 && result == &bench_wrapped_data);
+}
+
+static void
+bench_napi_unwrap(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  void *result;
+  napi_status status = napi_unwrap(env, fixture->wrapped, &result);
+  assert(status == napi_ok && result == &bench_wrapped_data);
+}
+
+static void
+bench_js_wrap(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *object;
+  int err = js_create_object(env, &object);
+  assert(err == 0);
+
+  err = js_wrap(env, object, &bench_wrapped_data, bench_noop_finalize, NULL, NULL);
+  assert(err == 0);
+
+  void *result;
+  err = js_remove_wrap(env, object, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_wrap(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value object;
+  napi_status status = napi_create_object(env, &object);
+  assert(status == napi_ok);
+
+  status = napi_wrap(env, object, &bench_wrapped_data, bench_noop_finalize, NULL, NULL);
+  assert(status == napi_ok);
+
+  void *result;
+  status = napi_remove_wrap(env, object, &result);
+  assert(status == napi_ok);
+}
+
+// Records
+
+#define BENCH_RECORD_FIELDS(V) \
+  V(a0, double, js_float64) \
+  V(a1, double, js_float64) \
+  V(a2, double, js_float64) \
+  V(a3, double, js_float64) \
+  V(a4, double, js_float64) \
+  V(a5, double, js_float64) \
+  V(a6, double, js_float64) \
+  V(a7, double, js_float64) \
+  V(a8, double, js_float64) \
+  V(a9, double, js_float64) \
+  V(u0, uint32_t, js_uint32) \
+  V(u1, uint32_t, js_uint32) \
+  V(u2, uint32_t, js_uint32) \
+  V(u3, uint32_t, js_uint32) \
+  V(u4, uint32_t, js_uint32) \
+  V(i0, int32_t, js_int32) \
+  V(i1, int32_t, js_int32) \
+  V(i2, int32_t, js_int32) \
+  V(b0, bool, js_boolean) \
+  V(b1, bool, js_boolean)
+
+typedef struct {
+#define V(name, type, js_type) type name;
+  BENCH_RECORD_FIELDS(V)
+#undef V
+} bench_record_t;
+
+static const js_schema_field_t bench_record_fields[] = {
+#define V(name, type, js_type) JS_SCHEMA_FIELD(bench_record_t, name, js_type),
+  BENCH_RECORD_FIELDS(V)
+#undef V
+};
+
+static const js_schema_t bench_record_schema = JS_SCHEMA(bench_record_t, bench_record_fields);
+
+static bench_record_t bench_records[BENCH_RECORDS];
+
+static void
+bench_napi_create_field_double(js_env_t *env, double value, napi_value *result) {
+  napi_status status = napi_create_double(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_create_field_uint32_t(js_env_t *env, uint32_t value, napi_value *result) {
+  napi_status status = napi_create_uint32(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_create_field_int32_t(js_env_t *env, int32_t value, napi_value *result) {
+  napi_status status = napi_create_int32(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_create_field_bool(js_env_t *env, bool value, napi_value *result) {
+  napi_status status = napi_get_boolean(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_js_encode_records(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  js_value_t *result;
+  int err = js_encode_records(env, &bench_record_schema, bench_records, BENCH_RECORDS, &result);
+  assert(err == 0);
+}
+
+static void
+bench_napi_encode_records(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value result;
+  napi_status status = napi_create_array_with_length(env, BENCH_RECORDS, &result);
+  assert(status == napi_ok);
+
+  for (uint32_t j = 0; j < BENCH_RECORDS; j++) {
+    const bench_record_t *record = &bench_records[j];
+
+    napi_value object, value;
+    status = napi_create_object(env, &object);
+    assert(status == napi_ok);
+
+#define V(name, type, js_type) \
+  bench_napi_create_field_##type(env, record->name, &value); \
+  status = napi_set_named_property(env, object, #name, value); \
+  assert(status == napi_ok);
+
+    BENCH_RECORD_FIELDS(V)
+#undef V
+
+    status = napi_set_element(env, result, j, object);
+    assert(status == napi_ok);
+  }
+}
+
+static void
+bench_js_decode_records(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int err = js_decode_records(env, &bench_record_schema, fixture->records, bench_records, BENCH_RECORDS);
+  assert(err == 0);
+}
+
+static void
+bench_napi_get_field_double(js_env_t *env, napi_value value, double *result) {
+  napi_status status = napi_get_value_double(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_get_field_uint32_t(js_env_t *env, napi_value value, uint32_t *result) {
+  napi_status status = napi_get_value_uint32(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_get_field_int32_t(js_env_t *env, napi_value value, int32_t *result) {
+  napi_status status = napi_get_value_int32(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_get_field_bool(js_env_t *env, napi_value value, bool *result) {
+  napi_status status = napi_get_value_bool(env, value, result);
+  assert(status == napi_ok);
+}
+
+static void
+bench_napi_decode_records(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  for (uint32_t j = 0; j < BENCH_RECORDS; j++) {
+    bench_record_t *record = &bench_records[j];
+
+    napi_handle_scope scope;
+    napi_status status = napi_open_handle_scope(env, &scope);
+    assert(status == napi_ok);
+
+    napi_value object, value;
+    status = napi_get_element(env, fixture->records, j, &object);
+    assert(status == napi_ok);
+
+#define V(name, type, js_type) \
+  status = napi_get_named_property(env, object, #name, &value); \
+  assert(status == napi_ok); \
+  bench_napi_get_field_##type(env, value, &record->name);
+
+    BENCH_RECORD_FIELDS(V)
+#undef V
+
+    status = napi_close_handle_scope(env, scope);
+    assert(status == napi_ok);
+  }
+}
+
+// JSON
+
+static void
+bench_js_build_objects(js_env_t *env, uint32_t len) {
+  int err = 0;
+
+  js_json_writer_t writer;
+  js_json_writer_init(&writer);
+
+  err |= js_json_write_begin_array(&writer);
+
+  for (uint32_t j = 0; j < len; j++) {
+    err |= js_json_write_begin_object(&writer);
+    err |= js_json_write_key(&writer, (const utf8_t *) "id", 2);
+    err |= js_json_write_int64(&writer, j);
+    err |= js_json_write_key(&writer, (const utf8_t *) "name", 4);
+    err |= js_json_write_string_utf8(&writer, (const utf8_t *) "item", 4);
+    err |= js_json_write_key(&writer, (const utf8_t *) "score", 5);
+    err |= js_json_write_double(&writer, j * 0.5);
+    err |= js_json_write_key(&writer, (const utf8_t *) "active", 6);
+    err |= js_json_write_bool(&writer, j % 2 == 0);
+    err |= js_json_write_end_object(&writer);
+  }
+
+  err |= js_json_write_end_array(&writer);
+  assert(err == 0);
+
+  js_value_t *result;
+  err = js_parse_json_writer(env, &writer, &result);
+  assert(err == 0);
+
+  js_json_writer_destroy(&writer);
+}
+
+static void
+bench_napi_build_objects(js_env_t *env, uint32_t len) {
+  napi_value result;
+  napi_status status = napi_create_array_with_length(env, len, &result);
+  assert(status == napi_ok);
+
+  for (uint32_t j = 0; j < len; j++) {
+    napi_value object, value;
+    status = napi_create_object(env, &object);
+    assert(status == napi_ok);
+
+    status = napi_create_uint32(env, j, &value);
+    assert(status == napi_ok);
+
+    status = napi_set_named_property(env, object, "id", value);
+    assert(status == napi_ok);
+
+    status = napi_create_string_utf8(env, "item", 4, &value);
+    assert(status == napi_ok);
+
+    status = napi_set_named_property(env, object, "name", value);
+    assert(status == napi_ok);
+
+    status = napi_create_double(env, j * 0.5, &value);
+    assert(status == napi_ok);
+
+    status = napi_set_named_property(env, object, "score", value);
+    assert(status == napi_ok);
+
+    status = napi_get_boolean(env, j % 2 == 0, &value);
+    assert(status == napi_ok);
+
+    status = napi_set_named_property(env, object, "active", value);
+    assert(status == napi_ok);
+
+    status = napi_set_element(env, result, j, object);
+    assert(status == napi_ok);
+  }
+}
+
+static void
+bench_js_build_objects_1(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_build_objects(env, 1);
+}
+
+static void
+bench_napi_build_objects_1(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_build_objects(env, 1);
+}
+
+static void
+bench_js_build_objects_16(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_build_objects(env, 16);
+}
+
+static void
+bench_napi_build_objects_16(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_build_objects(env, 16);
+}
+
+static void
+bench_js_build_objects_256(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_build_objects(env, 256);
+}
+
+static void
+bench_napi_build_objects_256(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_build_objects(env, 256);
+}
+
+static void
+bench_js_build_objects_4096(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_js_build_objects(env, 4096);
+}
+
+static void
+bench_napi_build_objects_4096(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  bench_napi_build_objects(env, 4096);
+}
+
+static void
+bench_js_stringify_json(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  const void *str;
+  size_t len;
+  js_string_view_t *view;
+  int err = js_stringify_json(env, fixture->object, NULL, &str, &len, &view);
+  assert(err == 0);
+
+  err = js_release_string_view(env, view);
+  assert(err == 0);
+}
+
+static void
+bench_napi_stringify_json(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  napi_value global, json, stringify, string;
+  napi_status status = napi_get_global(env, &global);
+  assert(status == napi_ok);
+
+  status = napi_get_named_property(env, global, "JSON", &json);
+  assert(status == napi_ok);
+
+  status = napi_get_named_property(env, json, "stringify", &stringify);
+  assert(status == napi_ok);
+
+  status = napi_call_function(env, json, stringify, 1, &fixture->object, &string);
+  assert(status == napi_ok);
+
+  size_t len;
+  status = napi_get_value_string_utf8(env, string, NULL, 0, &len);
+  assert(status == napi_ok);
+
+  char *str = malloc(len + 1);
+  assert(str);
+
+  status = napi_get_value_string_utf8(env, string, str, len + 1, NULL);
+  assert(status == napi_ok);
+
+  free(str);
+}
+
+// Errors
+
+static void
+bench_js_throw_errorf(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  int err = js_throw_errorf(env, "ERR_INVALID_ARG", "Expected a value between %d and %d, got %u", 0, 255, i);
+  assert(err == 0);
+
+  js_value_t *error;
+  err = js_get_and_clear_last_exception(env, &error);
+  assert(err == 0);
+}
+
+static void
+bench_napi_throw_errorf(js_env_t *env, bench_fixture_t *fixture, uint32_t i) {
+  char message[128];
+  snprintf(message, sizeof(message), "Expected a value between %d and %d, got %u", 0, 255, i);
+
+  napi_status status = napi_throw_error(env, "ERR_INVALID_ARG", message);
+  assert(status == napi_ok);
+
+  napi_value error;
+  status = napi_get_and_clear_last_exception(env, &error);
+  assert(status == napi_ok);
+}
+
+#define BENCH_CASE(category, name) {#category, #name, bench_js_##name, bench_napi_##name, false}
+
+#define BENCH_ELEMENTS_CASE(category, name) {#category, #name, bench_js_##name, bench_napi_##name, true}
+
+static const bench_case_t bench_cases[] = {
+  BENCH_CASE(create, create_int32),
+  BENCH_CASE(create, create_double),
+  BENCH_CASE(create, create_string_utf8),
+  BENCH_CASE(create, create_string_utf8_256),
+  BENCH_CASE(create, create_object),
+  BENCH_CASE(create, create_array),
+  BENCH_CASE(convert, get_value_int32),
+  BENCH_CASE(convert, get_value_double),
+  BENCH_CASE(convert, get_value_string_utf8),
+  BENCH_CASE(convert, typeof),
+  BENCH_CASE(convert, is_int32),
+  BENCH_CASE(convert, is_uint8array),
+  BENCH_CASE(convert, classify_value),
+  BENCH_CASE(property, get_named_property),
+  BENCH_CASE(property, set_named_property),
+  BENCH_CASE(property, has_named_property),
+  BENCH_ELEMENTS_CASE(property, get_element),
+  BENCH_ELEMENTS_CASE(property, set_array_elements),
+  BENCH_CASE(string, string_view),
+  BENCH_CASE(string, string_view_4k),
+  BENCH_CASE(typedarray, get_typedarray_info),
+  BENCH_CASE(typedarray, get_arraybuffer_info),
+  BENCH_CASE(typedarray, create_typedarray),
+  BENCH_CASE(typedarray, create_unsafe_arraybuffer_64k),
+  BENCH_CASE(typedarray, create_pooled_typedarray),
+  BENCH_CASE(call, call_function),
+  BENCH_CASE(reference, get_reference_value),
+  BENCH_CASE(reference, create_reference),
+  BENCH_CASE(wrap, unwrap),
+  BENCH_CASE(wrap, wrap),
+  BENCH_CASE(record, encode_records),
+  BENCH_CASE(record, decode_records),
+  BENCH_CASE(json, build_objects_1),
+  BENCH_CASE(json, build_objects_16),
+  BENCH_CASE(json, build_objects_256),
+  BENCH_CASE(json, build_objects_4096),
+  BENCH_CASE(json, stringify_json),
+  BENCH_CASE(error, throw_errorf),
+};
+
+#undef BENCH_CASE
+
+// Threadsafe functions are measured end to end: a number of producer threads
+// each make a number of calls and the returned promise resolves once the
+// JavaScript thread has received all of them.
+
+#define BENCH_PRODUCERS_MAX 64
+
+typedef enum {
+  bench_threadsafe_napi,
+  bench_threadsafe_js,
+  bench_threadsafe_batched,
+} bench_threadsafe_impl_t;
+
+typedef struct {
+  bench_threadsafe_impl_t impl;
+  js_threadsafe_function_t *function;
+  js_deferred_t *deferred;
+  uint32_t producers;
+  uint32_t calls;
+  uint64_t expected;
+  uint64_t received;
+  uv_thread_t threads[BENCH_PRODUCERS_MAX];
+} bench_threadsafe_t;
+
+static void
+bench_threadsafe_produce(void *data) {
+  bench_threadsafe_t *bench = data;
+
+  for (uint32_t i = 0; i < bench->calls; i++) {
+    if (bench->impl == bench_threadsafe_napi) {
+      napi_status status = napi_call_threadsafe_function(bench->function, bench, napi_tsfn_blocking);
+      assert(status == napi_ok);
+    } else {
+      int err = js_call_threadsafe_function(bench->function, bench, js_threadsafe_function_blocking);
+      assert(err == 0);
+    }
+  }
+
+  if (bench->impl == bench_threadsafe_napi) {
+    napi_release_threadsafe_function(bench->function, napi_tsfn_release);
+  } else {
+    js_release_threadsafe_function(bench->function, js_threadsafe_function_release);
+  }
+}
+
+static void
+bench_threadsafe_receive(js_env_t *env, bench_threadsafe_t *bench, size_t len) {
+  bench->received += len;
+
+  if (bench->received == bench->expected) {
+    js_value_t *result;
+    int err = js_get_undefined(env, &result);
+    assert(err == 0);
+
+    err = js_resolve_deferred(env, bench->deferred, result);
+    assert(err == 0);
+  }
+}
+
+static void
+bench_on_threadsafe_call(js_env_t *env, js_value_t *function, void *context, void *data) {
+  if (env) bench_threadsafe_receive(env, context, 1);
+}
+
+static void
+bench_on_threadsafe_batch(js_env_t *env, js_value_t *function, void *context, void *const data[], size_t len) {
+  if (env) bench_threadsafe_receive(env, context, len);
+}
+
+static void
+bench_on_threadsafe_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  bench_threadsafe_t *bench = finalize_hint;
+
+  for (uint32_t i = 0; i < bench->producers; i++) {
+    uv_thread_join(&bench->threads[i]);
+  }
+
+  free(bench);
+}
+
+static js_value_t *
+bench_threadsafe(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 3;
+  js_value_t *argv[3];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 3);
+
+  bench_threadsafe_t *bench = calloc(1, sizeof(bench_threadsafe_t));
+  assert(bench);
+
+  uint32_t impl;
+  err = js_get_value_uint32(env, argv[0], &impl);
+  assert(err == 0);
+
+  bench->impl = (bench_threadsafe_impl_t) impl;
+
+  err = js_get_value_uint32(env, argv[1], &bench->producers);
+  assert(err == 0);
+
+  assert(bench->producers > 0 && bench->producers <= BENCH_PRODUCERS_MAX);
+
+  err = js_get_value_uint32(env, argv[2], &bench->calls);
+  assert(err == 0);
+
+  bench->expected = (uint64_t) bench->producers * bench->calls;
+
+  js_value_t *promise;
+  err = js_create_promise(env, &bench->deferred, &promise);
+  assert(err == 0);
+
+  js_value_t *name;
+  err = js_create_string_utf8(env, (const utf8_t *) "bench", -1, &name);
+  assert(err == 0);
+
+  switch (bench->impl) {
+  case bench_threadsafe_napi: {
+    napi_status status = napi_create_threadsafe_function(env, NULL, NULL, name, 0, bench->producers, bench, bench_on_threadsafe_finalize, bench, bench_on_threadsafe_call, &bench->function);
+    assert(status == napi_ok);
+    break;
+  }
+
+  case bench_threadsafe_js:
+    err = js_create_threadsafe_function(env, NULL, 0, bench->producers, bench_on_threadsafe_finalize, bench, bench, bench_on_threadsafe_call, &bench->function);
+    assert(err == 0);
+    break;
+
+  case bench_threadsafe_batched:
+    err = js_create_batched_threadsafe_function(env, NULL, 0, bench->producers, bench_on_threadsafe_finalize, bench, bench, bench_on_threadsafe_batch, &bench->function);
+    assert(err == 0);
+    break;
+  }
+
+  for (uint32_t i = 0; i < bench->producers; i++) {
+    err = uv_thread_create(&bench->threads[i], bench_threadsafe_produce, bench);
+    assert(err == 0);
+  }
+
+  return promise;
+}
+
+// Tasks are measured end to end as well: a number of tasks is queued and the
+// returned array of promises is awaited from JavaScript. The Node-API
+// implementation settles every promise from its own completion callback.
+
+typedef struct {
+  napi_async_work work;
+  napi_deferred deferred;
+  uint32_t value;
+} bench_task_t;
+
+static void
+bench_task_execute(napi_env env, void *data) {
+  bench_task_t *task = data;
+
+  task->value++;
+}
+
+static void
+bench_task_complete(napi_env env, napi_status status, void *data) {
+  bench_task_t *task = data;
+
+  napi_value result;
+  status = napi_create_uint32(env, task->value, &result);
+  assert(status == napi_ok);
+
+  status = napi_resolve_deferred(env, task->deferred, result);
+  assert(status == napi_ok);
+
+  status = napi_delete_async_work(env, task->work);
+  assert(status == napi_ok);
+
+  free(task);
+}
+
+static void
+bench_task_work(void *data) {
+  bench_task_t *task = data;
+
+  task->value++;
+}
+
+static js_value_t *
+bench_task_settle(js_env_t *env, bool cancelled, void *data) {
+  bench_task_t *task = data;
+
+  js_value_t *result = NULL;
+
+  if (env) {
+    int err = js_create_uint32(env, task->value, &result);
+    assert(err == 0);
+  }
+
+  free(task);
+
+  return result;
+}
+
+static js_value_t *
+bench_tasks(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  bool use_napi;
+  err = js_get_value_bool(env, argv[0], &use_napi);
+  assert(err == 0);
+
+  uint32_t len;
+  err = js_get_value_uint32(env, argv[1], &len);
+  assert(err == 0);
+
+  js_value_t *promises;
+  err = js_create_array_with_length(env, len, &promises);
+  assert(err == 0);
+
+  js_value_t *name;
+  err = js_create_string_utf8(env, (const utf8_t *) "bench", -1, &name);
+  assert(err == 0);
+
+  for (uint32_t i = 0; i < len; i++) {
+    bench_task_t *task = calloc(1, sizeof(bench_task_t));
+    assert(task);
+
+    task->value = i;
+
+    js_value_t *promise;
+
+    if (use_napi) {
+      napi_status status = napi_create_promise(env, &task->deferred, &promise);
+      assert(status == napi_ok);
+
+      status = napi_create_async_work(env, NULL, name, bench_task_execute, bench_task_complete, task, &task->work);
+      assert(status == napi_ok);
+
+      status = napi_queue_async_work(env, task->work);
+      assert(status == napi_ok);
+    } else {
+      err = js_queue_task(env, bench_task_work, bench_task_settle, task, NULL, &promise);
+      assert(err == 0);
+    }
+
+    err = js_set_element(env, promises, i, promise);
+    assert(err == 0);
+  }
+
+  return promises;
+}
+
+// Typed functions are called from JavaScript, once through the trampoline and
+// once through the untyped callback that's otherwise installed.
+
+static js_value_t *
+bench_typed_add_untyped(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 3;
+  js_value_t *argv[3];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  double a, b;
+  err = js_get_value_double(env, argv[0], &a);
+  if (err < 0) return NULL;
+
+  err = js_get_value_double(env, argv[1], &b);
+  if (err < 0) return NULL;
+
+  js_value_t *result;
+  err = js_create_double(env, a + b, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static double
+bench_typed_add(js_value_t *receiver, double a, double b, js_typed_callback_info_t *info) {
+  return a + b;
+}
+
+static js_value_t *
+bench_typed_functions(js_env_t *env) {
+  int err;
+
+  static int args[] = {js_object, js_float64, js_float64};
+
+  static const js_callback_signature_t signature = {0, js_float64, 3, args};
+
+  js_value_t *result;
+  err = js_create_object(env, &result);
+  assert(err == 0);
+
+  js_value_t *fn;
+  err = js_create_typed_function(env, "add", -1, bench_typed_add_untyped, &signature, (const void *) bench_typed_add, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, result, "typed", fn);
+  assert(err == 0);
+
+  err = js_create_function(env, "add", -1, bench_typed_add_untyped, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, result, "untyped", fn);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+bench_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  size_t len = sizeof(bench_cases) / sizeof(bench_cases[0]);
+
+  js_value_t *cases;
+  err = js_create_array_with_length(env, len, &cases);
+  assert(err == 0);
+
+  for (size_t i = 0; i < len; i++) {
+    const bench_case_t *bench_case = &bench_cases[i];
+
+    js_value_t *entry;
+    err = js_create_object(env, &entry);
+    assert(err == 0);
+
+    js_value_t *value;
+    err = js_create_string_utf8(env, (const utf8_t *) bench_case->category, -1, &value);
+    assert(err == 0);
+
+    err = js_set_named_property(env, entry, "category", value);
+    assert(err == 0);
+
+    err = js_create_string_utf8(env, (const utf8_t *) bench_case->name, -1, &value);
+    assert(err == 0);
+
+    err = js_set_named_property(env, entry, "name", value);
+    assert(err == 0);
+
+    err = js_get_boolean(env, bench_case->elements, &value);
+    assert(err == 0);
+
+    err = js_set_named_property(env, entry, "elements", value);
+    assert(err == 0);
+
+    err = js_create_function(env, bench_case->name, -1, bench_run, (void *) &bench_case->js, &value);
+    assert(err == 0);
+
+    err = js_set_named_property(env, entry, "js", value);
+    assert(err == 0);
+
+    err = js_create_function(env, bench_case->name, -1, bench_run, (void *) &bench_case->napi, &value);
+    assert(err == 0);
+
+    err = js_set_named_property(env, entry, "napi", value);
+    assert(err == 0);
+
+    err = js_set_element(env, cases, i, entry);
+    assert(err == 0);
+  }
+
+  err = js_set_named_property(env, exports, "cases", cases);
+  assert(err == 0);
+
+  js_value_t *threadsafe;
+  err = js_create_function(env, "threadsafe", -1, bench_threadsafe, NULL, &threadsafe);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "threadsafe", threadsafe);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "typedFunctions", bench_typed_functions(env));
+  assert(err == 0);
+
+  js_value_t *tasks;
+  err = js_create_function(env, "tasks", -1, bench_tasks, NULL, &tasks);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "tasks", tasks);
+  assert(err == 0);
+
+  return exports;
+}
+
+BARE_MODULE(bench_addon, bench_exports)
@@ -0,0 +1,155 @@
+// Usage: node index.js <path to bench_addon.node> [filter]
+//
+// Prints one JSON object per line: for each case, the time per operation in
+// nanoseconds of the js_* implementation and of the equivalent direct Node-API
+// implementation, along with the relative overhead of the former.
+
+const path = require('path')
+
+const addon = require(path.resolve(process.argv[2]))
+const filter = new RegExp(process.argv[3] || '')
+
+const fixture = {
+  number: 42,
+  string: 'hello world',
+  long_string: 'x'.repeat(4096),
+  object: { width: 1, height: 2, depth: 3, format: 'rgba' },
+  arraybuffer: new ArrayBuffer(1024),
+  typedarray: new Uint8Array(1024),
+  records: Array.from({ length: 10000 }, (_, i) => ({
+    a0: i,
+    a1: i + 0.1,
+    a2: i + 0.2,
+    a3: i + 0.3,
+    a4: i + 0.4,
+    a5: i + 0.5,
+    a6: i + 0.6,
+    a7: i + 0.7,
+    a8: i + 0.8,
+    a9: i + 0.9,
+    u0: i,
+    u1: i + 1,
+    u2: i + 2,
+    u3: i + 3,
+    u4: i + 4,
+    i0: -i,
+    i1: 1 - i,
+    i2: 2 - i,
+    b0: i % 2 === 0,
+    b1: i % 3 === 0
+  })),
+  function: function (value) {
+    return value
+  },
+  get wrapped() {
+    return {}
+  }
+}
+
+// Cases report the time spent in their loop, leaving out setting up the
+// fixture, while other functions are timed as a whole.
+function measure(fn, minimum = 1e8) {
+  let iterations = 1
+
+  fn(fixture, 1) // Warm up
+
+  while (true) {
+    const start = process.hrtime.bigint()
+    const reported = fn(fixture, iterations)
+    const elapsed = typeof reported === 'number' ? reported : Number(process.hrtime.bigint() - start)
+
+    if (elapsed > minimum) return elapsed / iterations
+
+    iterations *= elapsed < minimum / 16 ? 8 : 2
+  }
+}
+
+function round(value) {
+  return Math.round(value * 100) / 100
+}
+
+for (const { category, name, elements, js, napi } of addon.cases) {
+  if (!filter.test(`${category}/${name}`)) continue
+
+  // Cases over the elements of an array are swept over its length.
+  for (const len of elements ? [10, 1000, 1000000] : [0]) {
+    const run = (fn) => (fixture, iterations) => fn(fixture, iterations, len)
+
+    const result = { category, name: elements ? `${name}_${len}` : name, js: measure(run(js)), napi: measure(run(napi)) }
+
+    result.overhead = round(result.js / result.napi - 1)
+    result.js = round(result.js)
+    result.napi = round(result.napi)
+
+    console.log(JSON.stringify(result))
+  }
+}
+
+// Typed functions are measured from JavaScript, comparing the trampoline with
+// the untyped callback.
+if (filter.test('call/typed_function')) {
+  const { typed, untyped } = addon.typedFunctions
+
+  const call = (fn) => (fixture, iterations) => {
+    for (let i = 0; i < iterations; i++) fn(i, 0.5)
+  }
+
+  const result = { category: 'call', name: 'typed_function', js: measure(call(typed)), napi: measure(call(untyped)) }
+
+  result.overhead = round(result.js / result.napi - 1)
+  result.js = round(result.js)
+  result.napi = round(result.napi)
+
+  console.log(JSON.stringify(result))
+}
+
+async function threadsafe() {
+  const impls = { napi: 0, js: 1, batched: 2 }
+
+  for (const producers of [1, 16]) {
+    const name = `call_threadsafe_function_${producers}`
+
+    if (!filter.test(`threadsafe/${name}`)) continue
+
+    const calls = Math.floor(400000 / producers)
+    const result = { category: 'threadsafe', name }
+
+    for (const [impl, id] of Object.entries(impls)) {
+      const start = process.hrtime.bigint()
+      await addon.threadsafe(id, producers, calls)
+      result[impl] = round(Number(process.hrtime.bigint() - start) / (producers * calls))
+    }
+
+    result.overhead = round(result.js / result.napi - 1)
+
+    console.log(JSON.stringify(result))
+  }
+}
+
+async function tasks() {
+  for (const len of [1, 1000]) {
+    const name = `queue_task_${len}`
+
+    if (!filter.test(`task/${name}`)) continue
+
+    const result = { category: 'task', name }
+
+    for (const impl of ['napi', 'js']) {
+      const rounds = Math.ceil(100000 / len)
+
+      await Promise.all(addon.tasks(impl === 'napi', len)) // Warm up
+
+      const start = process.hrtime.bigint()
+      for (let i = 0; i < rounds; i++) {
+        await Promise.all(addon.tasks(impl === 'napi', len))
+      }
+      result[impl] = round(Number(process.hrtime.bigint() - start) / (rounds * len))
+    }
+
+    result.overhead = round(result.js / result.napi - 1)
+
+    console.log(JSON.stringify(result))
+  }
+}
+
+threadsafe().then(tasks)
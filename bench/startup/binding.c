@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stddef.h>
+
+// A module shaped like our larger addons: a lot of functions along with a
+// number of classes, each with a handful of methods.
+
+#define BENCH_X8(V, n) V(n##0) V(n##1) V(n##2) V(n##3) V(n##4) V(n##5) V(n##6) V(n##7)
+
+#define BENCH_FUNCTIONS(V) \
+  BENCH_X8(V, 0) BENCH_X8(V, 1) BENCH_X8(V, 2) BENCH_X8(V, 3) BENCH_X8(V, 4) BENCH_X8(V, 5) BENCH_X8(V, 6) BENCH_X8(V, 7)
+
+#define BENCH_CLASSES(V) \
+  BENCH_X8(V, 0) BENCH_X8(V, 1)
+
+#define BENCH_METHODS 8
+
+static js_value_t *
+bench_function(js_env_t *env, js_callback_info_t *info) {
+  return NULL;
+}
+
+static js_value_t *
+bench_constructor(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  js_value_t *receiver;
+  err = js_get_callback_info(env, info, NULL, NULL, &receiver, NULL);
+  assert(err == 0);
+
+  return receiver;
+}
+
+static js_value_t *
+bench_define_class(js_env_t *env, void *data) {
+  int err;
+
+  static const char *names[BENCH_METHODS] = {"read", "write", "seek", "flush", "close", "stat", "resize", "lock"};
+
+  js_property_descriptor_t properties[BENCH_METHODS];
+
+  for (int i = 0; i < BENCH_METHODS; i++) {
+    js_value_t *name;
+    err = js_create_string_utf8(env, (const utf8_t *) names[i], -1, &name);
+    assert(err == 0);
+
+    properties[i] = (js_property_descriptor_t) {
+      .version = 0,
+      .name = name,
+      .attributes = js_writable | js_configurable,
+      .method = bench_function,
+    };
+  }
+
+  js_value_t *result;
+  err = js_define_class(env, (const char *) data, -1, bench_constructor, NULL, properties, BENCH_METHODS, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+#define BENCH_FUNCTION(n) {0, "function" #n, NULL, bench_function, NULL},
+#define BENCH_CLASS(n)    {0, "Class" #n, "Class" #n, NULL, bench_define_class},
+
+static const bare_module_export_t bench_exports[] = {
+  BENCH_FUNCTIONS(BENCH_FUNCTION)
+  BENCH_CLASSES(BENCH_CLASS)
+};
+
+#undef BENCH_FUNCTION
+#undef BENCH_CLASS
+
+static const size_t bench_exports_len = sizeof(bench_exports) / sizeof(bench_exports[0]);
+
+// Each run creates the exports of a fresh module instance, which is the work
+// done when the module is loaded.
+
+static js_value_t *
+bench_load(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  void *data;
+  err = js_get_callback_info(env, info, NULL, NULL, NULL, &data);
+  assert(err == 0);
+
+  bool lazy = data != NULL;
+
+  js_value_t *exports;
+  err = js_create_object(env, &exports);
+  assert(err == 0);
+
+  if (lazy) {
+    err = bare_module_define_lazy_exports(env, exports, bench_exports, bench_exports_len);
+  } else {
+    err = bare_module_define_exports(env, exports, bench_exports, bench_exports_len);
+  }
+
+  if (err < 0) return NULL;
+
+  return exports;
+}
+
+static js_value_t *
+bench_exports_init(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  js_value_t *fn;
+
+  err = js_create_function(env, "eager", -1, bench_load, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "eager", fn);
+  assert(err == 0);
+
+  err = js_create_function(env, "lazy", -1, bench_load, (void *) 1, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "lazy", fn);
+  assert(err == 0);
+
+  return exports;
+}
+
+BARE_MODULE(bench_startup, bench_exports_init)
@@ -0,0 +1,86 @@
+// Usage: node index.js <path to bench_startup.node> [samples]
+//
+// Prints one JSON object per line: for each scenario, the median time in
+// nanoseconds it takes a fresh environment to create and use the exports of a
+// module with eager and with lazy exports, along with the speedup of the
+// latter. Every sample runs in a new worker such that it measures a cold start.
+
+const assert = require('assert')
+const path = require('path')
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads')
+
+const scenarios = {
+  // Loading the module without using any of its exports
+  load(exports) {
+    return exports
+  },
+
+  // Loading the module and calling a single function, which is typical of CLI
+  // tools
+  first(exports) {
+    exports.function00()
+  },
+
+  // Loading the module and touching every export
+  all(exports) {
+    for (const name of Object.keys(exports)) exports[name]
+  }
+}
+
+if (isMainThread) {
+  const filename = path.resolve(process.argv[2])
+  const samples = Number(process.argv[3] || 25)
+
+  const addon = require(filename)
+
+  const eager = addon.eager()
+  const lazy = addon.lazy()
+
+  assert.deepStrictEqual(Object.keys(lazy), Object.keys(eager))
+
+  for (const name of Object.keys(eager)) {
+    assert.strictEqual(typeof lazy[name], typeof eager[name])
+    assert.strictEqual(lazy[name], lazy[name])
+  }
+
+  function sample(mode, scenario) {
+    return new Promise((resolve, reject) => {
+      new Worker(__filename, { workerData: { filename, mode, scenario } })
+        .on('message', resolve)
+        .on('error', reject)
+    })
+  }
+
+  async function measure(mode, scenario) {
+    const results = []
+
+    for (let i = 0; i < samples; i++) results.push(await sample(mode, scenario))
+
+    return results.sort((a, b) => a - b)[samples >> 1]
+  }
+
+  ;(async () => {
+    for (const scenario of Object.keys(scenarios)) {
+      const result = {
+        name: scenario,
+        exports: Object.keys(eager).length,
+        eager: await measure('eager', scenario),
+        lazy: await measure('lazy', scenario)
+      }
+
+      result.speedup = Math.round((result.eager / result.lazy) * 100) / 100
+
+      console.log(JSON.stringify(result))
+    }
+  })()
+} else {
+  const { filename, mode, scenario } = workerData
+
+  const addon = require(filename)
+
+  const start = process.hrtime.bigint()
+  scenarios[scenario](addon[mode]())
+  const elapsed = Number(process.hrtime.bigint() - start)
+
+  parentPort.postMessage(elapsed)
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <utf.h>
+
+#define BENCH_SIZE (1 << 20)
+
+static volatile size_t bench_sink;
+
+static double
+bench_now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static size_t
+bench_fill(utf8_t *data, size_t size, const char *const alphabet[], size_t alphabet_len) {
+  size_t len = 0;
+
+  for (unsigned seed = 1;;) {
+    seed = seed * 1103515245 + 12345;
+
+    const char *c = alphabet[(seed >> 16) % alphabet_len];
+
+    size_t n = strlen(c);
+
+    if (len + n > size) break;
+
+    memcpy(&data[len], c, n);
+
+    len += n;
+  }
+
+  return len;
+}
+
+#define bench(name, input, size, expr) \
+  { \
+    size_t iterations = 0; \
+    double start = bench_now(), elapsed; \
+    do { \
+      bench_sink = (size_t) (expr); \
+      iterations++; \
+    } while ((elapsed = bench_now() - start) < 0.25); \
+    printf("%-40s %-8s %8.2f GB/s\n", name, input, (double) (size) * iterations / elapsed / 1e9); \
+  }
+
+int
+main(void) {
+  static const char *const ascii_alphabet[] = {"a", "b", "c", " ", "0", "!"};
+  static const char *const latin1_alphabet[] = {"a", "b", " ", "\xc3\xa9", "\xc3\xbf"};
+  static const char *const cjk_alphabet[] = {"\xe6\x97\xa5", "\xe6\x9c\xac", "\xe8\xaa\x9e", "a"};
+  static const char *const emoji_alphabet[] = {"\xf0\x9f\x98\x80", "\xf0\x9f\x8e\x89", "a", " "};
+
+  struct {
+    const char *name;
+    const char *const *alphabet;
+    size_t alphabet_len;
+  } inputs[] = {
+    {"ascii", ascii_alphabet, sizeof(ascii_alphabet) / sizeof(ascii_alphabet[0])},
+    {"latin1", latin1_alphabet, sizeof(latin1_alphabet) / sizeof(latin1_alphabet[0])},
+    {"cjk", cjk_alphabet, sizeof(cjk_alphabet) / sizeof(cjk_alphabet[0])},
+    {"emoji", emoji_alphabet, sizeof(emoji_alphabet) / sizeof(emoji_alphabet[0])},
+  };
+
+  utf8_t *utf8 = (utf8_t *) malloc(BENCH_SIZE);
+  utf8_t *utf8_out = (utf8_t *) malloc(BENCH_SIZE * 3);
+  utf16_t *utf16 = (utf16_t *) malloc(BENCH_SIZE * sizeof(utf16_t));
+  latin1_t *latin1 = (latin1_t *) malloc(BENCH_SIZE);
+
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+    const char *input = inputs[i].name;
+
+    size_t utf8_len = bench_fill(utf8, BENCH_SIZE, inputs[i].alphabet, inputs[i].alphabet_len);
+
+    size_t utf16_len = utf8_convert_to_utf16le(utf8, utf8_len, utf16);
+
+    // The detection kernels return early on the first mismatch, so they are
+    // only measured on input they accept.
+    if (utf8_is_ascii(utf8, utf8_len)) {
+      bench("utf8_is_ascii", input, utf8_len, utf8_is_ascii(utf8, utf8_len));
+    }
+
+    bench("utf8_validate", input, utf8_len, utf8_validate(utf8, utf8_len));
+    bench("utf16le_length_from_utf8", input, utf8_len, utf16le_length_from_utf8(utf8, utf8_len));
+    bench("utf8_convert_to_utf16le", input, utf8_len, utf8_convert_to_utf16le(utf8, utf8_len, utf16));
+    bench("utf8_length_from_utf16le", input, utf16_len * sizeof(utf16_t), utf8_length_from_utf16le(utf16, utf16_len));
+    bench("utf16le_convert_to_utf8", input, utf16_len * sizeof(utf16_t), utf16le_convert_to_utf8(utf16, utf16_len, utf8_out));
+
+    if (utf16le_is_latin1(utf16, utf16_len)) {
+      bench("utf16le_is_latin1", input, utf16_len * sizeof(utf16_t), utf16le_is_latin1(utf16, utf16_len));
+      bench("utf16le_convert_to_latin1", input, utf16_len * sizeof(utf16_t), utf16le_convert_to_latin1(utf16, utf16_len, latin1));
+      bench("utf16le_convert_to_latin1_prefix", input, utf16_len * sizeof(utf16_t), utf16le_convert_to_latin1_prefix(utf16, utf16_len, latin1));
+      bench("latin1_convert_to_utf16le", input, utf16_len, latin1_convert_to_utf16le(latin1, utf16_len, utf16));
+    }
+  }
+
+  free(utf8);
+  free(utf8_out);
+  free(utf16);
+  free(latin1);
+
+  return 0;
+}
@@ -4,10 +4,20 @@
 #include <js.h>
 #include <node_api.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #define BARE_MODULE_VERSION 0
 
-#define BARE_MODULE(id, fn) NAPI_MODULE(id, fn)
+/**
+ * Register a context aware module. The exports callback is invoked once for
+ * every environment that loads the module, including worker threads, on the
+ * thread owning that environment.
+ */
+#define BARE_MODULE(id, fn) \
+  NAPI_MODULE_INIT() { \
+    return bare__module_init(env, exports, fn); \
+  }
 
 typedef struct bare_module_s bare_module_t;
 
@@ -24,18 +34,270 @@ struct bare_module_s {
   bare_module_register_cb exports;
 };
 
+typedef struct bare_module_export_s bare_module_export_t;
+
+typedef js_value_t *(*bare_module_export_cb)(js_env_t *env, void *data);
+
+/** @version 0 */
+struct bare_module_export_s {
+  int version;
+
+  /** @since 0 */
+  const char *name;
+
+  /** @since 0 */
+  void *data;
+
+  // One of:
+
+  // Function
+
+  /** @since 0 */
+  js_function_cb function;
+
+  // Value, such as a class, computed by a callback
+
+  /** @since 0 */
+  bare_module_export_cb value;
+};
+
+static inline napi_value
+bare__module_init(napi_env env, napi_value exports, bare_module_register_cb fn) {
+  // Set up the per-environment state of the shim up front, on the thread that
+  // owns the environment, rather than on first use.
+  js__get_env(env);
+
+  return fn(env, exports);
+}
+
+static inline bare_module_t *
+bare__get_module(void) {
+  static bare_module_t module;
+
+  return &module;
+}
+
+static inline napi_value
+bare__on_module_register(napi_env env, napi_value exports) {
+  return bare__module_init(env, exports, bare__get_module()->exports);
+}
+
+static inline int
+bare__materialize_export(js_env_t *env, const bare_module_export_t *entry, js_value_t **result) {
+  if (entry->function) {
+    return js_create_function(env, entry->name, -1, entry->function, entry->data, result);
+  }
+
+  js_value_t *value = entry->value(env, entry->data);
+
+  if (value == NULL) return js_pending_exception;
+
+  *result = value;
+
+  return 0;
+}
+
+static inline js_value_t *
+bare__on_lazy_export_materialize(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+  void *data;
+  err = js_get_callback_info(env, info, &argc, argv, NULL, &data);
+  if (err < 0) return NULL;
+
+  uint32_t i;
+  err = js_get_value_uint32(env, argv[0], &i);
+  if (err < 0) return NULL;
+
+  const bare_module_export_t *entries = (const bare_module_export_t *) data;
+
+  js_value_t *value;
+  err = bare__materialize_export(env, &entries[i], &value);
+  if (err < 0) return NULL;
+
+  return value;
+}
+
+static inline int
+bare__define_exports(js_env_t *env, js_value_t *exports, bare_module_export_t const entries[], size_t len) {
+  napi_property_descriptor stack[JS_SCRATCH_PROPERTY_DESCRIPTORS];
+
+  js__env_t *state = NULL;
+
+  napi_property_descriptor *properties = stack;
+
+  if (len > JS_SCRATCH_PROPERTY_DESCRIPTORS) {
+    state = js__get_env(env);
+
+    properties = (napi_property_descriptor *) js__scratch_alloc(state, sizeof(napi_property_descriptor) * len);
+
+    if (properties == NULL) {
+      napi_throw_error(env, NULL, "Out of memory");
+
+      return js_pending_exception;
+    }
+  }
+
+  int err = 0;
+
+  for (size_t i = 0; i < len && err == 0; i++) {
+    const bare_module_export_t *entry = &entries[i];
+
+    napi_property_descriptor *property = &properties[i];
+
+    memset(property, 0, sizeof(napi_property_descriptor));
+
+    property->utf8name = entry->name;
+    property->attributes = (napi_property_attributes) (napi_writable | napi_enumerable | napi_configurable);
+
+    if (entry->function) {
+      property->method = entry->function;
+      property->data = entry->data;
+    } else {
+      err = bare__materialize_export(env, entry, &property->value);
+    }
+  }
+
+  if (err == 0) {
+    napi_status status = napi_define_properties(env, exports, len, properties);
+
+    err = js_convert_from_status(status);
+  }
+
+  if (properties != stack) js__scratch_free(state, properties);
+
+  return err;
+}
+
+static inline int
+bare__define_lazy_exports(js_env_t *env, js_value_t *exports, bare_module_export_t const entries[], size_t len) {
+  int err;
+
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  // Accessors are defined from JavaScript as those are far cheaper to create
+  // than native accessors, which each need their own function template. They
+  // all share a single native function that materializes the exports, and
+  // keep the value rather than redefining themselves as data properties as
+  // reconfiguring an accessor is slower than materializing most exports.
+  js_value_t *helper;
+  err = js_convert_from_status(js__get_optional_helper(
+    state,
+    &state->helpers.define_lazy_exports,
+    "(function (exports, names, materialize) {"
+    "  names = names.split('\\0');"
+    "  for (let i = 0, n = names.length; i < n; i++) {"
+    "    let value, materialized = false;"
+    "    Object.defineProperty(exports, names[i], {"
+    "      get () {"
+    "        if (materialized === false) value = materialize(i), materialized = true;"
+    "        return value"
+    "      },"
+    "      set (replacement) { value = replacement, materialized = true },"
+    "      enumerable: true,"
+    "      configurable: true"
+    "    })"
+    "  }"
+    "})",
+    &helper
+  ));
+  if (err < 0) return err;
+
+  // Define the exports up front if the accessors can't be created.
+  if (helper == NULL) return bare__define_exports(env, exports, entries, len);
+
+  // Pass the names as a single NUL separated string rather than creating a
+  // string for each of them.
+  size_t names_len = 0;
+
+  for (size_t i = 0; i < len; i++) names_len += strlen(entries[i].name) + 1;
+
+  char *names = (char *) js__scratch_alloc(state, names_len);
+
+  if (names == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+
+    return js_pending_exception;
+  }
+
+  for (size_t i = 0, offset = 0; i < len; i++) {
+    size_t name_len = strlen(entries[i].name);
+
+    memcpy(&names[offset], entries[i].name, name_len);
+
+    offset += name_len;
+
+    names[offset++] = '\0';
+  }
+
+  js_value_t *argv[3] = {exports};
+
+  err = js_create_string_utf8(env, (const utf8_t *) names, names_len - 1 /* Trailing NUL */, &argv[1]);
+
+  js__scratch_free(state, names);
+
+  if (err < 0) return err;
+
+  err = js_create_function(env, "materialize", -1, bare__on_lazy_export_materialize, (void *) entries, &argv[2]);
+  if (err < 0) return err;
+
+  js_value_t *receiver;
+  err = js_get_undefined(env, &receiver);
+  if (err < 0) return err;
+
+  return js_call_function(env, receiver, helper, 3, argv, NULL);
+}
+
+/**
+ * Define the exports in `entries` on `exports`, creating all of them up front.
+ */
+static inline int
+bare_module_define_exports(js_env_t *env, js_value_t *exports, bare_module_export_t const entries[], size_t len) {
+  return bare__define_exports(env, exports, entries, len);
+}
+
+/**
+ * Define the exports in `entries` on `exports` as accessors that create the
+ * export on first access and then return it from then on, which keeps
+ * module initialization cheap for modules that export a lot of functions and
+ * classes. `entries` is referenced by the accessors and must therefore outlive
+ * `exports`, such as by being declared `static const`.
+ */
+static inline int
+bare_module_define_lazy_exports(js_env_t *env, js_value_t *exports, bare_module_export_t const entries[], size_t len) {
+  if (len == 0) return 0;
+
+  return bare__define_lazy_exports(env, exports, entries, len);
+}
+
+/**
+ * Register a module using the deprecated Node-API registration. The module is
+ * only announced to the environment that loads the library as the library
+ * isn't initialized again when loaded by other environments, such as worker
+ * threads. Use `BARE_MODULE()` for modules that must load in those.
+ */
 static inline void
 bare_module_register(bare_module_t *module) {
-  napi_module napi_module = {
+  // Node-API keeps a pointer to the module and calls into it when the module
+  // is loaded, so neither may live on the stack of the caller.
+  static napi_module napi_module = {
     NAPI_MODULE_VERSION,
     0,
-    module->name,
-    module->exports,
+    NULL,
+    bare__on_module_register,
     NULL,
     NULL,
     {0},
   };
 
+  *bare__get_module() = *module;
+
+  napi_module.nm_filename = module->name;
+
   napi_module_register(&napi_module);
 }
 
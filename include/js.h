@@ -6,15 +6,24 @@ extern "C" {
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <utf.h>
 #include <uv.h>
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <node_version.h> // Node-API version information
 
 #ifndef NAPI_VERSION
@@ -32,6 +41,7 @@ typedef struct napi_deferred__ js_deferred_t;
 typedef struct napi_callback_info__ js_callback_info_t;
 typedef struct napi_threadsafe_function__ js_threadsafe_function_t;
 typedef struct napi_async_cleanup_hook_handle__ js_deferred_teardown_t;
+typedef struct js_task_s js_task_t;
 
 typedef void *js_typed_callback_info_t;
 
@@ -39,13 +49,26 @@ typedef void *js_string_view_t;
 
 typedef struct js_type_tag_s js_type_tag_t;
 typedef struct js_property_descriptor_s js_property_descriptor_t;
+typedef napi_property_descriptor js_static_property_descriptor_t;
 typedef struct js_callback_signature_s js_callback_signature_t;
+typedef struct js_scratch_statistics_s js_scratch_statistics_t;
+typedef struct js_value_classification_s js_value_classification_t;
+typedef struct js_property_key_statistics_s js_property_key_statistics_t;
+typedef struct js_threadsafe_function_statistics_s js_threadsafe_function_statistics_t;
+typedef struct js_external_memory_statistics_s js_external_memory_statistics_t;
+typedef struct js_task_statistics_s js_task_statistics_t;
+typedef struct js_schema_s js_schema_t;
+typedef struct js_schema_field_s js_schema_field_t;
+typedef struct js_json_writer_s js_json_writer_t;
 
 typedef js_value_t *(*js_function_cb)(js_env_t *, js_callback_info_t *);
 typedef void (*js_finalize_cb)(js_env_t *, void *data, void *finalize_hint);
 typedef void (*js_threadsafe_function_cb)(js_env_t *, js_value_t *function, void *context, void *data);
+typedef void (*js_threadsafe_function_batch_cb)(js_env_t *, js_value_t *function, void *context, void *const data[], size_t len);
 typedef void (*js_teardown_cb)(void *data);
 typedef void (*js_deferred_teardown_cb)(js_deferred_teardown_t *, void *data);
+typedef void (*js_task_work_cb)(void *data);
+typedef js_value_t *(*js_task_complete_cb)(js_env_t *, bool cancelled, void *data);
 
 enum {
   /**
@@ -107,6 +130,39 @@ enum {
   js_biguint64 = 12 << 8 | js_number,
 };
 
+enum {
+  // Value kinds. The low byte of a kind is always the js_value_type_t of the
+  // value, the remaining bits refine it.
+
+  // Numbers with an integral value in range. These are flags; an integer in
+  // [0, INT32_MAX] is both js_kind_int32 and js_kind_uint32.
+
+  js_kind_int32 = 1 << 8 | js_number,
+  js_kind_uint32 = 2 << 8 | js_number,
+
+  // Objects
+
+  js_kind_array = 1 << 8 | js_object,
+  js_kind_arraybuffer = 2 << 8 | js_object,
+  js_kind_dataview = 3 << 8 | js_object,
+
+  // Typed arrays, each also matching js_kind_typedarray as a flag
+
+  js_kind_typedarray = 0x20 << 8 | js_object,
+  js_kind_int8array = (0x20 | (js_int8array + 1)) << 8 | js_object,
+  js_kind_uint8array = (0x20 | (js_uint8array + 1)) << 8 | js_object,
+  js_kind_uint8clampedarray = (0x20 | (js_uint8clampedarray + 1)) << 8 | js_object,
+  js_kind_int16array = (0x20 | (js_int16array + 1)) << 8 | js_object,
+  js_kind_uint16array = (0x20 | (js_uint16array + 1)) << 8 | js_object,
+  js_kind_int32array = (0x20 | (js_int32array + 1)) << 8 | js_object,
+  js_kind_uint32array = (0x20 | (js_uint32array + 1)) << 8 | js_object,
+  js_kind_float16array = (0x20 | (js_float16array + 1)) << 8 | js_object,
+  js_kind_float32array = (0x20 | (js_float32array + 1)) << 8 | js_object,
+  js_kind_float64array = (0x20 | (js_float64array + 1)) << 8 | js_object,
+  js_kind_bigint64array = (0x20 | (js_bigint64array + 1)) << 8 | js_object,
+  js_kind_biguint64array = (0x20 | (js_biguint64array + 1)) << 8 | js_object,
+};
+
 enum {
   js_writable = 1,
   js_enumerable = 1 << 1,
@@ -125,6 +181,29 @@ typedef enum {
   js_threadsafe_function_abort = 1
 } js_threadsafe_function_release_mode_t;
 
+typedef enum {
+  /**
+   * Map the file for reading. JavaScript can't be kept from writing to the
+   * resulting ArrayBuffer, so pages written to are still copied into private
+   * memory, but no memory is reserved up front for such copies.
+   */
+  js_mapping_read_only = 0,
+
+  /**
+   * Map the file copy-on-write. Pages written to are copied into private
+   * memory and the writes are never carried through to the file.
+   */
+  js_mapping_copy_on_write = 1,
+} js_mapping_mode_t;
+
+typedef enum {
+  js_mapping_advice_normal = 0,
+  js_mapping_advice_random = 1,
+  js_mapping_advice_sequential = 2,
+  js_mapping_advice_will_need = 3,
+  js_mapping_advice_dont_need = 4,
+} js_mapping_advice_t;
+
 typedef enum {
   js_threadsafe_function_nonblocking = 0,
   js_threadsafe_function_blocking = 1
@@ -187,6 +266,223 @@ struct js_callback_signature_s {
   int *args;
 };
 
+/** @version 0 */
+struct js_scratch_statistics_s {
+  int version;
+
+  /** @since 0 */
+  size_t size;
+
+  /** @since 0 */
+  size_t used;
+
+  /** @since 0 */
+  size_t high_water_mark;
+
+  /** @since 0 */
+  size_t overflows;
+};
+
+/** @version 0 */
+struct js_value_classification_s {
+  int version;
+
+  /**
+   * The kind of the value, see `js_kind_*`. Only the payload fields that apply
+   * to the kind are written.
+   *
+   * @since 0
+   */
+  int kind;
+
+  // Booleans
+
+  /** @since 0 */
+  bool boolean;
+
+  // Numbers
+
+  /** @since 0 */
+  double number;
+
+  // Array buffers, typed arrays, and data views. For typed arrays `len` is the
+  // number of elements, otherwise it is the number of bytes.
+
+  /** @since 0 */
+  js_typedarray_type_t typedarray;
+
+  /** @since 0 */
+  void *data;
+
+  /** @since 0 */
+  size_t len;
+
+  /** @since 0 */
+  js_value_t *arraybuffer;
+
+  /** @since 0 */
+  size_t offset;
+};
+
+/** @version 0 */
+struct js_property_key_statistics_s {
+  int version;
+
+  /** @since 0 */
+  size_t size;
+
+  /** @since 0 */
+  size_t hits;
+
+  /** @since 0 */
+  size_t misses;
+};
+
+/** @version 0 */
+struct js_threadsafe_function_statistics_s {
+  int version;
+
+  /**
+   * The number of calls queued, but not yet delivered.
+   *
+   * @since 0
+   */
+  size_t depth;
+
+  /**
+   * The number of times the function has woken up the event loop of its
+   * environment.
+   *
+   * @since 0
+   */
+  size_t wakeups;
+
+  /**
+   * The number of calls delivered.
+   *
+   * @since 0
+   */
+  size_t calls;
+};
+
+/** @version 0 */
+struct js_external_memory_statistics_s {
+  int version;
+
+  /**
+   * The external memory accounted for by the module in the environment,
+   * including changes not yet reported to the engine.
+   *
+   * @since 0
+   */
+  int64_t total;
+
+  /**
+   * The change in external memory not yet reported to the engine.
+   *
+   * @since 0
+   */
+  int64_t pending;
+
+  /**
+   * The number of calls to `js_adjust_external_memory()`.
+   *
+   * @since 0
+   */
+  size_t adjustments;
+
+  /**
+   * The number of times accumulated changes were reported to the engine.
+   *
+   * @since 0
+   */
+  size_t flushes;
+};
+
+/** @version 0 */
+struct js_schema_field_s {
+  int version;
+
+  /** @since 0 */
+  const char *name;
+
+  /**
+   * One of `js_boolean`, a numeric type such as `js_int32` or `js_float64`, or
+   * `js_string` for a NUL terminated UTF-8 character array.
+   *
+   * @since 0
+   */
+  int type;
+
+  /** @since 0 */
+  size_t offset;
+
+  /** @since 0 */
+  size_t size;
+};
+
+/** @version 0 */
+struct js_schema_s {
+  int version;
+
+  /** @since 0 */
+  size_t size;
+
+  /** @since 0 */
+  const js_schema_field_t *fields;
+
+  /** @since 0 */
+  size_t fields_len;
+};
+
+/** @version 0 */
+struct js_task_statistics_s {
+  int version;
+
+  /**
+   * The number of tasks queued.
+   *
+   * @since 0
+   */
+  size_t queued;
+
+  /**
+   * The number of tasks cancelled before they ran.
+   *
+   * @since 0
+   */
+  size_t cancelled;
+
+  /**
+   * The number of promises settled.
+   *
+   * @since 0
+   */
+  size_t settled;
+
+  /**
+   * The number of batches the promises were settled in.
+   *
+   * @since 0
+   */
+  size_t batches;
+};
+
+/**
+ * A buffer that JSON is written to from native code, which is then turned into
+ * JavaScript values in one go by `js_parse_json_writer()`. Initialize it with
+ * `js_json_writer_init()` and release it with `js_json_writer_destroy()`; the
+ * fields are private.
+ */
+struct js_json_writer_s {
+  char *data;
+  size_t len;
+  size_t capacity;
+  bool separate;
+  bool ascii;
+  bool failed;
+};
+
 static inline int
 js_convert_from_status(napi_status status) {
   switch (status) {
@@ -357,1318 +653,5184 @@ js_convert_to_threadsafe_function_call_mode(js_threadsafe_function_call_mode_t m
 
 #endif
 
-#if NAPI_VERSION >= 2
+#ifndef JS_SCRATCH_SIZE
+#define JS_SCRATCH_SIZE 16384
+#endif
 
-static inline int
-js_get_env_loop(js_env_t *env, uv_loop_t **result) {
-  napi_status status = napi_get_uv_event_loop(env, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_SCRATCH_PROPERTY_DESCRIPTORS
+#define JS_SCRATCH_PROPERTY_DESCRIPTORS 16
+#endif
 
+#ifndef JS_STRING_VIEW_POOL
+#define JS_STRING_VIEW_POOL 8
 #endif
 
-static inline int
-js_open_handle_scope(js_env_t *env, js_handle_scope_t **result) {
-  napi_status status = napi_open_handle_scope(env, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_STRING_VIEW_POOL_MAX_SIZE
+#define JS_STRING_VIEW_POOL_MAX_SIZE 65536
+#endif
 
-static inline int
-js_close_handle_scope(js_env_t *env, js_handle_scope_t *scope) {
-  napi_status status = napi_close_handle_scope(env, scope);
-  return js_convert_from_status(status);
-}
+#ifndef JS_STRING_VIEW_CACHE
+#define JS_STRING_VIEW_CACHE 0
+#endif
 
-static inline int
-js_open_escapable_handle_scope(js_env_t *env, js_escapable_handle_scope_t **result) {
-  napi_status status = napi_open_escapable_handle_scope(env, result);
-  return js_convert_from_status(status);
-}
+#if JS_STRING_VIEW_CACHE > 0 && NAPI_VERSION >= 10
+#define JS__STRING_VIEW_CACHE JS_STRING_VIEW_CACHE
+#endif
 
-static inline int
-js_close_escapable_handle_scope(js_env_t *env, js_escapable_handle_scope_t *scope) {
-  napi_status status = napi_close_escapable_handle_scope(env, scope);
-  return js_convert_from_status(status);
-}
+#ifndef JS_PROPERTY_KEY_CACHE
+#define JS_PROPERTY_KEY_CACHE 64
+#endif
 
-static inline int
-js_escape_handle(js_env_t *env, js_escapable_handle_scope_t *scope, js_value_t *escapee, js_value_t **result) {
-  napi_status status = napi_escape_handle(env, scope, escapee, result);
-  return js_convert_from_status(status);
-}
+// Node-API only allows references to strings from version 10, so the keys
+// can't be kept around by earlier versions.
+#if JS_PROPERTY_KEY_CACHE > 0 && NAPI_VERSION >= 10
+#define JS__PROPERTY_KEY_CACHE JS_PROPERTY_KEY_CACHE
 
-static inline int
-js_run_script(js_env_t *env, const char *file, size_t len, int offset, js_value_t *source, js_value_t **result) {
-  napi_status status = napi_run_script(env, source, result);
-  return js_convert_from_status(status);
-}
+static_assert((JS_PROPERTY_KEY_CACHE & (JS_PROPERTY_KEY_CACHE - 1)) == 0, "JS_PROPERTY_KEY_CACHE must be a power of two");
+#endif
 
-static inline int
-js_create_reference(js_env_t *env, js_value_t *value, uint32_t count, js_ref_t **result) {
-  napi_status status = napi_create_reference(env, value, count, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_FORMAT_STACK_SIZE
+#define JS_FORMAT_STACK_SIZE 256
+#endif
 
-static inline int
-js_delete_reference(js_env_t *env, js_ref_t *reference) {
-  napi_status status = napi_delete_reference(env, reference);
-  return js_convert_from_status(status);
-}
+#ifndef JS_THREADSAFE_FUNCTION_BATCH_CAPACITY
+#define JS_THREADSAFE_FUNCTION_BATCH_CAPACITY 1024
+#endif
 
-static inline int
-js_reference_ref(js_env_t *env, js_ref_t *reference, uint32_t *result) {
-  napi_status status = napi_reference_ref(env, reference, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_ARRAY_ELEMENTS_BULK_THRESHOLD
+#define JS_ARRAY_ELEMENTS_BULK_THRESHOLD 16
+#endif
 
-static inline int
-js_reference_unref(js_env_t *env, js_ref_t *reference, uint32_t *result) {
-  napi_status status = napi_reference_unref(env, reference, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_ARRAY_ELEMENTS_CHUNK
+#define JS_ARRAY_ELEMENTS_CHUNK 1024
+#endif
 
-static inline int
-js_get_reference_value(js_env_t *env, js_ref_t *reference, js_value_t **result) {
-  napi_status status = napi_get_reference_value(env, reference, result);
-  return js_convert_from_status(status);
-}
+#ifndef JS_EXTERNAL_MEMORY_THRESHOLD
+#define JS_EXTERNAL_MEMORY_THRESHOLD 262144
+#endif
 
-static inline int
-js_define_class(js_env_t *env, const char *name, size_t len, js_function_cb constructor, void *data, js_property_descriptor_t const properties[], size_t properties_len, js_value_t **result) {
-  napi_property_descriptor *napi_properties = (napi_property_descriptor *) malloc(sizeof(napi_property_descriptor) * properties_len);
+#ifndef JS_UNSAFE_ARRAYBUFFER_THRESHOLD
+#define JS_UNSAFE_ARRAYBUFFER_THRESHOLD 4096
+#endif
 
-  for (size_t i = 0; i < properties_len; i++) {
-    const js_property_descriptor_t *property = &properties[i];
+#ifndef JS_JSON_EXTERNAL_STRING_THRESHOLD
+#define JS_JSON_EXTERNAL_STRING_THRESHOLD 65536
+#endif
 
-    napi_property_descriptor *napi_property = &napi_properties[i];
+#ifndef JS_TYPEDARRAY_POOL_SIZE
+#define JS_TYPEDARRAY_POOL_SIZE 8192
+#endif
 
-    napi_property->name = property->name;
-    napi_property->utf8name = NULL;
+#define JS__SCRATCH_ALIGNMENT 16
 
-    napi_property->method = property->method;
-    napi_property->getter = property->getter;
-    napi_property->setter = property->setter;
-    napi_property->value = property->value;
+#define JS__TYPEDARRAY_POOL_ALIGNMENT 8
 
-    napi_property->attributes = (napi_property_attributes) property->attributes;
-    napi_property->data = property->data;
-  }
+#if defined(__cplusplus)
+#define JS__THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define JS__THREAD_LOCAL __declspec(thread)
+#else
+#define JS__THREAD_LOCAL _Thread_local
+#endif
 
-  napi_status status = napi_define_class(env, name, len, constructor, data, properties_len, napi_properties, result);
+#if defined(_MSC_VER)
+#define JS__WEAK __declspec(selectany)
+#else
+#define JS__WEAK __attribute__((weak))
+#endif
 
-  free(napi_properties);
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
 
-  return js_convert_from_status(status);
+#ifdef _WIN64
+#define JS__INTERLOCKED(name) name##64
+#define JS__INTERLOCKED_T __int64
+#else
+#define JS__INTERLOCKED(name) name
+#define JS__INTERLOCKED_T long
+#endif
+#endif
+
+static inline size_t
+js__atomic_load(size_t *ptr) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return (size_t) JS__INTERLOCKED(_InterlockedCompareExchange)((volatile JS__INTERLOCKED_T *) ptr, 0, 0);
+#else
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#endif
 }
 
-static inline int
-js_define_properties(js_env_t *env, js_value_t *object, js_property_descriptor_t const properties[], size_t properties_len) {
-  napi_property_descriptor *napi_properties = (napi_property_descriptor *) malloc(sizeof(napi_property_descriptor) * properties_len);
+static inline void
+js__atomic_store(size_t *ptr, size_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  JS__INTERLOCKED(_InterlockedExchange)((volatile JS__INTERLOCKED_T *) ptr, (JS__INTERLOCKED_T) value);
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
 
-  for (size_t i = 0; i < properties_len; i++) {
-    const js_property_descriptor_t *property = &properties[i];
+static inline size_t
+js__atomic_exchange(size_t *ptr, size_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return (size_t) JS__INTERLOCKED(_InterlockedExchange)((volatile JS__INTERLOCKED_T *) ptr, (JS__INTERLOCKED_T) value);
+#else
+  return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
 
-    napi_property_descriptor *napi_property = &napi_properties[i];
+static inline size_t
+js__atomic_fetch_add(size_t *ptr, size_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return (size_t) JS__INTERLOCKED(_InterlockedExchangeAdd)((volatile JS__INTERLOCKED_T *) ptr, (JS__INTERLOCKED_T) value);
+#else
+  return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
 
-    napi_property->name = property->name;
-    napi_property->utf8name = NULL;
+static inline bool
+js__atomic_compare_exchange(size_t *ptr, size_t *expected, size_t desired) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  size_t actual = (size_t) JS__INTERLOCKED(_InterlockedCompareExchange)((volatile JS__INTERLOCKED_T *) ptr, (JS__INTERLOCKED_T) desired, (JS__INTERLOCKED_T) *expected);
 
-    napi_property->method = property->method;
-    napi_property->getter = property->getter;
-    napi_property->setter = property->setter;
-    napi_property->value = property->value;
+  if (actual == *expected) return true;
 
-    napi_property->attributes = (napi_property_attributes) property->attributes;
+  *expected = actual;
+
+  return false;
+#else
+  return __atomic_compare_exchange_n(ptr, expected, desired, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+typedef struct js__node_api_s js__node_api_t;
+
+/**
+ * Optional Node-API functions that are newer than the Node-API version some
+ * addons are compiled against. Those available at compile time are linked
+ * directly while the remaining ones are looked up in the host process the
+ * first time they're needed, such that a single binary picks the best path
+ * available in whichever runtime loads it. Missing functions are `NULL`.
+ */
+struct js__node_api_s {
+  napi_status(NAPI_CDECL *symbol_for)(napi_env, const char *, size_t, napi_value *);
+  napi_status(NAPI_CDECL *create_syntax_error)(napi_env, napi_value, napi_value, napi_value *);
+  napi_status(NAPI_CDECL *create_external_string_latin1)(napi_env, char *, size_t, napi_finalize, void *, napi_value *, bool *);
+  napi_status(NAPI_CDECL *create_external_string_utf16)(napi_env, char16_t *, size_t, napi_finalize, void *, napi_value *, bool *);
+  napi_status(NAPI_CDECL *create_property_key_latin1)(napi_env, const char *, size_t, napi_value *);
+  napi_status(NAPI_CDECL *create_property_key_utf8)(napi_env, const char *, size_t, napi_value *);
+  napi_status(NAPI_CDECL *create_property_key_utf16)(napi_env, const char16_t *, size_t, napi_value *);
+  napi_status(NAPI_CDECL *is_sharedarraybuffer)(napi_env, napi_value, bool *);
+  napi_status(NAPI_CDECL *create_sharedarraybuffer)(napi_env, size_t, void **, napi_value *);
+  napi_status(NAPI_CDECL *get_module_file_name)(napi_env, const char **);
+};
+
+JS__WEAK uv_once_t js__node_api_once = UV_ONCE_INIT;
+
+#ifdef __cplusplus
+JS__WEAK js__node_api_t js__node_api = {};
+#else
+JS__WEAK js__node_api_t js__node_api = {0};
+#endif
+
+static inline void *
+js__resolve_node_api(const char *name) {
+#ifdef _WIN32
+  return (void *) GetProcAddress(GetModuleHandleW(NULL), name);
+#else
+  void *handle = dlopen(NULL, RTLD_LAZY);
+
+  if (handle == NULL) return NULL;
+
+  void *symbol = dlsym(handle, name);
+
+  dlclose(handle);
+
+  return symbol;
+#endif
+}
+
+#define JS__RESOLVE_NODE_API(field, name) \
+  *(void **) &js__node_api.field = js__resolve_node_api(#name);
+
+static inline void
+js__on_node_api_init(void) {
+#if NAPI_VERSION >= 9
+  js__node_api.symbol_for = node_api_symbol_for;
+  js__node_api.create_syntax_error = node_api_create_syntax_error;
+  js__node_api.get_module_file_name = node_api_get_module_file_name;
+#else
+  JS__RESOLVE_NODE_API(symbol_for, node_api_symbol_for)
+  JS__RESOLVE_NODE_API(create_syntax_error, node_api_create_syntax_error)
+  JS__RESOLVE_NODE_API(get_module_file_name, node_api_get_module_file_name)
+#endif
+
+#if NAPI_VERSION >= 10
+  js__node_api.create_external_string_latin1 = node_api_create_external_string_latin1;
+  js__node_api.create_external_string_utf16 = node_api_create_external_string_utf16;
+  js__node_api.create_property_key_latin1 = node_api_create_property_key_latin1;
+  js__node_api.create_property_key_utf8 = node_api_create_property_key_utf8;
+  js__node_api.create_property_key_utf16 = node_api_create_property_key_utf16;
+#else
+  JS__RESOLVE_NODE_API(create_external_string_latin1, node_api_create_external_string_latin1)
+  JS__RESOLVE_NODE_API(create_external_string_utf16, node_api_create_external_string_utf16)
+  JS__RESOLVE_NODE_API(create_property_key_latin1, node_api_create_property_key_latin1)
+  JS__RESOLVE_NODE_API(create_property_key_utf8, node_api_create_property_key_utf8)
+  JS__RESOLVE_NODE_API(create_property_key_utf16, node_api_create_property_key_utf16)
+#endif
+
+  // Still experimental and so always resolved at runtime.
+  JS__RESOLVE_NODE_API(is_sharedarraybuffer, node_api_is_sharedarraybuffer)
+  JS__RESOLVE_NODE_API(create_sharedarraybuffer, node_api_create_sharedarraybuffer)
+}
+
+#undef JS__RESOLVE_NODE_API
+
+static inline const js__node_api_t *
+js__get_node_api(void) {
+  uv_once(&js__node_api_once, js__on_node_api_init);
+
+  return &js__node_api;
+}
+
+typedef struct js__env_s js__env_t;
+typedef struct js__string_view_s js__string_view_t;
+typedef struct js__property_key_s js__property_key_t;
+
+typedef struct js__task_teardown_s js__task_teardown_t;
+typedef struct js__external_memory_entry_s js__external_memory_entry_t;
+
+/**
+ * Tasks still running when their environment is torn down keep the teardown
+ * from completing, and the event loop from being closed, until they have all
+ * completed.
+ */
+struct js__task_teardown_s {
+  js_deferred_teardown_t *handle;
+  size_t refs;
+};
+
+/**
+ * A task runs on the threadpool and is then queued for its promise to be
+ * settled together with all other tasks completing in the same iteration of
+ * the event loop. It's detached from its environment, with `state` cleared,
+ * if the environment is torn down while the task is still running.
+ */
+struct js_task_s {
+  uv_work_t req;
+  js__env_t *state;
+  js__task_teardown_t *teardown;
+  js_task_t *prev;
+  js_task_t *next;
+  js_deferred_t *deferred;
+  js_task_work_cb work;
+  js_task_complete_cb complete;
+  void *data;
+  bool cancelled;
+};
+
+/**
+ * The entry of a module in the external memory registry reads the total of the
+ * module for as long as its environment is alive. It's shared by the
+ * environment and the accessor of the entry, and freed once both let go of it.
+ */
+struct js__external_memory_entry_s {
+  js__env_t *state;
+  size_t refs;
+};
+
+/**
+ * A string view is a header followed by its contents in the native encoding of
+ * the string. Released views are kept in a per-environment pool for reuse and,
+ * if enabled, recently viewed strings keep their view alive in a small cache.
+ */
+struct js__string_view_s {
+  js__string_view_t *next;
+  size_t size;
+  size_t refs;
+  size_t len;
+  js_string_encoding_t encoding;
+#ifdef JS__STRING_VIEW_CACHE
+  js_ref_t *string;
+#endif
+};
+
+/**
+ * An interned property key, keyed by the address of the C string it was
+ * created from. The contents are kept as well to detect when the address has
+ * been reused for a different name.
+ */
+struct js__property_key_s {
+  const char *address;
+  char *name;
+  js_ref_t *key;
+};
+
+/**
+ * Per-environment state owned by the shim. An environment is only ever used
+ * from the thread that created it, so the states are kept in a thread local
+ * list with the most recently used environment at the front.
+ */
+struct js__env_s {
+  js_env_t *env;
+  js__env_t *next;
+
+  /**
+   * Bump allocator for temporary allocations made by the shim itself. The
+   * arena rewinds as allocations are released in reverse order and resets
+   * entirely once nothing is outstanding.
+   */
+  struct {
+    char *data;
+    size_t size;
+    size_t len;
+    size_t refs;
+    size_t high_water_mark;
+    size_t overflows;
+  } scratch;
+
+  struct {
+    js__string_view_t *pool;
+    size_t pool_len;
+#ifdef JS__STRING_VIEW_CACHE
+    js__string_view_t *cache[JS__STRING_VIEW_CACHE];
+    size_t cache_next;
+#endif
+  } string_views;
+
+  struct {
+#ifdef JS__PROPERTY_KEY_CACHE
+    js__property_key_t cache[JS__PROPERTY_KEY_CACHE];
+#endif
+    size_t hits;
+    size_t misses;
+  } property_keys;
+
+  /**
+   * Changes in external memory are accumulated and only reported to the engine
+   * once they exceed `JS_EXTERNAL_MEMORY_THRESHOLD`, or otherwise once the
+   * event loop has finished running callbacks. The engine total is the one it
+   * returned when last reported to.
+   */
+  struct {
+    int64_t total;
+    int64_t pending;
+    int64_t engine_total;
+    size_t adjustments;
+    size_t flushes;
+    uv_check_t *check;
+    js__external_memory_entry_t *entry;
+  } external_memory;
+
+  /**
+   * Tasks running on the threadpool, and completed tasks waiting for their
+   * promises to be settled once the event loop has finished running callbacks.
+   */
+  struct {
+    js_task_t *running;
+    js_task_t *completed;
+    js_task_t *completed_tail;
+    uv_check_t *check;
+    js_deferred_teardown_t *teardown;
+    size_t queued;
+    size_t cancelled;
+    size_t settled;
+    size_t batches;
+  } tasks;
+
+  /**
+   * Shared backing store that small pooled typed arrays are carved out of.
+   */
+  struct {
+    napi_ref arraybuffer;
+    char *data;
+    size_t len;
+    size_t offset;
+  } typedarray_pool;
+
+  /**
+   * JavaScript helpers compiled on first use.
+   */
+  struct {
+    napi_ref set_array_elements;
+    napi_ref define_lazy_exports;
+    napi_ref create_sharedarraybuffer;
+    napi_ref view_sharedarraybuffer;
+    napi_ref is_sharedarraybuffer;
+    napi_ref encode_records;
+    napi_ref decode_records;
+    napi_ref parse_json;
+    napi_ref stringify_json;
+  } helpers;
+};
+
+static inline js__env_t **
+js__get_envs(void) {
+  static JS__THREAD_LOCAL js__env_t *envs = NULL;
+
+  return &envs;
+}
+
+static inline void
+js__on_env_teardown(void *data) {
+  js__env_t *state = (js__env_t *) data;
+
+  js__env_t **next = js__get_envs();
+
+  while (*next && *next != state) next = &(*next)->next;
+
+  if (*next) *next = state->next;
+
+  free(state->scratch.data);
+
+  if (state->external_memory.check) {
+    uv_check_stop(state->external_memory.check);
+
+    uv_close((uv_handle_t *) state->external_memory.check, (uv_close_cb) free);
+  }
+
+  js__external_memory_entry_t *entry = state->external_memory.entry;
+
+  if (entry) {
+    entry->state = NULL;
+
+    if (--entry->refs == 0) free(entry);
+  }
+
+  if (state->tasks.running) {
+    js__task_teardown_t *teardown = (js__task_teardown_t *) malloc(sizeof(js__task_teardown_t));
+
+    if (teardown) {
+      teardown->handle = state->tasks.teardown;
+      teardown->refs = 0;
+    }
+
+    for (js_task_t *task = state->tasks.running; task; task = task->next) {
+      task->state = NULL;
+      task->teardown = teardown;
+
+      if (teardown) teardown->refs++;
+    }
+
+#if NAPI_VERSION >= 8
+    if (teardown == NULL && state->tasks.teardown) napi_remove_async_cleanup_hook(state->tasks.teardown);
+#endif
+  }
+
+  while (state->tasks.completed) {
+    js_task_t *task = state->tasks.completed;
+
+    state->tasks.completed = task->next;
+
+    task->complete(NULL, task->cancelled, task->data);
+
+    free(task);
+  }
+
+  if (state->tasks.check) {
+    uv_check_stop(state->tasks.check);
+
+    uv_close((uv_handle_t *) state->tasks.check, (uv_close_cb) free);
+  }
+
+  while (state->string_views.pool) {
+    js__string_view_t *view = state->string_views.pool;
+
+    state->string_views.pool = view->next;
+
+    free(view);
+  }
+
+#ifdef JS__STRING_VIEW_CACHE
+  for (size_t i = 0; i < JS__STRING_VIEW_CACHE; i++) {
+    js__string_view_t *view = state->string_views.cache[i];
+
+    if (view && --view->refs == 0) free(view);
+  }
+#endif
+
+#ifdef JS__PROPERTY_KEY_CACHE
+  for (size_t i = 0; i < JS__PROPERTY_KEY_CACHE; i++) {
+    free(state->property_keys.cache[i].name);
+  }
+#endif
+
+  free(state);
+}
+
+static inline js__env_t *
+js__get_env(js_env_t *env) {
+  js__env_t **envs = js__get_envs();
+
+  js__env_t *state = *envs;
+
+  if (state && state->env == env) return state;
+
+  for (js__env_t **next = envs; *next; next = &(*next)->next) {
+    state = *next;
+
+    if (state->env == env) {
+      *next = state->next;
+
+      state->next = *envs;
+      *envs = state;
+
+      return state;
+    }
+  }
+
+  state = (js__env_t *) calloc(1, sizeof(js__env_t));
+
+  if (state == NULL) return NULL;
+
+  state->env = env;
+  state->next = *envs;
+  *envs = state;
+
+#if NAPI_VERSION >= 3
+  napi_add_env_cleanup_hook(env, js__on_env_teardown, state);
+#endif
+
+  return state;
+}
+
+static inline void *
+js__scratch_alloc(js__env_t *state, size_t len) {
+  size_t size = JS__SCRATCH_ALIGNMENT + ((len + JS__SCRATCH_ALIGNMENT - 1) & ~((size_t) JS__SCRATCH_ALIGNMENT - 1));
+
+  char *block = NULL;
+
+  if (state) {
+    if (state->scratch.high_water_mark < state->scratch.len + size) {
+      state->scratch.high_water_mark = state->scratch.len + size;
+    }
+
+    if (state->scratch.data == NULL) {
+      state->scratch.data = (char *) malloc(JS_SCRATCH_SIZE);
+
+      if (state->scratch.data) state->scratch.size = JS_SCRATCH_SIZE;
+    }
+
+    if (state->scratch.len + size <= state->scratch.size) {
+      block = &state->scratch.data[state->scratch.len];
+
+      state->scratch.len += size;
+      state->scratch.refs++;
+
+      *((size_t *) block) = size;
+
+      return block + JS__SCRATCH_ALIGNMENT;
+    }
+
+    state->scratch.overflows++;
+  }
+
+  block = (char *) malloc(size);
+
+  if (block == NULL) return NULL;
+
+  *((size_t *) block) = 0;
+
+  return block + JS__SCRATCH_ALIGNMENT;
+}
+
+static inline void
+js__scratch_free(js__env_t *state, void *ptr) {
+  if (ptr == NULL) return;
+
+  char *block = (char *) ptr - JS__SCRATCH_ALIGNMENT;
+
+  size_t size = *((size_t *) block);
+
+  if (size == 0) {
+    free(block);
+
+    return;
+  }
+
+  if (--state->scratch.refs == 0) state->scratch.len = 0;
+  else if (block + size == &state->scratch.data[state->scratch.len]) {
+    state->scratch.len -= size;
+  }
+}
+
+static inline js__string_view_t *
+js__acquire_string_view(js__env_t *state, size_t size) {
+  if (state) {
+    js__string_view_t **next = &state->string_views.pool;
+
+    while (*next) {
+      js__string_view_t *view = *next;
+
+      if (view->size >= size) {
+        *next = view->next;
+
+        state->string_views.pool_len--;
+
+        view->next = NULL;
+        view->refs = 1;
+
+        return view;
+      }
+
+      next = &view->next;
+    }
+  }
+
+  js__string_view_t *view = (js__string_view_t *) malloc(sizeof(js__string_view_t) + size);
+
+  if (view == NULL) return NULL;
+
+  view->next = NULL;
+  view->size = size;
+  view->refs = 1;
+
+  return view;
+}
+
+static inline void
+js__release_string_view(js__env_t *state, js__string_view_t *view) {
+  if (--view->refs > 0) return;
+
+#ifdef JS__STRING_VIEW_CACHE
+  view->string = NULL;
+#endif
+
+  if (state && state->string_views.pool_len < JS_STRING_VIEW_POOL && view->size <= JS_STRING_VIEW_POOL_MAX_SIZE) {
+    view->next = state->string_views.pool;
+
+    state->string_views.pool = view;
+    state->string_views.pool_len++;
+  } else {
+    free(view);
+  }
+}
+
+static inline napi_status
+js__get_helper(js__env_t *state, napi_ref *ref, const char *source, napi_value *result) {
+  napi_status status;
+
+  js_env_t *env = state->env;
+
+  if (*ref) {
+    status = napi_get_reference_value(env, *ref, result);
+
+    if (status != napi_ok || *result != NULL) return status;
+  }
+
+  napi_value script;
+  status = napi_create_string_utf8(env, source, NAPI_AUTO_LENGTH, &script);
+
+  if (status != napi_ok) return status;
+
+  status = napi_run_script(env, script, result);
+
+  if (status != napi_ok) return status;
+
+  return napi_create_reference(env, *result, 1, ref);
+}
+
+// Marks a helper that couldn't be created, such that it's not attempted again.
+#define JS__HELPER_UNAVAILABLE ((napi_ref) (uintptr_t) 1)
+
+/**
+ * Get a helper that only speeds up an operation that can also be done without
+ * it. If the helper can't be created, such as when the embedder disallows
+ * compiling code from strings, the exception is cleared and `result` is set to
+ * `NULL` for the caller to take its slower path instead. Helpers may also
+ * evaluate to `null` to signal that they're unavailable.
+ */
+static inline napi_status
+js__get_optional_helper(js__env_t *state, napi_ref *ref, const char *source, napi_value *result) {
+  napi_status status;
+
+  js_env_t *env = state->env;
+
+  *result = NULL;
+
+  if (*ref == JS__HELPER_UNAVAILABLE) return napi_ok;
+
+  napi_value helper;
+  status = js__get_helper(state, ref, source, &helper);
+
+  napi_valuetype type = napi_undefined;
+
+  if (status == napi_ok) status = napi_typeof(env, helper, &type);
+
+  if (status == napi_ok && type == napi_function) {
+    *result = helper;
+
+    return napi_ok;
+  }
+
+  bool pending;
+  status = napi_is_exception_pending(env, &pending);
+
+  if (status != napi_ok) return status;
+
+  if (pending) {
+    napi_value error;
+    status = napi_get_and_clear_last_exception(env, &error);
+
+    if (status != napi_ok) return status;
+  }
+
+  if (*ref) napi_delete_reference(env, *ref);
+
+  *ref = JS__HELPER_UNAVAILABLE;
+
+  return napi_ok;
+}
+
+static inline napi_status
+js__flush_external_memory(js__env_t *state) {
+  napi_status status;
+
+  int64_t change_in_bytes = state->external_memory.pending;
+
+  if (change_in_bytes == 0) return napi_ok;
+
+  state->external_memory.pending = 0;
+
+  status = napi_adjust_external_memory(state->env, change_in_bytes, &state->external_memory.engine_total);
+
+  if (status != napi_ok) return status;
+
+  state->external_memory.flushes++;
+
+  return napi_ok;
+}
+
+static inline void
+js__on_external_memory_check(uv_check_t *handle) {
+  js__env_t *state = (js__env_t *) handle->data;
+
+  uv_check_stop(handle);
+
+  js__flush_external_memory(state);
+}
+
+/**
+ * Account for a change in external memory without reporting it to the engine,
+ * which is deferred until the event loop has finished running callbacks. This
+ * is safe to call from finalizers.
+ */
+static inline void
+js__account_external_memory(js__env_t *state, int64_t change_in_bytes) {
+  state->external_memory.total += change_in_bytes;
+  state->external_memory.pending += change_in_bytes;
+  state->external_memory.adjustments++;
+
+#if NAPI_VERSION >= 2
+  uv_check_t *check = state->external_memory.check;
+
+  if (check == NULL) {
+    uv_loop_t *loop;
+
+    if (napi_get_uv_event_loop(state->env, &loop) != napi_ok) return;
+
+    check = (uv_check_t *) malloc(sizeof(uv_check_t));
+
+    if (check == NULL) return;
+
+    uv_check_init(loop, check);
+    uv_unref((uv_handle_t *) check);
+
+    check->data = state;
+
+    state->external_memory.check = check;
+  }
+
+  uv_check_start(check, js__on_external_memory_check);
+#endif
+}
+
+static inline napi_status
+js__adjust_external_memory(js_env_t *env, int64_t change_in_bytes, int64_t *result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) {
+    int64_t adjusted;
+
+    return napi_adjust_external_memory(env, change_in_bytes, result ? result : &adjusted);
+  }
+
+  js__account_external_memory(state, change_in_bytes);
+
+  int64_t pending = state->external_memory.pending;
+
+  if (pending >= JS_EXTERNAL_MEMORY_THRESHOLD || pending <= -JS_EXTERNAL_MEMORY_THRESHOLD) {
+    napi_status status = js__flush_external_memory(state);
+
+    if (status != napi_ok) return status;
+  }
+
+  if (result == NULL) return napi_ok;
+
+  // Ask for the engine total without reporting the pending changes if they've
+  // never been reported.
+  if (state->external_memory.flushes == 0 && state->external_memory.engine_total == 0) {
+    napi_status status = napi_adjust_external_memory(env, 0, &state->external_memory.engine_total);
+
+    if (status != napi_ok) return status;
+  }
+
+  *result = state->external_memory.engine_total + state->external_memory.pending;
+
+  return napi_ok;
+}
+
+static inline napi_status
+js__get_property_key(js_env_t *env, const char *name, napi_value *result) {
+  napi_status status;
+
+#ifdef JS__PROPERTY_KEY_CACHE
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return napi_generic_failure;
+
+  uintptr_t hash = (uintptr_t) name;
+
+  hash ^= hash >> 5 ^ hash >> 11;
+
+  js__property_key_t *entry = &state->property_keys.cache[hash & (JS__PROPERTY_KEY_CACHE - 1)];
+
+  if (entry->address == name && strcmp(entry->name, name) == 0) {
+    status = napi_get_reference_value(env, entry->key, result);
+
+    if (status == napi_ok) {
+      state->property_keys.hits++;
+
+      return status;
+    }
+  }
+
+  state->property_keys.misses++;
+
+  size_t len = strlen(name);
+
+  status = node_api_create_property_key_utf8(env, name, len, result);
+
+  if (status != napi_ok) return status;
+
+  char *copy = (char *) malloc(len + 1);
+
+  if (copy == NULL) return status;
+
+  napi_ref key;
+
+  if (napi_create_reference(env, *result, 1, &key) != napi_ok) {
+    free(copy);
+
+    return status;
+  }
+
+  if (entry->key) napi_delete_reference(env, entry->key);
+
+  free(entry->name);
+
+  memcpy(copy, name, len + 1);
+
+  entry->address = name;
+  entry->name = copy;
+  entry->key = key;
+#else
+  status = napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, result);
+#endif
+
+  return status;
+}
+
+#if NAPI_VERSION >= 2
+
+static inline int
+js_get_env_loop(js_env_t *env, uv_loop_t **result) {
+  napi_status status = napi_get_uv_event_loop(env, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_open_handle_scope(js_env_t *env, js_handle_scope_t **result) {
+  napi_status status = napi_open_handle_scope(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_close_handle_scope(js_env_t *env, js_handle_scope_t *scope) {
+  napi_status status = napi_close_handle_scope(env, scope);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_open_escapable_handle_scope(js_env_t *env, js_escapable_handle_scope_t **result) {
+  napi_status status = napi_open_escapable_handle_scope(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_close_escapable_handle_scope(js_env_t *env, js_escapable_handle_scope_t *scope) {
+  napi_status status = napi_close_escapable_handle_scope(env, scope);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_escape_handle(js_env_t *env, js_escapable_handle_scope_t *scope, js_value_t *escapee, js_value_t **result) {
+  napi_status status = napi_escape_handle(env, scope, escapee, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_run_script(js_env_t *env, const char *file, size_t len, int offset, js_value_t *source, js_value_t **result) {
+  napi_status status = napi_run_script(env, source, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_reference(js_env_t *env, js_value_t *value, uint32_t count, js_ref_t **result) {
+  napi_status status = napi_create_reference(env, value, count, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_delete_reference(js_env_t *env, js_ref_t *reference) {
+  napi_status status = napi_delete_reference(env, reference);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_reference_ref(js_env_t *env, js_ref_t *reference, uint32_t *result) {
+  napi_status status = napi_reference_ref(env, reference, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_reference_unref(js_env_t *env, js_ref_t *reference, uint32_t *result) {
+  napi_status status = napi_reference_unref(env, reference, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_reference_value(js_env_t *env, js_ref_t *reference, js_value_t **result) {
+  napi_status status = napi_get_reference_value(env, reference, result);
+  return js_convert_from_status(status);
+}
+
+static inline void
+js_convert_to_property_descriptors(js_property_descriptor_t const properties[], size_t properties_len, napi_property_descriptor *napi_properties) {
+  for (size_t i = 0; i < properties_len; i++) {
+    const js_property_descriptor_t *property = &properties[i];
+
+    napi_property_descriptor *napi_property = &napi_properties[i];
+
+    napi_property->name = property->name;
+    napi_property->utf8name = NULL;
+
+    napi_property->method = property->method;
+    napi_property->getter = property->getter;
+    napi_property->setter = property->setter;
+    napi_property->value = property->value;
+
+    napi_property->attributes = (napi_property_attributes) property->attributes;
     napi_property->data = property->data;
   }
+}
+
+static inline int
+js_define_class(js_env_t *env, const char *name, size_t len, js_function_cb constructor, void *data, js_property_descriptor_t const properties[], size_t properties_len, js_value_t **result) {
+  napi_property_descriptor stack[JS_SCRATCH_PROPERTY_DESCRIPTORS];
+
+  js__env_t *state = NULL;
+
+  napi_property_descriptor *napi_properties = stack;
+
+  if (properties_len > JS_SCRATCH_PROPERTY_DESCRIPTORS) {
+    state = js__get_env(env);
+
+    napi_properties = (napi_property_descriptor *) js__scratch_alloc(state, sizeof(napi_property_descriptor) * properties_len);
+  }
+
+  js_convert_to_property_descriptors(properties, properties_len, napi_properties);
+
+  napi_status status = napi_define_class(env, name, len, constructor, data, properties_len, napi_properties, result);
+
+  if (napi_properties != stack) js__scratch_free(state, napi_properties);
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_define_properties(js_env_t *env, js_value_t *object, js_property_descriptor_t const properties[], size_t properties_len) {
+  napi_property_descriptor stack[JS_SCRATCH_PROPERTY_DESCRIPTORS];
+
+  js__env_t *state = NULL;
+
+  napi_property_descriptor *napi_properties = stack;
+
+  if (properties_len > JS_SCRATCH_PROPERTY_DESCRIPTORS) {
+    state = js__get_env(env);
+
+    napi_properties = (napi_property_descriptor *) js__scratch_alloc(state, sizeof(napi_property_descriptor) * properties_len);
+  }
+
+  js_convert_to_property_descriptors(properties, properties_len, napi_properties);
+
+  napi_status status = napi_define_properties(env, object, properties_len, napi_properties);
+
+  if (napi_properties != stack) js__scratch_free(state, napi_properties);
+
+  return js_convert_from_status(status);
+}
+
+/**
+ * Initializers for static property tables, which are passed to the engine as
+ * is rather than translated for every definition:
+ *
+ *     static const js_static_property_descriptor_t properties[] = {
+ *       JS_STATIC_METHOD("read", on_read, js_writable | js_configurable, NULL),
+ *       JS_STATIC_ACCESSOR("size", on_size, NULL, js_enumerable, NULL),
+ *     };
+ *
+ * Names are UTF-8 C strings, which the engine internalizes itself. Tables
+ * can't hold values as those only exist within an environment.
+ */
+#define JS_STATIC_METHOD(name, method, attributes, data) \
+  {(name), NULL, (method), NULL, NULL, NULL, (napi_property_attributes) (attributes), (void *) (data)}
+
+#define JS_STATIC_ACCESSOR(name, getter, setter, attributes, data) \
+  {(name), NULL, NULL, (getter), (setter), NULL, (napi_property_attributes) (attributes), (void *) (data)}
+
+/**
+ * Define a class from a static property table, declared using
+ * `JS_STATIC_METHOD()` and `JS_STATIC_ACCESSOR()`, without translating or
+ * copying the table.
+ */
+static inline int
+js_define_static_class(js_env_t *env, const char *name, size_t len, js_function_cb constructor, void *data, js_static_property_descriptor_t const properties[], size_t properties_len, js_value_t **result) {
+  napi_status status = napi_define_class(env, name, len, constructor, data, properties_len, properties, result);
+  return js_convert_from_status(status);
+}
+
+/**
+ * Define properties on an object from a static property table without
+ * translating or copying the table.
+ */
+static inline int
+js_define_static_properties(js_env_t *env, js_value_t *object, js_static_property_descriptor_t const properties[], size_t properties_len) {
+  napi_status status = napi_define_properties(env, object, properties_len, properties);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_wrap(js_env_t *env, js_value_t *object, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_ref_t **result) {
+  napi_status status = napi_wrap(env, object, data, finalize_cb, finalize_hint, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_unwrap(js_env_t *env, js_value_t *object, void **result) {
+  napi_status status = napi_unwrap(env, object, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_remove_wrap(js_env_t *env, js_value_t *object, void **result) {
+  napi_status status = napi_remove_wrap(env, object, result);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 8
+
+static inline int
+js_add_type_tag(js_env_t *env, js_value_t *object, const js_type_tag_t *tag) {
+  napi_type_tag napi_tag = {tag->lower, tag->upper};
+  napi_status status = napi_type_tag_object(env, object, &napi_tag);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_check_type_tag(js_env_t *env, js_value_t *object, const js_type_tag_t *tag, bool *result) {
+  napi_type_tag napi_tag = {tag->lower, tag->upper};
+  napi_status status = napi_check_object_type_tag(env, object, &napi_tag, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+#if NAPI_VERSION >= 5
+
+static inline int
+js_add_finalizer(js_env_t *env, js_value_t *object, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_ref_t **result) {
+  napi_status status = napi_add_finalizer(env, object, data, finalize_cb, finalize_hint, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_create_int32(js_env_t *env, int32_t value, js_value_t **result) {
+  napi_status status = napi_create_int32(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_uint32(js_env_t *env, uint32_t value, js_value_t **result) {
+  napi_status status = napi_create_uint32(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_int64(js_env_t *env, int64_t value, js_value_t **result) {
+  napi_status status = napi_create_int64(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_double(js_env_t *env, double value, js_value_t **result) {
+  napi_status status = napi_create_double(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 6
+
+static inline int
+js_create_bigint_int64(js_env_t *env, int64_t value, js_value_t **result) {
+  napi_status status = napi_create_bigint_int64(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_bigint_uint64(js_env_t *env, uint64_t value, js_value_t **result) {
+  napi_status status = napi_create_bigint_uint64(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_bigint_words(js_env_t *env, int sign, const uint64_t *words, size_t len, js_value_t **result) {
+  napi_status status = napi_create_bigint_words(env, sign, len, words, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_create_string_utf8(js_env_t *env, const utf8_t *str, size_t len, js_value_t **result) {
+  napi_status status;
+
+  if (len == (size_t) -1) len = strlen((const char *) str);
+
+  // ASCII is a subset of Latin-1 so pure ASCII input can be copied into a one
+  // byte string without decoding it.
+  if (utf8_is_ascii(str, len)) {
+    status = napi_create_string_latin1(env, (const char *) str, len, result);
+  } else {
+    status = napi_create_string_utf8(env, (const char *) str, len, result);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_string_utf16le(js_env_t *env, const utf16_t *str, size_t len, js_value_t **result) {
+  napi_status status = napi_create_string_utf16(env, str, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_string_latin1(js_env_t *env, const latin1_t *str, size_t len, js_value_t **result) {
+  napi_status status = napi_create_string_latin1(env, (const char *) str, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_external_string_utf8(js_env_t *env, utf8_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_external_string_latin1) {
+    if (len == (size_t) -1) len = strlen((const char *) str);
+
+    // ASCII is a subset of Latin-1 so pure ASCII input can be handed to the
+    // engine without transcoding.
+    if (utf8_is_ascii(str, len)) {
+      napi_status status = api->create_external_string_latin1(env, (char *) str, len, finalize_cb, finalize_hint, result, copied);
+      return js_convert_from_status(status);
+    }
+  }
+
+  if (copied) *copied = true;
+
+  napi_status status = napi_create_string_utf8(env, (const char *) str, len, result);
+
+  if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_external_string_utf16le(js_env_t *env, utf16_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_external_string_utf16) {
+    status = api->create_external_string_utf16(env, str, len, finalize_cb, finalize_hint, result, copied);
+  } else {
+    if (copied) *copied = true;
+
+    status = napi_create_string_utf16(env, str, len, result);
+
+    if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_external_string_latin1(js_env_t *env, latin1_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_external_string_latin1) {
+    status = api->create_external_string_latin1(env, (char *) str, len, finalize_cb, finalize_hint, result, copied);
+  } else {
+    if (copied) *copied = true;
+
+    status = napi_create_string_latin1(env, (char *) str, len, result);
+
+    if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_property_key_utf8(js_env_t *env, const utf8_t *str, size_t len, js_value_t **result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_property_key_utf8) {
+    status = api->create_property_key_utf8(env, (const char *) str, len, result);
+  } else {
+    status = napi_create_string_utf8(env, (const char *) str, len, result);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_property_key_utf16le(js_env_t *env, const utf16_t *str, size_t len, js_value_t **result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_property_key_utf16) {
+    status = api->create_property_key_utf16(env, str, len, result);
+  } else {
+    status = napi_create_string_utf16(env, str, len, result);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_property_key_latin1(js_env_t *env, const latin1_t *str, size_t len, js_value_t **result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_property_key_latin1) {
+    status = api->create_property_key_latin1(env, (const char *) str, len, result);
+  } else {
+    status = napi_create_string_latin1(env, (const char *) str, len, result);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_symbol(js_env_t *env, js_value_t *description, js_value_t **result) {
+  napi_status status = napi_create_symbol(env, description, result);
+  return js_convert_from_status(status);
+}
+
+static inline napi_status
+js__get_global_function(napi_env env, const char *name, napi_value *result) {
+  napi_status status;
+
+  napi_value global;
+  status = napi_get_global(env, &global);
+
+  if (status != napi_ok) return status;
+
+  return napi_get_named_property(env, global, name, result);
+}
+
+static inline int
+js_symbol_for(js_env_t *env, const char *description, size_t len, js_value_t **result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->symbol_for) {
+    status = api->symbol_for(env, description, len, result);
+  } else {
+    napi_value symbol;
+    status = js__get_global_function(env, "Symbol", &symbol);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    napi_value function;
+    status = napi_get_named_property(env, symbol, "for", &function);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    napi_value key;
+    status = napi_create_string_utf8(env, description, len, &key);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    status = napi_call_function(env, symbol, function, 1, &key, result);
+  }
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_object(js_env_t *env, js_value_t **result) {
+  napi_status status = napi_create_object(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_function(js_env_t *env, const char *name, size_t len, js_function_cb cb, void *data, js_value_t **result) {
+  napi_status status = napi_create_function(env, name, len, cb, data, result);
+  return js_convert_from_status(status);
+}
+
+#ifndef JS_TYPED_FUNCTION_MAX_ARGS
+#define JS_TYPED_FUNCTION_MAX_ARGS 4
+#endif
+
+#if defined(JS_TYPED_FUNCTION_TRAMPOLINE) && (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) || defined(_M_ARM64)) && NAPI_VERSION >= 5
+#define JS__TYPED_FUNCTION_TRAMPOLINE
+#endif
+
+#ifdef JS__TYPED_FUNCTION_TRAMPOLINE
+
+// The number of arguments, including the receiver, that `JS__TYPED_CALL()` has
+// casts for. Functions taking more always use the untyped callback.
+#define JS__TYPED_CALL_MAX_ARGS 4
+
+typedef struct js__typed_function_s js__typed_function_t;
+typedef struct js__typed_callback_info_s js__typed_callback_info_t;
+typedef union js__typed_value_u js__typed_value_t;
+
+/**
+ * Typed functions are called through a trampoline that unmarshals arguments
+ * straight into native types and calls the function at `address`. On the
+ * supported 64-bit targets every integer and pointer argument is passed in a
+ * general purpose register and every double in a floating point register, so a
+ * call only depends on the register class of each argument. The `shape` of a
+ * function encodes the number of arguments and which of them are doubles, and
+ * selects one of the casts generated by `JS__TYPED_CALL()`.
+ */
+struct js__typed_function_s {
+  js_function_cb cb;
+  const void *address;
+  void *data;
+  int result;
+  size_t args_len;
+  int args[JS_TYPED_FUNCTION_MAX_ARGS];
+  int shape;
+};
+
+struct js__typed_callback_info_s {
+  js_env_t *env;
+  void *data;
+};
+
+union js__typed_value_u {
+  int64_t i;
+  double d;
+};
+
+#define JS__TYPED_CALL(R, assign, function, args, info) \
+  switch ((function)->shape) { \
+  case 0 << 8 | 0: \
+    assign((R (*)(void *)) function->address)(info); \
+    break; \
+  case 1 << 8 | 0: \
+    assign((R (*)(int64_t, void *)) function->address)(args[0].i, info); \
+    break; \
+  case 1 << 8 | 1: \
+    assign((R (*)(double, void *)) function->address)(args[0].d, info); \
+    break; \
+  case 2 << 8 | 0: \
+    assign((R (*)(int64_t, int64_t, void *)) function->address)(args[0].i, args[1].i, info); \
+    break; \
+  case 2 << 8 | 1: \
+    assign((R (*)(double, int64_t, void *)) function->address)(args[0].d, args[1].i, info); \
+    break; \
+  case 2 << 8 | 2: \
+    assign((R (*)(int64_t, double, void *)) function->address)(args[0].i, args[1].d, info); \
+    break; \
+  case 2 << 8 | 3: \
+    assign((R (*)(double, double, void *)) function->address)(args[0].d, args[1].d, info); \
+    break; \
+  case 3 << 8 | 0: \
+    assign((R (*)(int64_t, int64_t, int64_t, void *)) function->address)(args[0].i, args[1].i, args[2].i, info); \
+    break; \
+  case 3 << 8 | 1: \
+    assign((R (*)(double, int64_t, int64_t, void *)) function->address)(args[0].d, args[1].i, args[2].i, info); \
+    break; \
+  case 3 << 8 | 2: \
+    assign((R (*)(int64_t, double, int64_t, void *)) function->address)(args[0].i, args[1].d, args[2].i, info); \
+    break; \
+  case 3 << 8 | 3: \
+    assign((R (*)(double, double, int64_t, void *)) function->address)(args[0].d, args[1].d, args[2].i, info); \
+    break; \
+  case 3 << 8 | 4: \
+    assign((R (*)(int64_t, int64_t, double, void *)) function->address)(args[0].i, args[1].i, args[2].d, info); \
+    break; \
+  case 3 << 8 | 5: \
+    assign((R (*)(double, int64_t, double, void *)) function->address)(args[0].d, args[1].i, args[2].d, info); \
+    break; \
+  case 3 << 8 | 6: \
+    assign((R (*)(int64_t, double, double, void *)) function->address)(args[0].i, args[1].d, args[2].d, info); \
+    break; \
+  case 3 << 8 | 7: \
+    assign((R (*)(double, double, double, void *)) function->address)(args[0].d, args[1].d, args[2].d, info); \
+    break; \
+  case 4 << 8 | 0: \
+    assign((R (*)(int64_t, int64_t, int64_t, int64_t, void *)) function->address)(args[0].i, args[1].i, args[2].i, args[3].i, info); \
+    break; \
+  case 4 << 8 | 1: \
+    assign((R (*)(double, int64_t, int64_t, int64_t, void *)) function->address)(args[0].d, args[1].i, args[2].i, args[3].i, info); \
+    break; \
+  case 4 << 8 | 2: \
+    assign((R (*)(int64_t, double, int64_t, int64_t, void *)) function->address)(args[0].i, args[1].d, args[2].i, args[3].i, info); \
+    break; \
+  case 4 << 8 | 3: \
+    assign((R (*)(double, double, int64_t, int64_t, void *)) function->address)(args[0].d, args[1].d, args[2].i, args[3].i, info); \
+    break; \
+  case 4 << 8 | 4: \
+    assign((R (*)(int64_t, int64_t, double, int64_t, void *)) function->address)(args[0].i, args[1].i, args[2].d, args[3].i, info); \
+    break; \
+  case 4 << 8 | 5: \
+    assign((R (*)(double, int64_t, double, int64_t, void *)) function->address)(args[0].d, args[1].i, args[2].d, args[3].i, info); \
+    break; \
+  case 4 << 8 | 6: \
+    assign((R (*)(int64_t, double, double, int64_t, void *)) function->address)(args[0].i, args[1].d, args[2].d, args[3].i, info); \
+    break; \
+  case 4 << 8 | 7: \
+    assign((R (*)(double, double, double, int64_t, void *)) function->address)(args[0].d, args[1].d, args[2].d, args[3].i, info); \
+    break; \
+  case 4 << 8 | 8: \
+    assign((R (*)(int64_t, int64_t, int64_t, double, void *)) function->address)(args[0].i, args[1].i, args[2].i, args[3].d, info); \
+    break; \
+  case 4 << 8 | 9: \
+    assign((R (*)(double, int64_t, int64_t, double, void *)) function->address)(args[0].d, args[1].i, args[2].i, args[3].d, info); \
+    break; \
+  case 4 << 8 | 10: \
+    assign((R (*)(int64_t, double, int64_t, double, void *)) function->address)(args[0].i, args[1].d, args[2].i, args[3].d, info); \
+    break; \
+  case 4 << 8 | 11: \
+    assign((R (*)(double, double, int64_t, double, void *)) function->address)(args[0].d, args[1].d, args[2].i, args[3].d, info); \
+    break; \
+  case 4 << 8 | 12: \
+    assign((R (*)(int64_t, int64_t, double, double, void *)) function->address)(args[0].i, args[1].i, args[2].d, args[3].d, info); \
+    break; \
+  case 4 << 8 | 13: \
+    assign((R (*)(double, int64_t, double, double, void *)) function->address)(args[0].d, args[1].i, args[2].d, args[3].d, info); \
+    break; \
+  case 4 << 8 | 14: \
+    assign((R (*)(int64_t, double, double, double, void *)) function->address)(args[0].i, args[1].d, args[2].d, args[3].d, info); \
+    break; \
+  case 4 << 8 | 15: \
+    assign((R (*)(double, double, double, double, void *)) function->address)(args[0].d, args[1].d, args[2].d, args[3].d, info); \
+    break; \
+  }
+
+static inline bool
+js__typed_function_supports(int type, bool result) {
+  switch (type) {
+  case js_undefined:
+    return result;
+  case js_null:
+  case js_string:
+  case js_symbol:
+  case js_object:
+  case js_function:
+  case js_external:
+  case js_bigint:
+    return !result;
+  case js_boolean:
+  case js_int8:
+  case js_uint8:
+  case js_int16:
+  case js_uint16:
+  case js_int32:
+  case js_uint32:
+  case js_int64:
+  case js_uint64:
+  case js_float64:
+    return true;
+#if NAPI_VERSION >= 6
+  case js_bigint64:
+  case js_biguint64:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+static inline napi_status
+js__typed_function_unmarshall_integer(napi_env env, napi_value value, double min, double max, js__typed_value_t *result) {
+  double number;
+  napi_status status = napi_get_value_double(env, value, &number);
+
+  if (status != napi_ok) return status;
+
+  // Numbers that aren't integers representable in the type would have to be
+  // truncated or wrapped.
+  if (number != floor(number) || number < min || number > max) return napi_number_expected;
+
+  result->i = number < 9223372036854775808.0 ? (int64_t) number : (int64_t) (uint64_t) number;
+
+  return napi_ok;
+}
+
+static inline napi_status
+js__typed_function_unmarshall(napi_env env, int type, napi_value value, js__typed_value_t *result) {
+  napi_status status = napi_ok;
+
+  switch (type) {
+  case js_boolean: {
+    bool boolean;
+    status = napi_get_value_bool(env, value, &boolean);
+    result->i = boolean;
+    break;
+  }
+  case js_int8:
+    return js__typed_function_unmarshall_integer(env, value, INT8_MIN, INT8_MAX, result);
+  case js_uint8:
+    return js__typed_function_unmarshall_integer(env, value, 0, UINT8_MAX, result);
+  case js_int16:
+    return js__typed_function_unmarshall_integer(env, value, INT16_MIN, INT16_MAX, result);
+  case js_uint16:
+    return js__typed_function_unmarshall_integer(env, value, 0, UINT16_MAX, result);
+  case js_int32:
+    return js__typed_function_unmarshall_integer(env, value, INT32_MIN, INT32_MAX, result);
+  case js_uint32:
+    return js__typed_function_unmarshall_integer(env, value, 0, UINT32_MAX, result);
+  case js_int64:
+    return js__typed_function_unmarshall_integer(env, value, -9223372036854775808.0, 9223372036854774784.0, result);
+  case js_uint64:
+    return js__typed_function_unmarshall_integer(env, value, 0, 18446744073709549568.0, result);
+  case js_float64:
+    status = napi_get_value_double(env, value, &result->d);
+    break;
+#if NAPI_VERSION >= 6
+  case js_bigint64: {
+    bool lossless;
+    status = napi_get_value_bigint_int64(env, value, &result->i, &lossless);
+    break;
+  }
+  case js_biguint64: {
+    bool lossless;
+    status = napi_get_value_bigint_uint64(env, value, (uint64_t *) &result->i, &lossless);
+    break;
+  }
+#endif
+  default: {
+    // Values are passed as handles, but only if they are of the declared type.
+    napi_valuetype actual;
+    status = napi_typeof(env, value, &actual);
+
+    if (status != napi_ok) return status;
+
+    bool matches;
+
+    switch (type) {
+    case js_null:
+      matches = actual == napi_null;
+      break;
+    case js_string:
+      matches = actual == napi_string;
+      break;
+    case js_symbol:
+      matches = actual == napi_symbol;
+      break;
+    case js_object:
+      matches = actual == napi_object || actual == napi_function;
+      break;
+    case js_function:
+      matches = actual == napi_function;
+      break;
+    case js_external:
+      matches = actual == napi_external;
+      break;
+    case js_bigint:
+      matches = actual == napi_bigint;
+      break;
+    default:
+      matches = false;
+    }
+
+    if (!matches) return napi_invalid_arg;
+
+    result->i = (int64_t) (intptr_t) value;
+  }
+  }
+
+  return status;
+}
+
+static inline napi_status
+js__typed_function_marshall(napi_env env, int type, js__typed_value_t value, napi_value *result) {
+  switch (type) {
+  case js_boolean:
+    return napi_get_boolean(env, (uint8_t) value.i != 0, result);
+  case js_int8:
+    return napi_create_int32(env, (int8_t) value.i, result);
+  case js_uint8:
+    return napi_create_uint32(env, (uint8_t) value.i, result);
+  case js_int16:
+    return napi_create_int32(env, (int16_t) value.i, result);
+  case js_uint16:
+    return napi_create_uint32(env, (uint16_t) value.i, result);
+  case js_int32:
+    return napi_create_int32(env, (int32_t) value.i, result);
+  case js_uint32:
+    return napi_create_uint32(env, (uint32_t) value.i, result);
+  case js_int64:
+    return napi_create_int64(env, value.i, result);
+  case js_uint64:
+    return napi_create_double(env, (double) (uint64_t) value.i, result);
+  case js_float64:
+    return napi_create_double(env, value.d, result);
+#if NAPI_VERSION >= 6
+  case js_bigint64:
+    return napi_create_bigint_int64(env, value.i, result);
+  case js_biguint64:
+    return napi_create_bigint_uint64(env, (uint64_t) value.i, result);
+#endif
+  default:
+    return napi_get_undefined(env, result);
+  }
+}
+
+static inline napi_value
+js__on_typed_function_call(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  js__typed_function_t *function;
+
+  size_t argc = JS_TYPED_FUNCTION_MAX_ARGS;
+  napi_value argv[JS_TYPED_FUNCTION_MAX_ARGS];
+  napi_value receiver;
+
+  status = napi_get_cb_info(env, info, &argc, argv, &receiver, (void **) &function);
+
+  if (status != napi_ok) return NULL;
+
+  js__typed_value_t args[JS_TYPED_FUNCTION_MAX_ARGS];
+
+  for (size_t i = 0; i < function->args_len; i++) {
+    napi_value value;
+
+    if (i == 0) {
+      // The receiver is implied by the call rather than passed by the caller,
+      // and is undefined for plain calls, so it's passed through as is.
+      args[i].i = (int64_t) (intptr_t) receiver;
+
+      continue;
+    }
+
+    if (i - 1 < argc) value = argv[i - 1];
+    else return function->cb(env, info);
+
+    status = js__typed_function_unmarshall(env, function->args[i], value, &args[i]);
+
+    // Fall back to the untyped callback for arguments that cannot be converted
+    // without coercion, just as the engine would.
+    if (status != napi_ok) return function->cb(env, info);
+  }
+
+  js__typed_callback_info_t typed_info = {env, function->data};
+
+  js__typed_value_t result = {0};
+
+  void *typed = &typed_info;
+
+  if (function->result == js_undefined) {
+    JS__TYPED_CALL(void, , function, args, typed)
+  } else if (function->result == js_float64) {
+    JS__TYPED_CALL(double, result.d =, function, args, typed)
+  } else {
+    JS__TYPED_CALL(int64_t, result.i =, function, args, typed)
+  }
+
+  bool pending;
+  status = napi_is_exception_pending(env, &pending);
+
+  if (status != napi_ok || pending) return NULL;
+
+  napi_value value;
+  status = js__typed_function_marshall(env, function->result, result, &value);
+
+  return status == napi_ok ? value : NULL;
+}
+
+static inline void
+js__on_typed_function_finalize(napi_env env, void *data, void *finalize_hint) {
+  free(data);
+}
+
+#endif
+
+/**
+ * Create a function from both an untyped callback, `cb`, and a typed callback
+ * at `address` described by `signature`. Node-API has no fast calls, so `cb`
+ * is installed as is by default, which is the fastest option. Defining
+ * `JS_TYPED_FUNCTION_TRAMPOLINE` instead calls `address` through a trampoline
+ * that unmarshals the arguments itself, for signatures of at most 3 arguments
+ * besides the receiver and at most `JS_TYPED_FUNCTION_MAX_ARGS` in total. As
+ * it still retrieves the arguments through Node-API, it's only worthwhile if
+ * measured to be, such as by `call/typed_function` in `bench/addon`.
+ */
+static inline int
+js_create_typed_function(js_env_t *env, const char *name, size_t len, js_function_cb cb, const js_callback_signature_t *signature, const void *address, void *data, js_value_t **result) {
+#ifdef JS__TYPED_FUNCTION_TRAMPOLINE
+  bool supported = address != NULL && signature->args_len <= JS_TYPED_FUNCTION_MAX_ARGS && signature->args_len <= JS__TYPED_CALL_MAX_ARGS && js__typed_function_supports(signature->result, true);
+
+  for (size_t i = 0; supported && i < signature->args_len; i++) {
+    supported = js__typed_function_supports(signature->args[i], false);
+  }
+
+  if (supported) {
+    js__typed_function_t *function = (js__typed_function_t *) malloc(sizeof(js__typed_function_t));
+
+    if (function == NULL) return js_create_function(env, name, len, cb, data, result);
+
+    function->cb = cb;
+    function->address = address;
+    function->data = data;
+    function->result = signature->result;
+    function->args_len = signature->args_len;
+    function->shape = (int) signature->args_len << 8;
+
+    for (size_t i = 0; i < signature->args_len; i++) {
+      function->args[i] = signature->args[i];
+
+      if (signature->args[i] == js_float64) function->shape |= 1 << i;
+    }
+
+    napi_status status = napi_create_function(env, name, len, js__on_typed_function_call, function, result);
+
+    if (status == napi_ok) status = napi_add_finalizer(env, *result, function, js__on_typed_function_finalize, NULL, NULL);
+
+    if (status != napi_ok) free(function);
+
+    return js_convert_from_status(status);
+  }
+#endif
+
+  return js_create_function(env, name, len, cb, data, result);
+}
+
+static inline int
+js_create_array(js_env_t *env, js_value_t **result) {
+  napi_status status = napi_create_array(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_array_with_length(js_env_t *env, size_t len, js_value_t **result) {
+  napi_status status = napi_create_array_with_length(env, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_external(js_env_t *env, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result) {
+  napi_status status = napi_create_external(env, data, finalize_cb, finalize_hint, result);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 5
+
+static inline int
+js_create_date(js_env_t *env, double time, js_value_t **result) {
+  napi_status status = napi_create_date(env, time, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_create_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
+  napi_status status = napi_create_error(env, code, message, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_type_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
+  napi_status status = napi_create_type_error(env, code, message, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_range_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
+  napi_status status = napi_create_range_error(env, code, message, result);
+  return js_convert_from_status(status);
+}
+
+static inline napi_status
+js__create_syntax_error(napi_env env, napi_value code, napi_value message, napi_value *result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_syntax_error) return api->create_syntax_error(env, code, message, result);
+
+  napi_value constructor;
+  status = js__get_global_function(env, "SyntaxError", &constructor);
+
+  if (status != napi_ok) return status;
+
+  status = napi_new_instance(env, constructor, 1, &message, result);
+
+  if (status != napi_ok) return status;
+
+  if (code) status = napi_set_named_property(env, *result, "code", code);
+
+  return status;
+}
+
+static inline int
+js_create_syntax_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
+  napi_status status = js__create_syntax_error(env, code, message, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_promise(js_env_t *env, js_deferred_t **deferred, js_value_t **promise) {
+  napi_status status = napi_create_promise(env, deferred, promise);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_resolve_deferred(js_env_t *env, js_deferred_t *deferred, js_value_t *resolution) {
+  napi_status status = napi_resolve_deferred(env, deferred, resolution);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_reject_deferred(js_env_t *env, js_deferred_t *deferred, js_value_t *resolution) {
+  napi_status status = napi_reject_deferred(env, deferred, resolution);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 3
+
+static inline void
+js__settle_task(js_env_t *env, js_task_t *task) {
+  napi_value value = task->complete(env, task->cancelled, task->data);
+
+  if (task->cancelled) {
+    // The outcome of a cancelled task is discarded, including any exception
+    // thrown while completing it.
+    if (value == NULL) napi_get_and_clear_last_exception(env, &value);
+
+    napi_value code, message;
+    napi_create_string_utf8(env, "ECANCELED", NAPI_AUTO_LENGTH, &code);
+    napi_create_string_utf8(env, "Task was cancelled", NAPI_AUTO_LENGTH, &message);
+
+    napi_create_error(env, code, message, &value);
+
+    napi_reject_deferred(env, task->deferred, value);
+  } else if (value == NULL) {
+    napi_get_and_clear_last_exception(env, &value);
+
+    napi_reject_deferred(env, task->deferred, value);
+  } else {
+    napi_resolve_deferred(env, task->deferred, value);
+  }
+}
+
+static inline void
+js__on_task_check(uv_check_t *handle) {
+  js__env_t *state = (js__env_t *) handle->data;
+
+  js_env_t *env = state->env;
+
+  uv_check_stop(handle);
+
+  js_task_t *task = state->tasks.completed;
+
+  state->tasks.completed = state->tasks.completed_tail = NULL;
+
+  if (task == NULL) return;
+
+  state->tasks.batches++;
+
+  // Settle the entire batch within a single callback scope such that the
+  // microtasks queued by the settlements are only run once, when the scope is
+  // closed, rather than after every promise.
+  napi_handle_scope handle_scope;
+  napi_open_handle_scope(env, &handle_scope);
+
+  napi_value resource, name;
+  napi_create_object(env, &resource);
+  napi_create_string_utf8(env, "js_task", NAPI_AUTO_LENGTH, &name);
+
+  napi_async_context context;
+  napi_status status = napi_async_init(env, resource, name, &context);
+
+  napi_callback_scope scope;
+  if (status == napi_ok) status = napi_open_callback_scope(env, resource, context, &scope);
+
+  while (task) {
+    js_task_t *next = task->next;
+
+    js__settle_task(env, task);
+
+    state->tasks.settled++;
+
+    free(task);
+
+    task = next;
+  }
+
+  if (status == napi_ok) {
+    napi_close_callback_scope(env, scope);
+    napi_async_destroy(env, context);
+  }
+
+  napi_close_handle_scope(env, handle_scope);
+}
+
+static inline void
+js__on_task_work(uv_work_t *req) {
+  js_task_t *task = (js_task_t *) req->data;
+
+  task->work(task->data);
+}
+
+static inline void
+js__on_task_after_work(uv_work_t *req, int status) {
+  js_task_t *task = (js_task_t *) req->data;
+
+  js__env_t *state = task->state;
+
+  task->cancelled = status == UV_ECANCELED;
+
+  if (state == NULL) {
+    task->complete(NULL, task->cancelled, task->data);
+
+    js__task_teardown_t *teardown = task->teardown;
+
+    free(task);
+
+    if (teardown && --teardown->refs == 0) {
+#if NAPI_VERSION >= 8
+      if (teardown->handle) napi_remove_async_cleanup_hook(teardown->handle);
+#endif
+
+      free(teardown);
+    }
+
+    return;
+  }
+
+  if (task->prev) task->prev->next = task->next;
+  else state->tasks.running = task->next;
+
+  if (task->next) task->next->prev = task->prev;
+
+#if NAPI_VERSION >= 8
+  if (state->tasks.running == NULL && state->tasks.teardown) {
+    napi_remove_async_cleanup_hook(state->tasks.teardown);
+
+    state->tasks.teardown = NULL;
+  }
+#endif
+
+  if (task->cancelled) state->tasks.cancelled++;
+
+  task->prev = task->next = NULL;
+
+  if (state->tasks.completed_tail) state->tasks.completed_tail->next = task;
+  else state->tasks.completed = task;
+
+  state->tasks.completed_tail = task;
+
+  uv_check_start(state->tasks.check, js__on_task_check);
+}
+
+#if NAPI_VERSION >= 8
+
+static inline void
+js__on_task_teardown(js_deferred_teardown_t *handle, void *data) {
+  js__env_t *state = (js__env_t *) data;
+
+  // Cancel the tasks that haven't started yet rather than wait for them.
+  for (js_task_t *task = state->tasks.running; task; task = task->next) {
+    uv_cancel((uv_req_t *) &task->req);
+  }
+}
+
+#endif
+
+/**
+ * Run `work` on the threadpool and return a promise that's settled on the
+ * JavaScript thread with the value returned by `complete`, or rejected with
+ * the pending exception if it returns `NULL`. Promises of tasks completing in
+ * the same iteration of the event loop are settled together once the loop has
+ * finished running callbacks, sharing a handle scope and a single microtask
+ * checkpoint.
+ *
+ * `complete` is always called, also for cancelled tasks, whose promises are
+ * rejected with an `ECANCELED` error, and with a `NULL` environment if the
+ * environment is torn down before the task has completed, for it to release
+ * `data`. The task may be cancelled until `complete` has been called.
+ */
+static inline int
+js_queue_task(js_env_t *env, js_task_work_cb work, js_task_complete_cb complete, void *data, js_task_t **task, js_value_t **promise) {
+  napi_status status;
+
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  if (state->tasks.check == NULL) {
+    uv_loop_t *loop;
+    status = napi_get_uv_event_loop(env, &loop);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    uv_check_t *check = (uv_check_t *) malloc(sizeof(uv_check_t));
+
+    if (check == NULL) {
+      napi_throw_error(env, NULL, "Out of memory");
+
+      return js_pending_exception;
+    }
+
+    uv_check_init(loop, check);
+    uv_unref((uv_handle_t *) check);
+
+    check->data = state;
+
+    state->tasks.check = check;
+  }
+
+  js_task_t *handle = (js_task_t *) malloc(sizeof(js_task_t));
+
+  if (handle == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+
+    return js_pending_exception;
+  }
+
+  status = napi_create_promise(env, &handle->deferred, promise);
+
+  if (status != napi_ok) {
+    free(handle);
+
+    return js_convert_from_status(status);
+  }
+
+  handle->req.data = handle;
+  handle->state = state;
+  handle->teardown = NULL;
+  handle->prev = NULL;
+  handle->next = state->tasks.running;
+  handle->work = work;
+  handle->complete = complete;
+  handle->data = data;
+  handle->cancelled = false;
+
+  int err = uv_queue_work(state->tasks.check->loop, &handle->req, js__on_task_work, js__on_task_after_work);
+
+  if (err < 0) {
+    // The promise is left pending and collected along with the deferred.
+    free(handle);
+
+    napi_throw_error(env, uv_err_name(err), uv_strerror(err));
+
+    return js_pending_exception;
+  }
+
+  if (state->tasks.running) state->tasks.running->prev = handle;
+
+  state->tasks.running = handle;
+
+#if NAPI_VERSION >= 8
+  // Keep the environment from being torn down for as long as tasks are running.
+  if (state->tasks.teardown == NULL) {
+    napi_add_async_cleanup_hook(env, js__on_task_teardown, state, &state->tasks.teardown);
+  }
+#endif
+
+  state->tasks.queued++;
+
+  if (task) *task = handle;
+
+  return 0;
+}
+
+/**
+ * Cancel a task that hasn't started running yet, setting `result` to whether
+ * it was cancelled. Tasks that are already running always run to completion.
+ */
+static inline int
+js_cancel_task(js_env_t *env, js_task_t *task, bool *result) {
+  int err = uv_cancel((uv_req_t *) &task->req);
+
+  if (result) *result = err == 0;
+
+  return 0;
+}
+
+static inline int
+js_get_task_statistics(js_env_t *env, js_task_statistics_t *result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  result->queued = state->tasks.queued;
+  result->cancelled = state->tasks.cancelled;
+  result->settled = state->tasks.settled;
+  result->batches = state->tasks.batches;
+
+  return 0;
+}
+
+#endif
+
+static inline int
+js_create_arraybuffer(js_env_t *env, size_t len, void **data, js_value_t **result) {
+  napi_status status = napi_create_arraybuffer(env, len, data, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_external_arraybuffer(js_env_t *env, void *data, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result) {
+  napi_status status = napi_create_external_arraybuffer(env, data, len, finalize_cb, finalize_hint, result);
+  return js_convert_from_status(status);
+}
+
+/**
+ * Create an ArrayBuffer without zero filling its memory, which is left
+ * uninitialized for the caller to overwrite. Node-API only offers this for
+ * Node.js buffers, whose backing stores are used for all but small lengths,
+ * where the extra buffer object costs more than clearing the memory.
+ */
+static inline int
+js_create_unsafe_arraybuffer(js_env_t *env, size_t len, void **data, js_value_t **result) {
+  napi_status status;
+
+  if (len < JS_UNSAFE_ARRAYBUFFER_THRESHOLD) {
+    status = napi_create_arraybuffer(env, len, data, result);
+  } else {
+    napi_value buffer;
+    status = napi_create_buffer(env, len, data, &buffer);
+
+    if (status == napi_ok) {
+      status = napi_get_typedarray_info(env, buffer, NULL, NULL, NULL, result, NULL);
+    }
+  }
+
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 7
+
+static inline int
+js_detach_arraybuffer(js_env_t *env, js_value_t *arraybuffer) {
+  napi_status status = napi_detach_arraybuffer(env, arraybuffer);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+/**
+ * SharedArrayBuffers are only partially covered by Node-API, so the remaining
+ * operations go through the built-ins, which are looked up once and cached.
+ * The memory is provided by Node-API from a Uint8Array view of the
+ * SharedArrayBuffer.
+ */
+static inline napi_status
+js__get_cached_global(js__env_t *state, napi_ref *ref, const char *name, napi_value *result) {
+  napi_status status;
+
+  js_env_t *env = state->env;
+
+  if (*ref) {
+    status = napi_get_reference_value(env, *ref, result);
+
+    if (status != napi_ok || *result != NULL) return status;
+  }
+
+  status = js__get_global_function(env, name, result);
+
+  if (status != napi_ok) return status;
+
+  return napi_create_reference(env, *result, 1, ref);
+}
+
+static inline napi_status
+js__get_sharedarraybuffer_view(js_env_t *env, napi_value sharedarraybuffer, void **data, size_t *len) {
+  napi_status status;
+
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return napi_generic_failure;
+
+  napi_value constructor;
+  status = js__get_cached_global(state, &state->helpers.view_sharedarraybuffer, "Uint8Array", &constructor);
+
+  if (status != napi_ok) return status;
+
+  napi_value view;
+  status = napi_new_instance(env, constructor, 1, &sharedarraybuffer, &view);
+
+  if (status != napi_ok) return status;
+
+  return napi_get_typedarray_info(env, view, NULL, len, data, NULL, NULL);
+}
+
+static inline int
+js_create_sharedarraybuffer(js_env_t *env, size_t len, void **data, js_value_t **result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->create_sharedarraybuffer) {
+    status = api->create_sharedarraybuffer(env, len, data, result);
+  } else {
+    js__env_t *state = js__get_env(env);
+
+    if (state == NULL) return js_pending_exception;
+
+    napi_value constructor;
+    status = js__get_cached_global(state, &state->helpers.create_sharedarraybuffer, "SharedArrayBuffer", &constructor);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    napi_value arg;
+    status = napi_create_double(env, (double) len, &arg);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    status = napi_new_instance(env, constructor, 1, &arg, result);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    if (data) status = js__get_sharedarraybuffer_view(env, *result, data, NULL);
+  }
+
+  return js_convert_from_status(status);
+}
+
+/**
+ * Node-API has no way to back a SharedArrayBuffer with memory allocated
+ * elsewhere, so this always throws. Use `js_create_sharedarraybuffer()` and
+ * share its memory with native code instead.
+ */
+static inline int
+js_create_external_sharedarraybuffer(js_env_t *env, void *data, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result) {
+  napi_throw_error(env, NULL, "External SharedArrayBuffers are not supported");
+
+  return js_pending_exception;
+}
+
+typedef struct js__mapping_s js__mapping_t;
+
+struct js__mapping_s {
+  void *data;
+  size_t len;
+};
+
+static const js_type_tag_t js__mapping_type_tag = {0x6a732e6d61707065, 0x642e617272617962};
+
+static inline void
+js__on_mapping_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  js__mapping_t *mapping = (js__mapping_t *) finalize_hint;
+
+#ifdef _WIN32
+  UnmapViewOfFile(mapping->data);
+#else
+  munmap(mapping->data, mapping->len);
+#endif
+
+  js__env_t *state = env ? js__get_env(env) : NULL;
+
+  if (state) js__account_external_memory(state, -(int64_t) mapping->len);
+
+  free(mapping);
+}
+
+static inline int
+js__advise_mapping(void *data, size_t len, js_mapping_advice_t advice) {
+#ifdef _WIN32
+  // Windows has no equivalent of the access pattern hints and only allows
+  // prefetching, which is left to the caller.
+  return 0;
+#else
+  int flag;
+
+  switch (advice) {
+  case js_mapping_advice_normal:
+  default:
+    flag = MADV_NORMAL;
+    break;
+  case js_mapping_advice_random:
+    flag = MADV_RANDOM;
+    break;
+  case js_mapping_advice_sequential:
+    flag = MADV_SEQUENTIAL;
+    break;
+  case js_mapping_advice_will_need:
+    flag = MADV_WILLNEED;
+    break;
+  case js_mapping_advice_dont_need:
+    flag = MADV_DONTNEED;
+    break;
+  }
+
+  // Advice applies to whole pages, so widen the range to page boundaries.
+  uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+
+  uintptr_t start = (uintptr_t) data & ~(page_size - 1);
+  uintptr_t end = ((uintptr_t) data + len + page_size - 1) & ~(page_size - 1);
+
+  if (madvise((void *) start, end - start, flag) != 0) return uv_translate_sys_error(errno);
+
+  return 0;
+#endif
+}
+
+static inline int
+js__map_file(uv_file file, size_t len, js_mapping_mode_t mode, void **result) {
+#ifdef _WIN32
+  HANDLE handle = (HANDLE) uv_get_osfhandle(file);
+
+  HANDLE mapping = CreateFileMappingW(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+  if (mapping == NULL) return uv_translate_sys_error(GetLastError());
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, len);
+
+  // The view keeps the mapping alive.
+  CloseHandle(mapping);
+
+  if (data == NULL) return uv_translate_sys_error(GetLastError());
+#else
+  // Both modes are writable, as writing to a read-only mapping from JavaScript
+  // would crash the process.
+  int flags = MAP_PRIVATE;
+
+#ifdef MAP_NORESERVE
+  if (mode == js_mapping_read_only) flags |= MAP_NORESERVE;
+#endif
+
+  void *data = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, file, 0);
+
+  if (data == MAP_FAILED) return uv_translate_sys_error(errno);
+#endif
+
+  *result = data;
+
+  return 0;
+}
+
+/**
+ * Map the file at `path` into memory and expose it as an external ArrayBuffer
+ * that unmaps the file once garbage collected. The file is never written to
+ * and pages are only read from it as they're accessed, making this suitable
+ * for opening large datasets without reading them up front. The length of the
+ * mapping is reported as external memory for as long as it's mapped.
+ *
+ * If the runtime doesn't allow external ArrayBuffers, the file is instead
+ * copied into a regular ArrayBuffer.
+ */
+static inline int
+js_create_mapped_arraybuffer(js_env_t *env, const char *path, js_mapping_mode_t mode, js_mapping_advice_t advice, void **data, size_t *len, js_value_t **result) {
+  int err;
+
+  uv_fs_t req;
+  err = uv_fs_open(NULL, &req, path, UV_FS_O_RDONLY, 0, NULL);
+  uv_fs_req_cleanup(&req);
+
+  if (err < 0) {
+    napi_throw_error(env, uv_err_name(err), uv_strerror(err));
+
+    return js_pending_exception;
+  }
+
+  uv_file file = err;
+
+  void *mapped = NULL;
+
+  uint64_t size = 0;
+
+  err = uv_fs_fstat(NULL, &req, file, NULL);
+
+  if (err == 0) size = req.statbuf.st_size;
+
+  uv_fs_req_cleanup(&req);
+
+  if (err == 0 && size > SIZE_MAX) err = UV_EFBIG;
+
+  // Empty files can't be mapped.
+  if (err == 0 && size > 0) err = js__map_file(file, (size_t) size, mode, &mapped);
+
+  // The mapping outlives the file descriptor.
+  uv_fs_close(NULL, &req, file, NULL);
+  uv_fs_req_cleanup(&req);
+
+  if (err < 0) {
+    napi_throw_error(env, uv_err_name(err), uv_strerror(err));
+
+    return js_pending_exception;
+  }
+
+  if (len) *len = (size_t) size;
+
+  if (mapped == NULL) return js_create_arraybuffer(env, 0, data, result);
+
+  js__advise_mapping(mapped, (size_t) size, advice);
+
+  js__mapping_t *mapping = (js__mapping_t *) malloc(sizeof(js__mapping_t));
+
+  napi_status status = napi_generic_failure;
+
+  if (mapping) {
+    mapping->data = mapped;
+    mapping->len = (size_t) size;
+
+    status = napi_create_external_arraybuffer(env, mapped, (size_t) size, js__on_mapping_finalize, mapping, result);
+  }
+
+  if (status == napi_ok) {
+    js__adjust_external_memory(env, (int64_t) size, NULL);
+
+#if NAPI_VERSION >= 8
+    napi_type_tag tag = {js__mapping_type_tag.lower, js__mapping_type_tag.upper};
+
+    napi_type_tag_object(env, *result, &tag);
+#endif
+
+    if (data) *data = mapped;
+
+    return 0;
+  }
+
+  free(mapping);
+
+  // External ArrayBuffers aren't allowed, or memory is short, so fall back to
+  // copying the mapping.
+  bool pending;
+  napi_is_exception_pending(env, &pending);
+
+  if (pending == false) {
+    void *copy;
+    err = js_create_unsafe_arraybuffer(env, (size_t) size, &copy, result);
+
+    if (err == 0) {
+      memcpy(copy, mapped, (size_t) size);
+
+      if (data) *data = copy;
+    }
+  } else {
+    err = js_pending_exception;
+  }
+
+#ifdef _WIN32
+  UnmapViewOfFile(mapped);
+#else
+  munmap(mapped, (size_t) size);
+#endif
+
+  return err;
+}
+
+/**
+ * Give the system a hint about how the range of `len` bytes at `offset` in an
+ * ArrayBuffer created by `js_create_mapped_arraybuffer()` will be accessed.
+ * Dropping pages of a copy-on-write mapping discards any writes made to them.
+ */
+static inline int
+js_advise_mapped_arraybuffer(js_env_t *env, js_value_t *arraybuffer, size_t offset, size_t len, js_mapping_advice_t advice) {
+  napi_status status;
+
+#if NAPI_VERSION >= 8
+  // Advising memory that isn't a mapping, such as dropping its pages, would
+  // corrupt it, so only accept mapped ArrayBuffers.
+  napi_type_tag tag = {js__mapping_type_tag.lower, js__mapping_type_tag.upper};
+
+  bool mapped;
+  status = napi_check_object_type_tag(env, arraybuffer, &tag, &mapped);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  if (mapped == false) {
+    napi_throw_type_error(env, NULL, "ArrayBuffer is not a mapped file");
+
+    return js_pending_exception;
+  }
+#else
+  // Without type tags there's no telling whether the memory is a mapping, so
+  // refuse the advice that would destroy its contents if it isn't.
+  if (advice == js_mapping_advice_dont_need) {
+    napi_throw_error(env, NULL, "Dropping pages is not supported");
+
+    return js_pending_exception;
+  }
+#endif
+
+  void *data;
+  size_t data_len;
+  status = napi_get_arraybuffer_info(env, arraybuffer, &data, &data_len);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  if (offset > data_len || len > data_len - offset) {
+    napi_throw_range_error(env, NULL, "Range is out of bounds");
+
+    return js_pending_exception;
+  }
+
+  if (len == 0) return 0;
+
+  int err = js__advise_mapping((char *) data + offset, len, advice);
+
+  if (err < 0) {
+    napi_throw_error(env, uv_err_name(err), uv_strerror(err));
+
+    return js_pending_exception;
+  }
+
+  return 0;
+}
+
+static inline int
+js_create_typedarray(js_env_t *env, js_typedarray_type_t type, size_t len, js_value_t *arraybuffer, size_t offset, js_value_t **result) {
+  napi_status status = napi_create_typedarray(env, js_convert_to_typedarray_type(type), len, arraybuffer, offset, result);
+  return js_convert_from_status(status);
+}
+
+static inline size_t
+js__get_typedarray_element_size(js_typedarray_type_t type) {
+  switch (type) {
+  case js_int8array:
+  case js_uint8array:
+  case js_uint8clampedarray:
+  default:
+    return 1;
+  case js_int16array:
+  case js_uint16array:
+  case js_float16array:
+    return 2;
+  case js_int32array:
+  case js_uint32array:
+  case js_float32array:
+    return 4;
+  case js_float64array:
+  case js_bigint64array:
+  case js_biguint64array:
+    return 8;
+  }
+}
+
+/**
+ * Create a typed array of `len` elements with uninitialized contents. Small
+ * typed arrays are views into a larger, shared ArrayBuffer rather than each
+ * having their own, much like `Buffer.allocUnsafe()`, and so keep the entire
+ * ArrayBuffer alive for as long as they're referenced. Their `offset` is
+ * therefore not necessarily 0 and must be accounted for when accessing the
+ * underlying ArrayBuffer.
+ */
+static inline int
+js_create_pooled_typedarray(js_env_t *env, js_typedarray_type_t type, size_t len, void **data, js_value_t **result) {
+  napi_status status;
+
+  size_t element_size = js__get_typedarray_element_size(type);
+
+  if (len > SIZE_MAX / element_size) {
+    napi_throw_range_error(env, NULL, "Invalid typed array length");
+
+    return js_pending_exception;
+  }
+
+  size_t size = len * element_size;
+
+  js__env_t *state = size < JS_TYPEDARRAY_POOL_SIZE / 2 ? js__get_env(env) : NULL;
+
+  napi_value arraybuffer = NULL;
+
+  size_t offset = 0;
+
+  if (state) {
+    if (state->typedarray_pool.arraybuffer && state->typedarray_pool.offset + size <= state->typedarray_pool.len) {
+      status = napi_get_reference_value(env, state->typedarray_pool.arraybuffer, &arraybuffer);
+
+      if (status != napi_ok) return js_convert_from_status(status);
+
+      // The pool is replaced if it has been detached, such as by transferring
+      // one of the typed arrays viewing it, as its memory is then gone.
+      bool detached;
+#if NAPI_VERSION >= 7
+      status = napi_is_detached_arraybuffer(env, arraybuffer, &detached);
+#else
+      size_t byte_len;
+      status = napi_get_arraybuffer_info(env, arraybuffer, NULL, &byte_len);
+
+      detached = byte_len != state->typedarray_pool.len;
+#endif
+
+      if (status != napi_ok) return js_convert_from_status(status);
+
+      if (detached) arraybuffer = NULL;
+    }
+
+    if (arraybuffer == NULL) {
+      void *pool;
+      int err = js_create_unsafe_arraybuffer(env, JS_TYPEDARRAY_POOL_SIZE, &pool, &arraybuffer);
+      if (err < 0) return err;
+
+      napi_ref ref;
+      status = napi_create_reference(env, arraybuffer, 1, &ref);
+
+      if (status != napi_ok) return js_convert_from_status(status);
+
+      if (state->typedarray_pool.arraybuffer) napi_delete_reference(env, state->typedarray_pool.arraybuffer);
+
+      state->typedarray_pool.arraybuffer = ref;
+      state->typedarray_pool.data = (char *) pool;
+      state->typedarray_pool.len = JS_TYPEDARRAY_POOL_SIZE;
+      state->typedarray_pool.offset = 0;
+    }
+
+    offset = state->typedarray_pool.offset;
+
+    // Keep subsequent views aligned for any element type.
+    state->typedarray_pool.offset += (size + JS__TYPEDARRAY_POOL_ALIGNMENT - 1) & ~((size_t) JS__TYPEDARRAY_POOL_ALIGNMENT - 1);
+
+    if (data) *data = &state->typedarray_pool.data[offset];
+  } else {
+    int err = js_create_unsafe_arraybuffer(env, size, data, &arraybuffer);
+    if (err < 0) return err;
+  }
+
+  status = napi_create_typedarray(env, js_convert_to_typedarray_type(type), len, arraybuffer, offset, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_create_dataview(js_env_t *env, size_t len, js_value_t *arraybuffer, size_t offset, js_value_t **result) {
+  napi_status status = napi_create_dataview(env, len, arraybuffer, offset, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_coerce_to_boolean(js_env_t *env, js_value_t *value, js_value_t **result) {
+  napi_status status = napi_coerce_to_bool(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_coerce_to_number(js_env_t *env, js_value_t *value, js_value_t **result) {
+  napi_status status = napi_coerce_to_number(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_coerce_to_string(js_env_t *env, js_value_t *value, js_value_t **result) {
+  napi_status status = napi_coerce_to_string(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_coerce_to_object(js_env_t *env, js_value_t *value, js_value_t **result) {
+  napi_status status = napi_coerce_to_object(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_typeof(js_env_t *env, js_value_t *value, js_value_type_t *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = js_convert_from_valuetype(napi_type);
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_instanceof(js_env_t *env, js_value_t *object, js_value_t *constructor, bool *result) {
+  napi_status status = napi_instanceof(env, object, constructor, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_undefined(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_undefined;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_null(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_null;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_boolean(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_boolean;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_number(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_number;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_int32(js_env_t *env, js_value_t *value, bool *result) {
+  double integral, number;
+
+  // Fails with `napi_number_expected`, without throwing, if the value is not a
+  // number, saving the separate `napi_typeof()` call.
+  napi_status status = napi_get_value_double(env, value, &number);
+
+  if (status == napi_number_expected) {
+    *result = false;
+
+    return 0;
+  }
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  *result = modf(number, &integral) == 0.0 && integral >= INT32_MIN && integral <= INT32_MAX;
+
+  return 0;
+}
+
+static inline int
+js_is_uint32(js_env_t *env, js_value_t *value, bool *result) {
+  double integral, number;
+
+  // Fails with `napi_number_expected`, without throwing, if the value is not a
+  // number, saving the separate `napi_typeof()` call.
+  napi_status status = napi_get_value_double(env, value, &number);
+
+  if (status == napi_number_expected) {
+    *result = false;
+
+    return 0;
+  }
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  *result = modf(number, &integral) == 0.0 && integral >= 0.0 && integral <= UINT32_MAX;
+
+  return 0;
+}
+
+static inline int
+js_is_string(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_string;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_symbol(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_symbol;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_object(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_object;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_function(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_function;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_array(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_array(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_external(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_external;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_bigint(js_env_t *env, js_value_t *value, bool *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status == napi_ok) *result = napi_type == napi_bigint;
+
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 5
+
+static inline int
+js_is_date(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_date(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_is_error(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_error(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_promise(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_promise(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_arraybuffer(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_arraybuffer(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_is_sharedarraybuffer(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  if (api->is_sharedarraybuffer) {
+    status = api->is_sharedarraybuffer(env, value, result);
+  } else {
+    js__env_t *state = js__get_env(env);
+
+    if (state == NULL) return js_pending_exception;
+
+    // Only SharedArrayBuffers have their byte length read by the getter of the
+    // SharedArrayBuffer prototype, which throws for any other value.
+    napi_value getter;
+    status = napi_ok;
+
+    if (state->helpers.is_sharedarraybuffer) {
+      status = napi_get_reference_value(env, state->helpers.is_sharedarraybuffer, &getter);
+    } else {
+      napi_value constructor, prototype, object, get_own_property_descriptor, name, descriptor;
+
+      status = js__get_global_function(env, "SharedArrayBuffer", &constructor);
+
+      if (status == napi_ok) status = napi_get_named_property(env, constructor, "prototype", &prototype);
+
+      if (status == napi_ok) status = js__get_global_function(env, "Object", &object);
+
+      if (status == napi_ok) status = napi_get_named_property(env, object, "getOwnPropertyDescriptor", &get_own_property_descriptor);
+
+      if (status == napi_ok) status = napi_create_string_utf8(env, "byteLength", NAPI_AUTO_LENGTH, &name);
+
+      if (status == napi_ok) {
+        napi_value argv[2] = {prototype, name};
+
+        status = napi_call_function(env, object, get_own_property_descriptor, 2, argv, &descriptor);
+      }
+
+      if (status == napi_ok) status = napi_get_named_property(env, descriptor, "get", &getter);
+
+      if (status == napi_ok) status = napi_create_reference(env, getter, 1, &state->helpers.is_sharedarraybuffer);
+    }
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    napi_value byte_length;
+    status = napi_call_function(env, value, getter, 0, NULL, &byte_length);
+
+    if (status == napi_pending_exception) {
+      napi_value error;
+      status = napi_get_and_clear_last_exception(env, &error);
+
+      if (status == napi_ok) *result = false;
+
+      return js_convert_from_status(status);
+    }
+
+    if (status == napi_ok) *result = true;
+  }
+
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 7
+
+static inline int
+js_is_detached_arraybuffer(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_detached_arraybuffer(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_is_typedarray(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_typedarray(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js__is_typedarray_of_type(js_env_t *env, js_value_t *value, napi_typedarray_type expected, bool *result) {
+  napi_typedarray_type type;
+
+  // Fails with `napi_invalid_arg`, without throwing, if the value is not a
+  // typed array, saving the separate `napi_is_typedarray()` call.
+  napi_status status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+
+  if (status == napi_invalid_arg && value != NULL) {
+    *result = false;
+
+    return 0;
+  }
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  *result = type == expected;
+
+  return 0;
+}
+
+static inline int
+js_is_int8array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_int8_array, result);
+}
+
+static inline int
+js_is_uint8array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_uint8_array, result);
+}
+
+static inline int
+js_is_uint8clampedarray(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_uint8_clamped_array, result);
+}
+
+static inline int
+js_is_int16array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_int16_array, result);
+}
+
+static inline int
+js_is_uint16array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_uint16_array, result);
+}
+
+static inline int
+js_is_int32array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_int32_array, result);
+}
+
+static inline int
+js_is_uint32array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_uint32_array, result);
+}
+
+static inline int
+js_is_float32array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_float32_array, result);
+}
+
+static inline int
+js_is_float64array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_float64_array, result);
+}
+
+static inline int
+js_is_bigint64array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_bigint64_array, result);
+}
+
+static inline int
+js_is_biguint64array(js_env_t *env, js_value_t *value, bool *result) {
+  return js__is_typedarray_of_type(env, value, napi_biguint64_array, result);
+}
+
+static inline int
+js_is_dataview(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_is_dataview(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_classify_value(js_env_t *env, js_value_t *value, js_value_classification_t *result) {
+  napi_valuetype napi_type;
+
+  napi_status status = napi_typeof(env, value, &napi_type);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  int kind = js_convert_from_valuetype(napi_type);
+
+  switch (napi_type) {
+  case napi_boolean:
+    status = napi_get_value_bool(env, value, &result->boolean);
+    break;
+
+  case napi_number: {
+    status = napi_get_value_double(env, value, &result->number);
+
+    if (status != napi_ok) break;
+
+    double integral;
+
+    if (modf(result->number, &integral) == 0.0) {
+      if (integral >= INT32_MIN && integral <= INT32_MAX) kind |= js_kind_int32;
+      if (integral >= 0.0 && integral <= UINT32_MAX) kind |= js_kind_uint32;
+    }
+
+    break;
+  }
+
+  case napi_object: {
+    // Probe for views and buffers by asking for their info directly, which
+    // fails with `napi_invalid_arg`, without throwing, on a mismatch. A match
+    // therefore costs a single call and extracts the payload at the same time.
+    napi_typedarray_type type;
+    status = napi_get_typedarray_info(env, value, &type, &result->len, &result->data, &result->arraybuffer, &result->offset);
+
+    if (status == napi_ok) {
+      result->typedarray = js_convert_from_typedarray_type(type);
+
+      kind = (0x20 | (result->typedarray + 1)) << 8 | js_object;
+
+      break;
+    }
+
+    if (status != napi_invalid_arg) break;
+
+    status = napi_get_dataview_info(env, value, &result->len, &result->data, &result->arraybuffer, &result->offset);
+
+    if (status == napi_ok) {
+      kind = js_kind_dataview;
+
+      break;
+    }
+
+    if (status != napi_invalid_arg) break;
+
+    status = napi_get_arraybuffer_info(env, value, &result->data, &result->len);
+
+    if (status == napi_ok) {
+      kind = js_kind_arraybuffer;
+
+      break;
+    }
+
+    if (status != napi_invalid_arg) break;
+
+    bool is_array;
+    status = napi_is_array(env, value, &is_array);
+
+    if (status == napi_ok && is_array) kind = js_kind_array;
+
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  result->kind = kind;
+
+  return 0;
+}
+
+static inline int
+js_strict_equals(js_env_t *env, js_value_t *a, js_value_t *b, bool *result) {
+  napi_status status = napi_strict_equals(env, a, b, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_global(js_env_t *env, js_value_t **result) {
+  napi_status status = napi_get_global(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_undefined(js_env_t *env, js_value_t **result) {
+  napi_status status = napi_get_undefined(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_null(js_env_t *env, js_value_t **result) {
+  napi_status status = napi_get_null(env, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_boolean(js_env_t *env, bool value, js_value_t **result) {
+  napi_status status = napi_get_boolean(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_bool(js_env_t *env, js_value_t *value, bool *result) {
+  napi_status status = napi_get_value_bool(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_int32(js_env_t *env, js_value_t *value, int32_t *result) {
+  napi_status status = napi_get_value_int32(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_uint32(js_env_t *env, js_value_t *value, uint32_t *result) {
+  napi_status status = napi_get_value_uint32(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_int64(js_env_t *env, js_value_t *value, int64_t *result) {
+  napi_status status = napi_get_value_int64(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_double(js_env_t *env, js_value_t *value, double *result) {
+  napi_status status = napi_get_value_double(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 6
+
+static inline int
+js_get_value_bigint_int64(js_env_t *env, js_value_t *value, int64_t *result, bool *lossless) {
+  napi_status status = napi_get_value_bigint_int64(env, value, result, lossless);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_bigint_uint64(js_env_t *env, js_value_t *value, uint64_t *result, bool *lossless) {
+  napi_status status = napi_get_value_bigint_uint64(env, value, result, lossless);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_bigint_words(js_env_t *env, js_value_t *value, int *sign, uint64_t *words, size_t len, size_t *result) {
+  size_t count = len;
+
+  napi_status status = napi_get_value_bigint_words(env, value, sign, &count, words);
+
+  if (result) *result = count;
+
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_get_value_string_utf8(js_env_t *env, js_value_t *value, utf8_t *str, size_t len, size_t *result) {
+  napi_status status = napi_get_value_string_utf8(env, value, (char *) str, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_string_utf16le(js_env_t *env, js_value_t *value, utf16_t *str, size_t len, size_t *result) {
+  napi_status status = napi_get_value_string_utf16(env, value, str, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_string_latin1(js_env_t *env, js_value_t *value, latin1_t *str, size_t len, size_t *result) {
+  napi_status status = napi_get_value_string_latin1(env, value, (char *) str, len, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_value_external(js_env_t *env, js_value_t *value, void **result) {
+  napi_status status = napi_get_value_external(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#if NAPI_VERSION >= 5
+
+static inline int
+js_get_value_date(js_env_t *env, js_value_t *value, double *result) {
+  napi_status status = napi_get_date_value(env, value, result);
+  return js_convert_from_status(status);
+}
+
+#endif
+
+static inline int
+js_get_array_length(js_env_t *env, js_value_t *value, uint32_t *result) {
+  napi_status status = napi_get_array_length(env, value, result);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_get_array_elements(js_env_t *env, js_value_t *array, js_value_t **elements, size_t len, size_t offset, uint32_t *result) {
+  uint32_t array_len;
+
+  napi_status status = napi_get_array_length(env, array, &array_len);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  uint32_t written = 0;
+
+  for (size_t i = 0, j = offset; i < len && j < array_len; i++, j++) {
+    status = napi_get_element(env, array, j, &elements[i]);
+
+    if (status != napi_ok) return js_convert_from_status(status);
+
+    written++;
+  }
+
+  if (result) *result = written;
+
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_set_array_elements(js_env_t *env, js_value_t *array, const js_value_t *elements[], size_t len, size_t offset) {
+  napi_status status = napi_ok;
+
+  js__env_t *state = len >= JS_ARRAY_ELEMENTS_BULK_THRESHOLD ? js__get_env(env) : NULL;
+
+  napi_value helper = NULL;
+
+  if (state) {
+    status = js__get_optional_helper(
+      state,
+      &state->helpers.set_array_elements,
+      "(function (array, offset) {"
+      "  for (let i = 2, n = arguments.length; i < n; i++) array[offset + i - 2] = arguments[i]"
+      "})",
+      &helper
+    );
+
+    if (status != napi_ok) return js_convert_from_status(status);
+  }
+
+  if (helper == NULL) {
+    for (size_t i = 0; i < len; i++) {
+      status = napi_set_element(env, array, offset + i, (js_value_t *) elements[i]);
+
+      if (status != napi_ok) break;
+    }
+
+    return js_convert_from_status(status);
+  }
+
+  // Move the elements in chunks, each through a single call into the helper
+  // and under its own handle scope.
+  napi_value *argv = (napi_value *) js__scratch_alloc(state, sizeof(napi_value) * (JS_ARRAY_ELEMENTS_CHUNK + 2));
+
+  if (argv == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+
+    return js_pending_exception;
+  }
+
+  for (size_t i = 0; i < len && status == napi_ok; i += JS_ARRAY_ELEMENTS_CHUNK) {
+    size_t argc = len - i < JS_ARRAY_ELEMENTS_CHUNK ? len - i : JS_ARRAY_ELEMENTS_CHUNK;
+
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+
+    if (status != napi_ok) break;
+
+    argv[0] = array;
+
+    status = napi_create_double(env, (double) (offset + i), &argv[1]);
+
+    if (status == napi_ok) {
+      memcpy(&argv[2], &elements[i], sizeof(napi_value) * argc);
+
+      status = napi_call_function(env, array, helper, argc + 2, argv, NULL);
+    }
+
+    napi_close_handle_scope(env, scope);
+  }
+
+  js__scratch_free(state, argv);
+
+  return js_convert_from_status(status);
+}
+
+/**
+ * Declare the field `field` of the struct `type` for a schema:
+ *
+ *     typedef struct {
+ *       uint32_t id;
+ *       double score;
+ *       char name[32];
+ *     } entry_t;
+ *
+ *     static const js_schema_field_t entry_fields[] = {
+ *       JS_SCHEMA_FIELD(entry_t, id, js_uint32),
+ *       JS_SCHEMA_FIELD(entry_t, score, js_float64),
+ *       JS_SCHEMA_FIELD(entry_t, name, js_string),
+ *     };
+ *
+ *     static const js_schema_t entry_schema = JS_SCHEMA(entry_t, entry_fields);
+ */
+#define JS_SCHEMA_FIELD(type, field, field_type) \
+  {0, #field, (field_type), offsetof(type, field), sizeof(((type *) 0)->field)}
+
+#define JS_SCHEMA(type, fields) \
+  {0, sizeof(type), (fields), sizeof(fields) / sizeof((fields)[0])}
+
+static inline int64_t
+js__schema_truncate(double value) {
+  if (value >= 9223372036854775808.0) return INT64_MAX;
+  if (value < -9223372036854775808.0) return INT64_MIN;
+  if (value != value) return 0;
+
+  return (int64_t) value;
+}
+
+static inline double
+js__schema_load_number(const js_schema_field_t *field, const char *record) {
+  const char *data = &record[field->offset];
+
+  switch (field->type) {
+  case js_boolean:
+    return *(const bool *) data ? 1 : 0;
+  case js_int8:
+    return *(const int8_t *) data;
+  case js_uint8:
+    return *(const uint8_t *) data;
+  case js_int16:
+    return *(const int16_t *) data;
+  case js_uint16:
+    return *(const uint16_t *) data;
+  case js_int32:
+    return *(const int32_t *) data;
+  case js_uint32:
+    return *(const uint32_t *) data;
+  case js_int64:
+    return (double) *(const int64_t *) data;
+  case js_uint64:
+    return (double) *(const uint64_t *) data;
+  case js_float32:
+    return *(const float *) data;
+  case js_float64:
+  default:
+    return *(const double *) data;
+  }
+}
+
+static inline void
+js__schema_store_number(const js_schema_field_t *field, double value, char *record) {
+  char *data = &record[field->offset];
+
+  // Integers wrap around like they do when converted by Node-API.
+  switch (field->type) {
+  case js_boolean:
+    *(bool *) data = value != 0;
+    break;
+  case js_int8:
+    *(int8_t *) data = (int8_t) (uint8_t) js__schema_truncate(value);
+    break;
+  case js_uint8:
+    *(uint8_t *) data = (uint8_t) js__schema_truncate(value);
+    break;
+  case js_int16:
+    *(int16_t *) data = (int16_t) (uint16_t) js__schema_truncate(value);
+    break;
+  case js_uint16:
+    *(uint16_t *) data = (uint16_t) js__schema_truncate(value);
+    break;
+  case js_int32:
+    *(int32_t *) data = (int32_t) (uint32_t) js__schema_truncate(value);
+    break;
+  case js_uint32:
+    *(uint32_t *) data = (uint32_t) js__schema_truncate(value);
+    break;
+  case js_int64:
+    *(int64_t *) data = js__schema_truncate(value);
+    break;
+  case js_uint64:
+    *(uint64_t *) data = value >= 9223372036854775808.0 && value < 18446744073709551616.0 ? (uint64_t) value : (uint64_t) js__schema_truncate(value);
+    break;
+  case js_float32:
+    *(float *) data = (float) value;
+    break;
+  case js_float64:
+  default:
+    *(double *) data = value;
+  }
+}
+
+/**
+ * Whether every field of the schema can be moved as a double, allowing records
+ * to be moved in bulk.
+ */
+static inline bool
+js__schema_is_numeric(const js_schema_t *schema) {
+  for (size_t i = 0; i < schema->fields_len; i++) {
+    int type = schema->fields[i].type;
+
+    if (type == js_string || type == js_bigint64 || type == js_biguint64) return false;
+  }
+
+  return true;
+}
+
+static inline napi_status
+js__schema_encode_field(napi_env env, const js_schema_field_t *field, const char *record, napi_value *result) {
+  const char *data = &record[field->offset];
+
+  switch (field->type) {
+  case js_boolean:
+    return napi_get_boolean(env, *(const bool *) data, result);
+  case js_int8:
+  case js_int16:
+  case js_int32:
+  case js_uint8:
+  case js_uint16:
+    return napi_create_int32(env, (int32_t) js__schema_load_number(field, record), result);
+  case js_uint32:
+    return napi_create_uint32(env, *(const uint32_t *) data, result);
+  case js_int64:
+    return napi_create_int64(env, *(const int64_t *) data, result);
+#if NAPI_VERSION >= 6
+  case js_bigint64:
+    return napi_create_bigint_int64(env, *(const int64_t *) data, result);
+  case js_biguint64:
+    return napi_create_bigint_uint64(env, *(const uint64_t *) data, result);
+#endif
+  case js_string:
+    return napi_create_string_utf8(env, data, strnlen(data, field->size), result);
+  default:
+    return napi_create_double(env, js__schema_load_number(field, record), result);
+  }
+}
+
+static inline napi_status
+js__schema_decode_field(napi_env env, const js_schema_field_t *field, napi_value value, char *record) {
+  napi_status status;
+
+  char *data = &record[field->offset];
+
+  switch (field->type) {
+  case js_boolean:
+    return napi_get_value_bool(env, value, (bool *) data);
+#if NAPI_VERSION >= 6
+  case js_bigint64: {
+    bool lossless;
+    return napi_get_value_bigint_int64(env, value, (int64_t *) data, &lossless);
+  }
+  case js_biguint64: {
+    bool lossless;
+    return napi_get_value_bigint_uint64(env, value, (uint64_t *) data, &lossless);
+  }
+#endif
+  case js_string:
+    return napi_get_value_string_utf8(env, value, data, field->size, NULL);
+  default: {
+    double number;
+    status = napi_get_value_double(env, value, &number);
 
-  napi_status status = napi_define_properties(env, object, properties_len, napi_properties);
-
-  free(napi_properties);
+    if (status == napi_ok) js__schema_store_number(field, number, record);
 
-  return js_convert_from_status(status);
+    return status;
+  }
+  }
 }
 
-static inline int
-js_wrap(js_env_t *env, js_value_t *object, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_ref_t **result) {
-  napi_status status = napi_wrap(env, object, data, finalize_cb, finalize_hint, result);
-  return js_convert_from_status(status);
-}
+static inline napi_status
+js__encode_record(napi_env env, const js_schema_t *schema, const char *record, napi_value *result) {
+  napi_status status = napi_create_object(env, result);
 
-static inline int
-js_unwrap(js_env_t *env, js_value_t *object, void **result) {
-  napi_status status = napi_unwrap(env, object, result);
-  return js_convert_from_status(status);
-}
+  for (size_t i = 0; i < schema->fields_len && status == napi_ok; i++) {
+    const js_schema_field_t *field = &schema->fields[i];
 
-static inline int
-js_remove_wrap(js_env_t *env, js_value_t *object, void **result) {
-  napi_status status = napi_remove_wrap(env, object, result);
-  return js_convert_from_status(status);
-}
+    napi_value key, value;
+    status = js__get_property_key(env, field->name, &key);
 
-#if NAPI_VERSION >= 8
+    if (status == napi_ok) status = js__schema_encode_field(env, field, record, &value);
 
-static inline int
-js_add_type_tag(js_env_t *env, js_value_t *object, const js_type_tag_t *tag) {
-  napi_type_tag napi_tag = {tag->lower, tag->upper};
-  napi_status status = napi_type_tag_object(env, object, &napi_tag);
-  return js_convert_from_status(status);
-}
+    if (status == napi_ok) status = napi_set_property(env, *result, key, value);
+  }
 
-static inline int
-js_check_type_tag(js_env_t *env, js_value_t *object, const js_type_tag_t *tag, bool *result) {
-  napi_type_tag napi_tag = {tag->lower, tag->upper};
-  napi_status status = napi_check_object_type_tag(env, object, &napi_tag, result);
-  return js_convert_from_status(status);
+  return status;
 }
 
-#endif
+static inline napi_status
+js__decode_record(napi_env env, const js_schema_t *schema, napi_value object, char *record) {
+  napi_status status = napi_ok;
 
-#if NAPI_VERSION >= 5
+  for (size_t i = 0; i < schema->fields_len && status == napi_ok; i++) {
+    const js_schema_field_t *field = &schema->fields[i];
 
-static inline int
-js_add_finalizer(js_env_t *env, js_value_t *object, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_ref_t **result) {
-  napi_status status = napi_add_finalizer(env, object, data, finalize_cb, finalize_hint, result);
-  return js_convert_from_status(status);
-}
+    napi_value key, value;
+    status = js__get_property_key(env, field->name, &key);
 
-#endif
+    if (status == napi_ok) status = napi_get_property(env, object, key, &value);
 
-static inline int
-js_create_int32(js_env_t *env, int32_t value, js_value_t **result) {
-  napi_status status = napi_create_int32(env, value, result);
-  return js_convert_from_status(status);
-}
+    if (status == napi_ok) status = js__schema_decode_field(env, field, value, record);
 
-static inline int
-js_create_uint32(js_env_t *env, uint32_t value, js_value_t **result) {
-  napi_status status = napi_create_uint32(env, value, result);
-  return js_convert_from_status(status);
-}
+    if (status != napi_ok) {
+      bool pending;
 
-static inline int
-js_create_int64(js_env_t *env, int64_t value, js_value_t **result) {
-  napi_status status = napi_create_int64(env, value, result);
-  return js_convert_from_status(status);
-}
+      if (napi_is_exception_pending(env, &pending) == napi_ok && !pending) {
+        napi_throw_type_error(env, NULL, field->type == js_boolean ? "Expected a boolean" : field->type == js_string ? "Expected a string" : (field->type == js_bigint64 || field->type == js_biguint64) ? "Expected a bigint" : "Expected a number");
+      }
+    }
+  }
 
-static inline int
-js_create_double(js_env_t *env, double value, js_value_t **result) {
-  napi_status status = napi_create_double(env, value, result);
-  return js_convert_from_status(status);
+  return status;
 }
 
-#if NAPI_VERSION >= 6
+/**
+ * Pass the field names and kinds of a numeric schema to a records helper,
+ * which compiles and caches a function specialised for the schema.
+ */
+static inline napi_status
+js__schema_describe(js__env_t *state, const js_schema_t *schema, napi_value *names, napi_value *kinds) {
+  napi_status status;
 
-static inline int
-js_create_bigint_int64(js_env_t *env, int64_t value, js_value_t **result) {
-  napi_status status = napi_create_bigint_int64(env, value, result);
-  return js_convert_from_status(status);
-}
+  js_env_t *env = state->env;
 
-static inline int
-js_create_bigint_uint64(js_env_t *env, uint64_t value, js_value_t **result) {
-  napi_status status = napi_create_bigint_uint64(env, value, result);
-  return js_convert_from_status(status);
-}
+  size_t names_len = 0;
 
-static inline int
-js_create_bigint_words(js_env_t *env, int sign, const uint64_t *words, size_t len, js_value_t **result) {
-  napi_status status = napi_create_bigint_words(env, sign, len, words, result);
-  return js_convert_from_status(status);
-}
+  for (size_t i = 0; i < schema->fields_len; i++) names_len += strlen(schema->fields[i].name) + 1;
 
-#endif
+  char *buffer = (char *) js__scratch_alloc(state, names_len + schema->fields_len);
 
-static inline int
-js_create_string_utf8(js_env_t *env, const utf8_t *str, size_t len, js_value_t **result) {
-  napi_status status = napi_create_string_utf8(env, (const char *) str, len, result);
-  return js_convert_from_status(status);
-}
+  if (buffer == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
 
-static inline int
-js_create_string_utf16le(js_env_t *env, const utf16_t *str, size_t len, js_value_t **result) {
-  napi_status status = napi_create_string_utf16(env, str, len, result);
-  return js_convert_from_status(status);
-}
+    return napi_pending_exception;
+  }
 
-static inline int
-js_create_string_latin1(js_env_t *env, const latin1_t *str, size_t len, js_value_t **result) {
-  napi_status status = napi_create_string_latin1(env, (const char *) str, len, result);
-  return js_convert_from_status(status);
-}
+  char *kinds_buffer = &buffer[names_len];
 
-static inline int
-js_create_external_string_utf8(js_env_t *env, utf8_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
-  if (copied) *copied = true;
+  for (size_t i = 0, offset = 0; i < schema->fields_len; i++) {
+    const js_schema_field_t *field = &schema->fields[i];
 
-  napi_status status = napi_create_string_utf8(env, (const char *) str, len, result);
+    size_t name_len = strlen(field->name);
 
-  if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
+    memcpy(&buffer[offset], field->name, name_len);
 
-  return js_convert_from_status(status);
-}
+    offset += name_len;
 
-static inline int
-js_create_external_string_utf16le(js_env_t *env, utf16_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
-#if NAPI_VERSION >= 10
-  napi_status status = node_api_create_external_string_utf16(env, str, len, finalize_cb, finalize_hint, result, copied);
-#else
-  if (copied) *copied = true;
+    buffer[offset++] = '\0';
 
-  napi_status status = napi_create_string_utf16(env, str, len, result);
+    kinds_buffer[i] = field->type == js_boolean ? 'b' : 'n';
+  }
 
-  if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
-#endif
-  return js_convert_from_status(status);
-}
+  status = napi_create_string_utf8(env, buffer, names_len - 1 /* Trailing NUL */, names);
 
-static inline int
-js_create_external_string_latin1(js_env_t *env, latin1_t *str, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result, bool *copied) {
-#if NAPI_VERSION >= 10
-  napi_status status = node_api_create_external_string_latin1(env, (char *) str, len, finalize_cb, finalize_hint, result, copied);
-#else
-  if (copied) *copied = true;
+  if (status == napi_ok) status = napi_create_string_latin1(env, kinds_buffer, schema->fields_len, kinds);
 
-  napi_status status = napi_create_string_latin1(env, (char *) str, len, result);
+  js__scratch_free(state, buffer);
 
-  if (status == napi_ok && finalize_cb) finalize_cb(env, str, finalize_hint);
-#endif
-  return js_convert_from_status(status);
+  return status;
 }
 
+/**
+ * Create an object from the struct at `record` described by `schema`. Field
+ * names are interned as property keys once per environment.
+ */
 static inline int
-js_create_property_key_utf8(js_env_t *env, const utf8_t *str, size_t len, js_value_t **result) {
-#if NAPI_VERSION >= 10
-  napi_status status = node_api_create_property_key_utf8(env, (const char *) str, len, result);
-#else
-  napi_status status = napi_create_string_utf8(env, (const char *) str, len, result);
-#endif
+js_encode_record(js_env_t *env, const js_schema_t *schema, const void *record, js_value_t **result) {
+  napi_status status = js__encode_record(env, schema, (const char *) record, result);
   return js_convert_from_status(status);
 }
 
+/**
+ * Fill the struct at `record` described by `schema` from the properties of
+ * `object`. Strings are truncated to fit their character array.
+ */
 static inline int
-js_create_property_key_utf16le(js_env_t *env, const utf16_t *str, size_t len, js_value_t **result) {
-#if NAPI_VERSION >= 10
-  napi_status status = node_api_create_property_key_utf16(env, str, len, result);
-#else
-  napi_status status = napi_create_string_utf16(env, str, len, result);
-#endif
+js_decode_record(js_env_t *env, const js_schema_t *schema, js_value_t *object, void *record) {
+  napi_status status = js__decode_record(env, schema, object, (char *) record);
   return js_convert_from_status(status);
 }
 
+/**
+ * Create an array of objects from the `len` structs at `records` described by
+ * `schema`. Records of schemas without strings or bigints are moved in bulk,
+ * as doubles, to a function specialised for the schema that creates all the
+ * objects from JavaScript.
+ */
 static inline int
-js_create_property_key_latin1(js_env_t *env, const latin1_t *str, size_t len, js_value_t **result) {
-#if NAPI_VERSION >= 10
-  napi_status status = node_api_create_property_key_latin1(env, (const char *) str, len, result);
-#else
-  napi_status status = napi_create_string_latin1(env, (const char *) str, len, result);
-#endif
-  return js_convert_from_status(status);
-}
+js_encode_records(js_env_t *env, const js_schema_t *schema, const void *records, size_t len, js_value_t **result) {
+  napi_status status;
 
-static inline int
-js_create_symbol(js_env_t *env, js_value_t *description, js_value_t **result) {
-  napi_status status = napi_create_symbol(env, description, result);
-  return js_convert_from_status(status);
-}
+  const char *data = (const char *) records;
+
+  js__env_t *state = len > 1 && schema->fields_len > 0 && js__schema_is_numeric(schema) ? js__get_env(env) : NULL;
+
+  napi_value helper = NULL;
+
+  if (state) {
+    status = js__get_optional_helper(
+      state,
+      &state->helpers.encode_records,
+      "(function () {"
+      "  try { new Function('') } catch { return null }"
+      "  const cache = new Map();"
+      "  function compile (names, kinds) {"
+      "    const fields = names.split('\\0'), n = fields.length;"
+      "    let body = 'const result = new Array(count);"
+      "for (let i = 0, j = 0; i < count; i++, j += ' + n + ') result[i] = {';"
+      "    for (let k = 0; k < n; k++) {"
+      "      body += JSON.stringify(fields[k]) + ': values[j + ' + k + ']' + (kinds[k] === 'b' ? ' !== 0,' : ',');"
+      "    }"
+      "    return new Function('values', 'count', body + '};return result')"
+      "  }"
+      "  return function encodeRecords (names, kinds, values, count) {"
+      "    const key = kinds + '\\0' + names;"
+      "    let encode = cache.get(key);"
+      "    if (encode === undefined) cache.set(key, encode = compile(names, kinds));"
+      "    return encode(values, count)"
+      "  }"
+      "})()",
+      &helper
+    );
 
-#if NAPI_VERSION >= 9
+    if (status != napi_ok) return js_convert_from_status(status);
+  }
 
-static inline int
-js_symbol_for(js_env_t *env, const char *description, size_t len, js_value_t **result) {
-  napi_status status = node_api_symbol_for(env, description, len, result);
-  return js_convert_from_status(status);
-}
+  if (helper == NULL) {
+    status = napi_create_array_with_length(env, len, result);
 
-#endif
+    for (size_t i = 0; i < len && status == napi_ok; i++) {
+      napi_handle_scope scope;
+      status = napi_open_handle_scope(env, &scope);
 
-static inline int
-js_create_object(js_env_t *env, js_value_t **result) {
-  napi_status status = napi_create_object(env, result);
-  return js_convert_from_status(status);
-}
+      if (status != napi_ok) break;
 
-static inline int
-js_create_function(js_env_t *env, const char *name, size_t len, js_function_cb cb, void *data, js_value_t **result) {
-  napi_status status = napi_create_function(env, name, len, cb, data, result);
-  return js_convert_from_status(status);
-}
+      napi_value value;
+      status = js__encode_record(env, schema, &data[i * schema->size], &value);
 
-static inline int
-js_create_typed_function(js_env_t *env, const char *name, size_t len, js_function_cb cb, const js_callback_signature_t *signature, const void *address, void *data, js_value_t **result) {
-  return js_create_function(env, name, len, cb, data, result);
-}
+      if (status == napi_ok) status = napi_set_element(env, *result, (uint32_t) i, value);
 
-static inline int
-js_create_array(js_env_t *env, js_value_t **result) {
-  napi_status status = napi_create_array(env, result);
-  return js_convert_from_status(status);
-}
+      napi_close_handle_scope(env, scope);
+    }
 
-static inline int
-js_create_array_with_length(js_env_t *env, size_t len, js_value_t **result) {
-  napi_status status = napi_create_array_with_length(env, len, result);
-  return js_convert_from_status(status);
-}
+    return js_convert_from_status(status);
+  }
 
-static inline int
-js_create_external(js_env_t *env, void *data, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result) {
-  napi_status status = napi_create_external(env, data, finalize_cb, finalize_hint, result);
-  return js_convert_from_status(status);
-}
+  napi_value argv[4];
 
-#if NAPI_VERSION >= 5
+  status = js__schema_describe(state, schema, &argv[0], &argv[1]);
 
-static inline int
-js_create_date(js_env_t *env, double time, js_value_t **result) {
-  napi_status status = napi_create_date(env, time, result);
-  return js_convert_from_status(status);
-}
+  if (status != napi_ok) return js_convert_from_status(status);
 
-#endif
+  size_t values_len = len * schema->fields_len;
+
+  double *values;
+  napi_value arraybuffer;
+  int err = js_create_unsafe_arraybuffer(env, values_len * sizeof(double), (void **) &values, &arraybuffer);
+
+  if (err < 0) return err;
+
+  for (size_t i = 0, k = 0; i < len; i++) {
+    const char *record = &data[i * schema->size];
+
+    for (size_t j = 0; j < schema->fields_len; j++) {
+      values[k++] = js__schema_load_number(&schema->fields[j], record);
+    }
+  }
+
+  status = napi_create_typedarray(env, napi_float64_array, values_len, arraybuffer, 0, &argv[2]);
+
+  if (status == napi_ok) status = napi_create_double(env, (double) len, &argv[3]);
+
+  napi_value receiver;
+
+  if (status == napi_ok) status = napi_get_undefined(env, &receiver);
+
+  if (status == napi_ok) status = napi_call_function(env, receiver, helper, 4, argv, result);
 
-static inline int
-js_create_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
-  napi_status status = napi_create_error(env, code, message, result);
   return js_convert_from_status(status);
 }
 
+/**
+ * Fill the `len` structs at `records` described by `schema` from the first
+ * `len` elements of `array`, in bulk like `js_encode_records()` where possible.
+ * Every element must be an object. If decoding fails, which of the structs
+ * have been filled is unspecified.
+ */
 static inline int
-js_create_type_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
-  napi_status status = napi_create_type_error(env, code, message, result);
-  return js_convert_from_status(status);
+js_decode_records(js_env_t *env, const js_schema_t *schema, js_value_t *array, void *records, size_t len) {
+  napi_status status;
+
+  char *data = (char *) records;
+
+  js__env_t *state = len > 1 && schema->fields_len > 0 && js__schema_is_numeric(schema) ? js__get_env(env) : NULL;
+
+  napi_value helper = NULL;
+
+  if (state) {
+    status = js__get_optional_helper(
+      state,
+      &state->helpers.decode_records,
+      "(function () {"
+      "  try { new Function('') } catch { return null }"
+      "  const cache = new Map();"
+      "  function compile (names, kinds) {"
+      "    const fields = names.split('\\0'), n = fields.length;"
+      "    let body = 'for (let i = 0, j = 0; i < count; i++, j += ' + n + ') {"
+      "const record = records[i]; let value;"
+      "if (record === null || (typeof record !== \\'object\\' && typeof record !== \\'function\\')) throw new TypeError(\\'Expected an object\\');';"
+      "    for (let k = 0; k < n; k++) {"
+      "      const type = kinds[k] === 'b' ? 'boolean' : 'number';"
+      "      body += 'value = record[' + JSON.stringify(fields[k]) + '];"
+      "if (typeof value !== \\'' + type + '\\') throw new TypeError(\\'Expected a ' + type + '\\');"
+      "values[j + ' + k + '] = value;';"
+      "    }"
+      "    return new Function('records', 'values', 'count', body + '}')"
+      "  }"
+      "  return function decodeRecords (names, kinds, records, values, count) {"
+      "    const key = kinds + '\\0' + names;"
+      "    let decode = cache.get(key);"
+      "    if (decode === undefined) cache.set(key, decode = compile(names, kinds));"
+      "    decode(records, values, count)"
+      "  }"
+      "})()",
+      &helper
+    );
+
+    if (status != napi_ok) return js_convert_from_status(status);
+  }
+
+  if (helper == NULL) {
+    status = napi_ok;
+
+    for (size_t i = 0; i < len && status == napi_ok; i++) {
+      napi_handle_scope scope;
+      status = napi_open_handle_scope(env, &scope);
+
+      if (status != napi_ok) break;
+
+      napi_value value;
+      status = napi_get_element(env, array, (uint32_t) i, &value);
+
+      napi_valuetype type;
+
+      if (status == napi_ok) status = napi_typeof(env, value, &type);
+
+      if (status == napi_ok && type != napi_object && type != napi_function) {
+        napi_throw_type_error(env, NULL, "Expected an object");
+
+        status = napi_pending_exception;
+      }
+
+      if (status == napi_ok) status = js__decode_record(env, schema, value, &data[i * schema->size]);
+
+      napi_close_handle_scope(env, scope);
+    }
+
+    return js_convert_from_status(status);
+  }
+
+  napi_value argv[5];
+
+  status = js__schema_describe(state, schema, &argv[0], &argv[1]);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  argv[2] = array;
+
+  size_t values_len = len * schema->fields_len;
+
+  double *values;
+  napi_value arraybuffer;
+  int err = js_create_unsafe_arraybuffer(env, values_len * sizeof(double), (void **) &values, &arraybuffer);
+
+  if (err < 0) return err;
+
+  status = napi_create_typedarray(env, napi_float64_array, values_len, arraybuffer, 0, &argv[3]);
+
+  if (status == napi_ok) status = napi_create_double(env, (double) len, &argv[4]);
+
+  napi_value receiver;
+
+  if (status == napi_ok) status = napi_get_undefined(env, &receiver);
+
+  if (status == napi_ok) status = napi_call_function(env, receiver, helper, 5, argv, NULL);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  for (size_t i = 0, k = 0; i < len; i++) {
+    char *record = &data[i * schema->size];
+
+    for (size_t j = 0; j < schema->fields_len; j++) {
+      js__schema_store_number(&schema->fields[j], values[k++], record);
+    }
+  }
+
+  return 0;
 }
 
 static inline int
-js_create_range_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
-  napi_status status = napi_create_range_error(env, code, message, result);
+js_get_prototype(js_env_t *env, js_value_t *object, js_value_t **result) {
+  napi_status status = napi_get_prototype(env, object, result);
   return js_convert_from_status(status);
 }
 
-#if NAPI_VERSION >= 9
-
 static inline int
-js_create_syntax_error(js_env_t *env, js_value_t *code, js_value_t *message, js_value_t **result) {
-  napi_status status = node_api_create_syntax_error(env, code, message, result);
+js_get_property_names(js_env_t *env, js_value_t *object, js_value_t **result) {
+  napi_status status = napi_get_property_names(env, object, result);
   return js_convert_from_status(status);
 }
 
-#endif
-
 static inline int
-js_create_promise(js_env_t *env, js_deferred_t **deferred, js_value_t **promise) {
-  napi_status status = napi_create_promise(env, deferred, promise);
+js_get_property(js_env_t *env, js_value_t *object, js_value_t *key, js_value_t **result) {
+  napi_status status = napi_get_property(env, object, key, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_resolve_deferred(js_env_t *env, js_deferred_t *deferred, js_value_t *resolution) {
-  napi_status status = napi_resolve_deferred(env, deferred, resolution);
+js_has_property(js_env_t *env, js_value_t *object, js_value_t *key, bool *result) {
+  napi_status status = napi_has_property(env, object, key, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_reject_deferred(js_env_t *env, js_deferred_t *deferred, js_value_t *resolution) {
-  napi_status status = napi_reject_deferred(env, deferred, resolution);
+js_set_property(js_env_t *env, js_value_t *object, js_value_t *key, js_value_t *value) {
+  napi_status status = napi_set_property(env, object, key, value);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_create_arraybuffer(js_env_t *env, size_t len, void **data, js_value_t **result) {
-  napi_status status = napi_create_arraybuffer(env, len, data, result);
+js_delete_property(js_env_t *env, js_value_t *object, js_value_t *key, bool *result) {
+  napi_status status = napi_delete_property(env, object, key, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_create_external_arraybuffer(js_env_t *env, void *data, size_t len, js_finalize_cb finalize_cb, void *finalize_hint, js_value_t **result) {
-  napi_status status = napi_create_external_arraybuffer(env, data, len, finalize_cb, finalize_hint, result);
+js_get_named_property(js_env_t *env, js_value_t *object, const char *name, js_value_t **result) {
+#ifdef JS__PROPERTY_KEY_CACHE
+  napi_value key;
+  napi_status status = js__get_property_key(env, name, &key);
+
+  if (status == napi_ok) status = napi_get_property(env, object, key, result);
+#else
+  napi_status status = napi_get_named_property(env, object, name, result);
+#endif
   return js_convert_from_status(status);
 }
 
-#if NAPI_VERSION >= 7
-
 static inline int
-js_detach_arraybuffer(js_env_t *env, js_value_t *arraybuffer) {
-  napi_status status = napi_detach_arraybuffer(env, arraybuffer);
+js_has_named_property(js_env_t *env, js_value_t *object, const char *name, bool *result) {
+#ifdef JS__PROPERTY_KEY_CACHE
+  napi_value key;
+  napi_status status = js__get_property_key(env, name, &key);
+
+  if (status == napi_ok) status = napi_has_property(env, object, key, result);
+#else
+  napi_status status = napi_has_named_property(env, object, name, result);
+#endif
   return js_convert_from_status(status);
 }
 
+static inline int
+js_set_named_property(js_env_t *env, js_value_t *object, const char *name, js_value_t *value) {
+#ifdef JS__PROPERTY_KEY_CACHE
+  napi_value key;
+  napi_status status = js__get_property_key(env, name, &key);
+
+  if (status == napi_ok) status = napi_set_property(env, object, key, value);
+#else
+  napi_status status = napi_set_named_property(env, object, name, value);
 #endif
+  return js_convert_from_status(status);
+}
 
 static inline int
-js_create_typedarray(js_env_t *env, js_typedarray_type_t type, size_t len, js_value_t *arraybuffer, size_t offset, js_value_t **result) {
-  napi_status status = napi_create_typedarray(env, js_convert_to_typedarray_type(type), len, arraybuffer, offset, result);
+js_delete_named_property(js_env_t *env, js_value_t *object, const char *name, bool *result) {
+  napi_status status;
+
+  napi_value key;
+  status = js__get_property_key(env, name, &key);
+
+  if (status == napi_ok) status = napi_delete_property(env, object, key, result);
+
   return js_convert_from_status(status);
 }
 
 static inline int
-js_create_dataview(js_env_t *env, size_t len, js_value_t *arraybuffer, size_t offset, js_value_t **result) {
-  napi_status status = napi_create_dataview(env, len, arraybuffer, offset, result);
+js_get_element(js_env_t *env, js_value_t *object, uint32_t index, js_value_t **result) {
+  napi_status status = napi_get_element(env, object, index, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_coerce_to_boolean(js_env_t *env, js_value_t *value, js_value_t **result) {
-  napi_status status = napi_coerce_to_bool(env, value, result);
+js_has_element(js_env_t *env, js_value_t *object, uint32_t index, bool *result) {
+  napi_status status = napi_has_element(env, object, index, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_coerce_to_number(js_env_t *env, js_value_t *value, js_value_t **result) {
-  napi_status status = napi_coerce_to_number(env, value, result);
+js_set_element(js_env_t *env, js_value_t *object, uint32_t index, js_value_t *value) {
+  napi_status status = napi_set_element(env, object, index, value);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_coerce_to_string(js_env_t *env, js_value_t *value, js_value_t **result) {
-  napi_status status = napi_coerce_to_string(env, value, result);
+js_delete_element(js_env_t *env, js_value_t *object, uint32_t index, bool *result) {
+  napi_status status = napi_delete_element(env, object, index, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_coerce_to_object(js_env_t *env, js_value_t *value, js_value_t **result) {
-  napi_status status = napi_coerce_to_object(env, value, result);
+js_get_callback_info(js_env_t *env, const js_callback_info_t *info, size_t *argc, js_value_t *argv[], js_value_t **receiver, void **data) {
+  napi_status status = napi_get_cb_info(env, (js_callback_info_t *) info, argc, argv, receiver, data);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_typeof(js_env_t *env, js_value_t *value, js_value_type_t *result) {
-  napi_valuetype napi_type;
+js_get_typed_callback_info(const js_typed_callback_info_t *info, js_env_t **env, void **data) {
+#ifdef JS__TYPED_FUNCTION_TRAMPOLINE
+  const js__typed_callback_info_t *typed_info = (const js__typed_callback_info_t *) info;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  if (env) *env = typed_info->env;
 
-  if (status == napi_ok) *result = js_convert_from_valuetype(napi_type);
+  if (data) *data = typed_info->data;
+#endif
+
+  return 0;
+}
 
+static inline int
+js_get_new_target(js_env_t *env, const js_callback_info_t *info, js_value_t **result) {
+  napi_status status = napi_get_new_target(env, (js_callback_info_t *) info, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_instanceof(js_env_t *env, js_value_t *object, js_value_t *constructor, bool *result) {
-  napi_status status = napi_instanceof(env, object, constructor, result);
+js_get_arraybuffer_info(js_env_t *env, js_value_t *arraybuffer, void **data, size_t *len) {
+  napi_status status = napi_get_arraybuffer_info(env, arraybuffer, data, len);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_is_undefined(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js_get_sharedarraybuffer_info(js_env_t *env, js_value_t *sharedarraybuffer, void **data, size_t *len) {
+  napi_status status;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  bool is_sharedarraybuffer;
+  int err = js_is_sharedarraybuffer(env, sharedarraybuffer, &is_sharedarraybuffer);
+  if (err < 0) return err;
 
-  if (status == napi_ok) *result = napi_type == napi_undefined;
+  if (!is_sharedarraybuffer) {
+    napi_throw_type_error(env, NULL, "Expected a SharedArrayBuffer");
+
+    return js_pending_exception;
+  }
+
+  const js__node_api_t *api = js__get_node_api();
+
+  // Runtimes with native SharedArrayBuffer support also accept them here.
+  if (api->is_sharedarraybuffer) {
+    status = napi_get_arraybuffer_info(env, sharedarraybuffer, data, len);
+  } else {
+    status = js__get_sharedarraybuffer_view(env, sharedarraybuffer, data, len);
+  }
 
   return js_convert_from_status(status);
 }
 
 static inline int
-js_is_null(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js_get_typedarray_info(js_env_t *env, js_value_t *typedarray, js_typedarray_type_t *type, void **data, size_t *len, js_value_t **arraybuffer, size_t *offset) {
+  napi_typedarray_type napi_type;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  napi_status status = napi_get_typedarray_info(env, typedarray, type == NULL ? NULL : &napi_type, len, data, arraybuffer, offset);
 
-  if (status == napi_ok) *result = napi_type == napi_null;
+  if (status == napi_ok && type) *type = js_convert_from_typedarray_type(napi_type);
 
+  return 0;
+}
+
+static inline int
+js_get_dataview_info(js_env_t *env, js_value_t *dataview, void **data, size_t *len, js_value_t **arraybuffer, size_t *offset) {
+  napi_status status = napi_get_dataview_info(env, dataview, len, data, arraybuffer, offset);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_is_boolean(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js_get_string_view(js_env_t *env, js_value_t *string, js_string_encoding_t *encoding, const void **str, size_t *len, js_string_view_t **result) {
+  size_t view_len;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  napi_status status = napi_get_value_string_utf16(env, string, NULL, 0, &view_len);
 
-  if (status == napi_ok) *result = napi_type == napi_boolean;
+  if (status != napi_ok) return js_convert_from_status(status);
 
-  return js_convert_from_status(status);
-}
+  js__env_t *state = js__get_env(env);
 
-static inline int
-js_is_number(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+  js__string_view_t *view = NULL;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+#ifdef JS__STRING_VIEW_CACHE
+  for (size_t i = 0; state && i < JS__STRING_VIEW_CACHE && view == NULL; i++) {
+    js__string_view_t *candidate = state->string_views.cache[i];
 
-  if (status == napi_ok) *result = napi_type == napi_number;
+    if (candidate == NULL || candidate->len != view_len) continue;
 
-  return js_convert_from_status(status);
-}
+    napi_value value;
+    status = napi_get_reference_value(env, candidate->string, &value);
 
-static inline int
-js_is_int32(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+    if (status != napi_ok || value == NULL) continue;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+    bool equal;
+    status = napi_strict_equals(env, string, value, &equal);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    if (status == napi_ok && equal) {
+      view = candidate;
 
-  *result = napi_type == napi_number;
+      view->refs++;
+    }
+  }
+#endif
 
-  if (*result == false) return napi_ok;
+  if (view == NULL) {
+    view = js__acquire_string_view(state, (view_len + 1 /* NULL */) * sizeof(utf16_t));
 
-  double integral, number;
+    if (view == NULL) return js_pending_exception;
 
-  status = napi_get_value_double(env, value, &number);
+    utf16_t *data = (utf16_t *) &view[1];
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    status = napi_get_value_string_utf16(env, string, data, view_len + 1 /* NULL */, NULL);
 
-  *result = modf(number, &integral) == 0.0 && integral >= INT32_MIN && integral <= INT32_MAX;
+    if (status != napi_ok) {
+      js__release_string_view(state, view);
 
-  return napi_ok;
-}
+      return js_convert_from_status(status);
+    }
 
-static inline int
-js_is_uint32(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+    // Narrow in a single pass, widening the narrowed prefix back in the rare
+    // case that the string turns out not to be representable in Latin-1.
+    size_t narrowed = utf16le_convert_to_latin1_prefix(data, view_len, (latin1_t *) data);
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+    if (narrowed == view_len) {
+      ((latin1_t *) data)[view_len] = 0;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+      view->encoding = js_latin1;
+    } else {
+      latin1_convert_to_utf16le((latin1_t *) data, narrowed, data);
 
-  *result = napi_type == napi_number;
+      view->encoding = js_utf16le;
+    }
 
-  if (*result == false) return napi_ok;
+    view->len = view_len;
 
-  double integral, number;
+#ifdef JS__STRING_VIEW_CACHE
+    view->string = NULL;
 
-  status = napi_get_value_double(env, value, &number);
+    if (state && napi_create_reference(env, string, 1, &view->string) == napi_ok) {
+      js__string_view_t **slot = &state->string_views.cache[state->string_views.cache_next];
 
-  if (status != napi_ok) return js_convert_from_status(status);
+      state->string_views.cache_next = (state->string_views.cache_next + 1) % JS__STRING_VIEW_CACHE;
 
-  *result = modf(number, &integral) == 0.0 && integral >= 0.0 && integral <= UINT32_MAX;
+      if (*slot) {
+        napi_delete_reference(env, (*slot)->string);
 
-  return napi_ok;
-}
+        js__release_string_view(state, *slot);
+      }
 
-static inline int
-js_is_string(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+      view->refs++;
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+      *slot = view;
+    }
+#endif
+  }
 
-  if (status == napi_ok) *result = napi_type == napi_string;
+  if (encoding) *encoding = view->encoding;
 
-  return js_convert_from_status(status);
+  if (str) *str = &view[1];
+
+  if (len) *len = view->len;
+
+  *result = (js_string_view_t *) view;
+
+  return 0;
 }
 
 static inline int
-js_is_symbol(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
-
-  napi_status status = napi_typeof(env, value, &napi_type);
+js_release_string_view(js_env_t *env, js_string_view_t *view) {
+  js__release_string_view(js__get_env(env), (js__string_view_t *) view);
 
-  if (status == napi_ok) *result = napi_type == napi_symbol;
+  return 0;
+}
 
+static inline int
+js_call_function(js_env_t *env, js_value_t *receiver, js_value_t *function, size_t argc, js_value_t *const argv[], js_value_t **result) {
+  napi_status status = napi_call_function(env, receiver, function, argc, argv, result);
   return js_convert_from_status(status);
 }
 
+#if NAPI_VERSION >= 3
+
 static inline int
-js_is_object(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js_call_function_with_checkpoint(js_env_t *env, js_value_t *receiver, js_value_t *function, size_t argc, js_value_t *const argv[], js_value_t **result) {
+  napi_status status = napi_make_callback(env, NULL, receiver, function, argc, argv, result);
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  if (status == napi_pending_exception) {
+    napi_status status;
 
-  if (status == napi_ok) *result = napi_type == napi_object;
+    napi_value error;
+    status = napi_get_and_clear_last_exception(env, &error);
+    assert(status == napi_ok);
+
+    status = napi_fatal_exception(env, error);
+    assert(status == napi_ok);
+
+    (void) (status);
+
+    return js_uncaught_exception;
+  }
 
   return js_convert_from_status(status);
 }
 
+#endif
+
 static inline int
-js_is_function(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js_new_instance(js_env_t *env, js_value_t *constructor, size_t argc, js_value_t *const argv[], js_value_t **result) {
+  napi_status status = napi_new_instance(env, constructor, argc, argv, result);
+  return js_convert_from_status(status);
+}
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+/**
+ * Prepare `writer` for writing JSON. The writer doesn't validate the structure
+ * of what's written, which is instead left to `JSON.parse()`, and functions
+ * writing to it only fail, returning -1, if out of memory. Keys and strings
+ * are UTF-8 and may be NUL terminated by passing a length of -1.
+ */
+static inline void
+js_json_writer_init(js_json_writer_t *writer) {
+  writer->data = NULL;
+  writer->len = 0;
+  writer->capacity = 0;
+  writer->separate = false;
+  writer->ascii = true;
+  writer->failed = false;
+}
 
-  if (status == napi_ok) *result = napi_type == napi_function;
+static inline void
+js_json_writer_destroy(js_json_writer_t *writer) {
+  free(writer->data);
 
-  return js_convert_from_status(status);
+  js_json_writer_init(writer);
 }
 
-static inline int
-js_is_array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_array(env, value, result);
-  return js_convert_from_status(status);
+static inline char *
+js__json_reserve(js_json_writer_t *writer, size_t len) {
+  if (writer->failed) return NULL;
+
+  if (writer->len + len > writer->capacity) {
+    size_t capacity = writer->capacity < 256 ? 256 : writer->capacity;
+
+    while (capacity < writer->len + len) capacity *= 2;
+
+    char *data = (char *) realloc(writer->data, capacity);
+
+    if (data == NULL) {
+      writer->failed = true;
+
+      return NULL;
+    }
+
+    writer->data = data;
+    writer->capacity = capacity;
+  }
+
+  return &writer->data[writer->len];
 }
 
 static inline int
-js_is_external(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js__json_write(js_json_writer_t *writer, const char *str, size_t len) {
+  char *data = js__json_reserve(writer, len + 1 /* Separator */);
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  if (data == NULL) return -1;
 
-  if (status == napi_ok) *result = napi_type == napi_external;
+  if (writer->separate) {
+    *data++ = ',';
 
-  return js_convert_from_status(status);
+    writer->len++;
+  }
+
+  memcpy(data, str, len);
+
+  writer->len += len;
+  writer->separate = true;
+
+  return 0;
 }
 
 static inline int
-js_is_bigint(js_env_t *env, js_value_t *value, bool *result) {
-  napi_valuetype napi_type;
+js__json_write_string(js_json_writer_t *writer, const utf8_t *str, size_t len) {
+  static const char hex[] = "0123456789abcdef";
 
-  napi_status status = napi_typeof(env, value, &napi_type);
+  if (len == (size_t) -1) len = strlen((const char *) str);
 
-  if (status == napi_ok) *result = napi_type == napi_bigint;
+  // Reserve for the worst case, every character escaped as \u00XX, up front
+  // such that unescaped runs can be copied without checking for space.
+  char *data = js__json_reserve(writer, len * 6 + 4 /* Separator, quotes, and colon */);
 
-  return js_convert_from_status(status);
-}
+  if (data == NULL) return -1;
 
-#if NAPI_VERSION >= 5
+  char *start = data;
 
-static inline int
-js_is_date(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_date(env, value, result);
-  return js_convert_from_status(status);
+  if (writer->separate) *data++ = ',';
+
+  *data++ = '"';
+
+  size_t run = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    utf8_t c = str[i];
+
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      if (c >= 0x80) writer->ascii = false;
+
+      continue;
+    }
+
+    memcpy(data, &str[run], i - run);
+
+    data += i - run;
+
+    *data++ = '\\';
+
+    switch (c) {
+    case '"':
+    case '\\':
+      *data++ = (char) c;
+      break;
+    case '\n':
+      *data++ = 'n';
+      break;
+    case '\r':
+      *data++ = 'r';
+      break;
+    case '\t':
+      *data++ = 't';
+      break;
+    default:
+      *data++ = 'u';
+      *data++ = '0';
+      *data++ = '0';
+      *data++ = hex[c >> 4];
+      *data++ = hex[c & 0xf];
+    }
+
+    run = i + 1;
+  }
+
+  memcpy(data, &str[run], len - run);
+
+  data += len - run;
+
+  *data++ = '"';
+
+  writer->len += data - start;
+
+  return 0;
 }
 
-#endif
+/**
+ * Write the name of the next property of the current object.
+ */
+static inline int
+js_json_write_key(js_json_writer_t *writer, const utf8_t *key, size_t len) {
+  if (js__json_write_string(writer, key, len) != 0) return -1;
+
+  writer->data[writer->len++] = ':'; // Reserved for the separator
+
+  writer->separate = false;
+
+  return 0;
+}
 
 static inline int
-js_is_error(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_error(env, value, result);
-  return js_convert_from_status(status);
+js_json_write_begin_object(js_json_writer_t *writer) {
+  if (js__json_write(writer, "{", 1) != 0) return -1;
+
+  writer->separate = false;
+
+  return 0;
 }
 
 static inline int
-js_is_promise(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_promise(env, value, result);
-  return js_convert_from_status(status);
+js_json_write_end_object(js_json_writer_t *writer) {
+  writer->separate = false;
+
+  return js__json_write(writer, "}", 1);
 }
 
 static inline int
-js_is_arraybuffer(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_arraybuffer(env, value, result);
-  return js_convert_from_status(status);
-}
+js_json_write_begin_array(js_json_writer_t *writer) {
+  if (js__json_write(writer, "[", 1) != 0) return -1;
 
-#if NAPI_VERSION >= 7
+  writer->separate = false;
 
-static inline int
-js_is_detached_arraybuffer(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_detached_arraybuffer(env, value, result);
-  return js_convert_from_status(status);
+  return 0;
 }
 
-#endif
+static inline int
+js_json_write_end_array(js_json_writer_t *writer) {
+  writer->separate = false;
+
+  return js__json_write(writer, "]", 1);
+}
 
 static inline int
-js_is_typedarray(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
-  return js_convert_from_status(status);
+js_json_write_null(js_json_writer_t *writer) {
+  return js__json_write(writer, "null", 4);
 }
 
 static inline int
-js_is_int8array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+js_json_write_bool(js_json_writer_t *writer, bool value) {
+  return value ? js__json_write(writer, "true", 4) : js__json_write(writer, "false", 5);
+}
 
-  if (status != napi_ok) return js_convert_from_status(status);
+static inline size_t
+js__json_format_integer(uint64_t magnitude, bool negative, char *end) {
+  char *str = end;
 
-  if (*result == false) return napi_ok;
+  do {
+    *--str = (char) ('0' + magnitude % 10);
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+    magnitude /= 10;
+  } while (magnitude);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  if (negative) *--str = '-';
 
-  *result = type == napi_int8_array;
+  return end - str;
+}
 
-  return napi_ok;
+static inline int
+js_json_write_int64(js_json_writer_t *writer, int64_t value) {
+  char str[20];
+
+  size_t len = js__json_format_integer(value < 0 ? 0 - (uint64_t) value : (uint64_t) value, value < 0, &str[sizeof(str)]);
+
+  return js__json_write(writer, &str[sizeof(str) - len], len);
 }
 
+/**
+ * Write a number. Like `JSON.stringify()`, `NaN` and infinities are written as
+ * `null`.
+ */
 static inline int
-js_is_uint8array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+js_json_write_double(js_json_writer_t *writer, double value) {
+  if (value != value || value - value != 0) return js_json_write_null(writer);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  // Integers are by far the most common, and don't need to be formatted as
+  // floating point.
+  if (value >= -9007199254740992.0 && value <= 9007199254740992.0 && value == (double) (int64_t) value) {
+    return js_json_write_int64(writer, (int64_t) value);
+  }
 
-  if (*result == false) return napi_ok;
+  // Numbers with a few decimals, such as amounts and ratios, are written as a
+  // scaled integer if that provably parses back to the same number, which is
+  // far cheaper than formatting them as floating point.
+  static const double scales[] = {1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  for (size_t k = 0; k < sizeof(scales) / sizeof(scales[0]); k++) {
+    double scaled = value * scales[k];
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    if (scaled < -9007199254740992.0 || scaled > 9007199254740992.0) break;
 
-  *result = type == napi_uint8_array;
+    int64_t integer = (int64_t) scaled;
 
-  return napi_ok;
-}
+    if (scaled != (double) integer || (double) integer / scales[k] != value) continue;
 
-static inline int
-js_is_uint8clampedarray(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+    char digits[20];
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    size_t digits_len = js__json_format_integer(integer < 0 ? 0 - (uint64_t) integer : (uint64_t) integer, false, &digits[sizeof(digits)]);
 
-  if (*result == false) return napi_ok;
+    const char *start = &digits[sizeof(digits) - digits_len];
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+    size_t fraction_len = k + 1;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    char str[32];
 
-  *result = type == napi_uint8_clamped_array;
+    size_t len = 0;
 
-  return napi_ok;
-}
+    if (integer < 0) str[len++] = '-';
 
-static inline int
-js_is_int16array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+    if (digits_len > fraction_len) {
+      memcpy(&str[len], start, digits_len - fraction_len);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+      len += digits_len - fraction_len;
+    } else {
+      str[len++] = '0';
+    }
 
-  if (*result == false) return napi_ok;
+    str[len++] = '.';
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+    for (size_t i = digits_len; i < fraction_len; i++) str[len++] = '0';
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    size_t integral_len = digits_len > fraction_len ? digits_len - fraction_len : 0;
 
-  *result = type == napi_int16_array;
+    memcpy(&str[len], &start[integral_len], digits_len - integral_len);
 
-  return napi_ok;
-}
+    len += digits_len - integral_len;
 
-static inline int
-js_is_uint16array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+    // The scaled product may only have been exact at a larger scale than
+    // needed, leaving trailing zeros.
+    while (str[len - 1] == '0') len--;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    return js__json_write(writer, str, len);
+  }
 
-  if (*result == false) return napi_ok;
+  char str[32];
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  int len = snprintf(str, sizeof(str), "%.17g", value);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  if (len < 0) return -1;
 
-  *result = type == napi_uint16_array;
+  // The decimal separator follows the locale of the process.
+  for (int i = 0; i < len; i++) {
+    if (str[i] == ',') str[i] = '.';
+  }
 
-  return napi_ok;
+  return js__json_write(writer, str, (size_t) len);
 }
 
 static inline int
-js_is_int32array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+js_json_write_string_utf8(js_json_writer_t *writer, const utf8_t *str, size_t len) {
+  if (js__json_write_string(writer, str, len) != 0) return -1;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  writer->separate = true;
 
-  if (*result == false) return napi_ok;
+  return 0;
+}
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+static inline void
+js__on_json_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  free(data);
+}
 
-  if (status != napi_ok) return js_convert_from_status(status);
+static inline int
+js__parse_json(js_env_t *env, napi_value string, napi_value *result) {
+  napi_status status;
 
-  *result = type == napi_int32_array;
+  js__env_t *state = js__get_env(env);
 
-  return napi_ok;
-}
+  if (state == NULL) return js_pending_exception;
 
-static inline int
-js_is_uint32array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+  // The built-in is cached such that it's neither looked up on the global
+  // object for every call nor affected by code replacing it later on.
+  napi_value parse;
+  status = js__get_helper(state, &state->helpers.parse_json, "JSON.parse", &parse);
 
   if (status != napi_ok) return js_convert_from_status(status);
 
-  if (*result == false) return napi_ok;
-
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  napi_value receiver;
+  status = napi_get_undefined(env, &receiver);
 
   if (status != napi_ok) return js_convert_from_status(status);
 
-  *result = type == napi_uint32_array;
+  status = napi_call_function(env, receiver, parse, 1, &string, result);
 
-  return napi_ok;
+  return js_convert_from_status(status);
 }
 
+/**
+ * Parse the JSON in `str` into a value with a single call to `JSON.parse()`.
+ */
 static inline int
-js_is_float32array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+js_parse_json(js_env_t *env, const utf8_t *str, size_t len, js_value_t **result) {
+  napi_value string;
+  int err = js_create_string_utf8(env, str, len, &string);
+  if (err < 0) return err;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  return js__parse_json(env, string, result);
+}
 
-  if (*result == false) return napi_ok;
+/**
+ * Parse the JSON written to `writer` into a value with a single call to
+ * `JSON.parse()`. Large ASCII output is handed to the engine as an external
+ * string rather than copied, in which case the writer gives up its buffer. The
+ * writer is reset either way, and can be used for more JSON.
+ */
+static inline int
+js_parse_json_writer(js_env_t *env, js_json_writer_t *writer, js_value_t **result) {
+  int err;
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  if (writer->failed) {
+    js_json_writer_destroy(writer);
 
-  if (status != napi_ok) return js_convert_from_status(status);
+    napi_throw_error(env, NULL, "Out of memory");
 
-  *result = type == napi_float32_array;
+    return js_pending_exception;
+  }
 
-  return napi_ok;
+  napi_value string;
+
+  if (writer->ascii && writer->len >= JS_JSON_EXTERNAL_STRING_THRESHOLD) {
+    err = js_create_external_string_latin1(env, (latin1_t *) writer->data, writer->len, js__on_json_finalize, NULL, &string, NULL);
+
+    // The buffer is owned by the string, or has been freed, from here on.
+    js_json_writer_init(writer);
+  } else {
+    err = js_create_string_utf8(env, (const utf8_t *) writer->data, writer->len, &string);
+
+    writer->len = 0;
+    writer->separate = false;
+    writer->ascii = true;
+  }
+
+  if (err < 0) return err;
+
+  return js__parse_json(env, string, result);
 }
 
+/**
+ * Serialize `value` with `JSON.stringify()` and view the result without
+ * creating an intermediate copy in UTF-8. The view must be released with
+ * `js_release_string_view()`. Values that don't serialize, such as functions
+ * and `undefined`, throw a `TypeError`.
+ */
 static inline int
-js_is_float64array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+js_stringify_json(js_env_t *env, js_value_t *value, js_string_encoding_t *encoding, const void **str, size_t *len, js_string_view_t **result) {
+  napi_status status;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  js__env_t *state = js__get_env(env);
 
-  if (*result == false) return napi_ok;
+  if (state == NULL) return js_pending_exception;
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  napi_value stringify;
+  status = js__get_helper(state, &state->helpers.stringify_json, "JSON.stringify", &stringify);
 
   if (status != napi_ok) return js_convert_from_status(status);
 
-  *result = type == napi_float64_array;
+  napi_value receiver;
+  status = napi_get_undefined(env, &receiver);
 
-  return napi_ok;
-}
+  if (status != napi_ok) return js_convert_from_status(status);
 
-static inline int
-js_is_bigint64array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+  napi_value string;
+  status = napi_call_function(env, receiver, stringify, 1, &value, &string);
 
   if (status != napi_ok) return js_convert_from_status(status);
 
-  if (*result == false) return napi_ok;
-
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+  napi_valuetype type;
+  status = napi_typeof(env, string, &type);
 
   if (status != napi_ok) return js_convert_from_status(status);
 
-  *result = type == napi_bigint64_array;
+  if (type != napi_string) {
+    napi_throw_type_error(env, NULL, "Value is not serializable");
 
-  return napi_ok;
+    return js_pending_exception;
+  }
+
+  return js_get_string_view(env, string, encoding, str, len, result);
 }
 
-static inline int
-js_is_biguint64array(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_typedarray(env, value, result);
+#if NAPI_VERSION >= 7
 
-  if (status != napi_ok) return js_convert_from_status(status);
+typedef struct js__threadsafe_function_s js__threadsafe_function_t;
+typedef struct js__threadsafe_function_cell_s js__threadsafe_function_cell_t;
 
-  if (*result == false) return napi_ok;
+struct js__threadsafe_function_cell_s {
+  size_t sequence;
+  void *data;
+};
 
-  napi_typedarray_type type;
-  status = napi_get_typedarray_info(env, value, &type, NULL, NULL, NULL, NULL);
+/**
+ * The context of a batched threadsafe function, which puts a bounded lock-free
+ * queue in front of the Node-API queue. Producers only wake up the event loop
+ * when the queue goes from idle to scheduled, and the JavaScript thread drains
+ * everything queued by then as a single batch.
+ *
+ * Other threadsafe functions are plain Node-API threadsafe functions, so the
+ * handle of a batched function is its context tagged in the lowest bit.
+ *
+ * The context mirrors the thread count of the function and outlives it for as
+ * long as threads hold on to it or wakeups are queued in Node-API. Calls still
+ * queued once the last of these lets go are delivered with a `NULL`
+ * environment from whichever thread that was. Node-API on the other hand frees
+ * the function right after finalizing it, even if aborted while other threads
+ * still hold on to it, so those must stop calling into Node-API by then.
+ */
+struct js__threadsafe_function_s {
+  js_threadsafe_function_t *function;
+  void *context;
+  js_threadsafe_function_batch_cb cb;
+  js_finalize_cb finalize_cb;
+  void *finalize_hint;
+
+  size_t refs;
+  size_t threads;
+  size_t closing;
+  size_t entered;
+  size_t scheduled;
+  size_t wakeups;
+  size_t calls;
+
+  size_t mask;
+  js__threadsafe_function_cell_t *cells;
+
+  size_t waiters;
+  uv_mutex_t lock;
+  uv_cond_t drained;
+
+  char padding[64];
+
+  size_t head; // Written by producers
+
+  char padding_head[64 - sizeof(size_t)];
+
+  size_t tail; // Written by the JavaScript thread
+};
 
-  if (status != napi_ok) return js_convert_from_status(status);
+static inline js__threadsafe_function_t *
+js__threadsafe_function_state(js_threadsafe_function_t *function) {
+  uintptr_t handle = (uintptr_t) function;
 
-  *result = type == napi_biguint64_array;
+  if ((handle & 1) == 0) return NULL;
 
-  return napi_ok;
+  return (js__threadsafe_function_t *) (handle & ~(uintptr_t) 1);
 }
 
-static inline int
-js_is_dataview(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_is_dataview(env, value, result);
-  return js_convert_from_status(status);
-}
+static inline js_threadsafe_function_t *
+js__threadsafe_function_handle(js_threadsafe_function_t *function) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
 
-static inline int
-js_strict_equals(js_env_t *env, js_value_t *a, js_value_t *b, bool *result) {
-  napi_status status = napi_strict_equals(env, a, b, result);
-  return js_convert_from_status(status);
+  return state ? state->function : function;
 }
 
-static inline int
-js_get_global(js_env_t *env, js_value_t **result) {
-  napi_status status = napi_get_global(env, result);
-  return js_convert_from_status(status);
-}
+static inline void
+js__threadsafe_function_wake(js__threadsafe_function_t *state) {
+  if (js__atomic_load(&state->waiters) == 0) return;
 
-static inline int
-js_get_undefined(js_env_t *env, js_value_t **result) {
-  napi_status status = napi_get_undefined(env, result);
-  return js_convert_from_status(status);
+  uv_mutex_lock(&state->lock);
+  uv_cond_broadcast(&state->drained);
+  uv_mutex_unlock(&state->lock);
 }
 
-static inline int
-js_get_null(js_env_t *env, js_value_t **result) {
-  napi_status status = napi_get_null(env, result);
-  return js_convert_from_status(status);
-}
+static inline bool
+js__threadsafe_function_push(js__threadsafe_function_t *state, void *data) {
+  size_t head = js__atomic_load(&state->head);
 
-static inline int
-js_get_boolean(js_env_t *env, bool value, js_value_t **result) {
-  napi_status status = napi_get_boolean(env, value, result);
-  return js_convert_from_status(status);
-}
+  for (;;) {
+    js__threadsafe_function_cell_t *cell = &state->cells[head & state->mask];
 
-static inline int
-js_get_value_bool(js_env_t *env, js_value_t *value, bool *result) {
-  napi_status status = napi_get_value_bool(env, value, result);
-  return js_convert_from_status(status);
-}
+    intptr_t delta = (intptr_t) js__atomic_load(&cell->sequence) - (intptr_t) head;
 
-static inline int
-js_get_value_int32(js_env_t *env, js_value_t *value, int32_t *result) {
-  napi_status status = napi_get_value_int32(env, value, result);
-  return js_convert_from_status(status);
-}
+    if (delta == 0) {
+      if (js__atomic_compare_exchange(&state->head, &head, head + 1)) {
+        cell->data = data;
 
-static inline int
-js_get_value_uint32(js_env_t *env, js_value_t *value, uint32_t *result) {
-  napi_status status = napi_get_value_uint32(env, value, result);
-  return js_convert_from_status(status);
-}
+        js__atomic_store(&cell->sequence, head + 1);
 
-static inline int
-js_get_value_int64(js_env_t *env, js_value_t *value, int64_t *result) {
-  napi_status status = napi_get_value_int64(env, value, result);
-  return js_convert_from_status(status);
+        return true;
+      }
+    } else if (delta < 0) {
+      return false; // Full
+    } else {
+      head = js__atomic_load(&state->head);
+    }
+  }
 }
 
-static inline int
-js_get_value_double(js_env_t *env, js_value_t *value, double *result) {
-  napi_status status = napi_get_value_double(env, value, result);
-  return js_convert_from_status(status);
-}
+static inline bool
+js__threadsafe_function_pop(js__threadsafe_function_t *state, void **result) {
+  size_t tail = state->tail;
 
-#if NAPI_VERSION >= 6
+  js__threadsafe_function_cell_t *cell = &state->cells[tail & state->mask];
 
-static inline int
-js_get_value_bigint_int64(js_env_t *env, js_value_t *value, int64_t *result, bool *lossless) {
-  napi_status status = napi_get_value_bigint_int64(env, value, result, lossless);
-  return js_convert_from_status(status);
-}
+  if (js__atomic_load(&cell->sequence) != tail + 1) return false; // Empty
 
-static inline int
-js_get_value_bigint_uint64(js_env_t *env, js_value_t *value, uint64_t *result, bool *lossless) {
-  napi_status status = napi_get_value_bigint_uint64(env, value, result, lossless);
-  return js_convert_from_status(status);
+  *result = cell->data;
+
+  js__atomic_store(&cell->sequence, tail + state->mask + 1);
+  js__atomic_store(&state->tail, tail + 1);
+
+  return true;
 }
 
-static inline int
-js_get_value_bigint_words(js_env_t *env, js_value_t *value, int *sign, uint64_t *words, size_t len, size_t *result) {
-  size_t count = len;
+static inline void
+js__threadsafe_function_unref(js__threadsafe_function_t *state) {
+  if (js__atomic_fetch_add(&state->refs, (size_t) -1) != 1) return;
 
-  napi_status status = napi_get_value_bigint_words(env, value, sign, &count, words);
+  // Nothing else can reach the queue anymore, so hand back the data of calls
+  // queued after the last wakeup.
+  void *data;
 
-  if (result) *result = count;
+  while (js__threadsafe_function_pop(state, &data)) {
+    state->cb(NULL, NULL, state->context, &data, 1);
+  }
 
-  return js_convert_from_status(status);
+  uv_cond_destroy(&state->drained);
+  uv_mutex_destroy(&state->lock);
+
+  free(state);
 }
 
-#endif
+// Drop the thread of a caller, failing if no threads are left like Node-API
+// does.
+static inline bool
+js__threadsafe_function_release(js__threadsafe_function_t *state) {
+  size_t threads = js__atomic_load(&state->threads);
 
-static inline int
-js_get_value_string_utf8(js_env_t *env, js_value_t *value, utf8_t *str, size_t len, size_t *result) {
-  napi_status status = napi_get_value_string_utf8(env, value, (char *) str, len, result);
-  return js_convert_from_status(status);
+  do {
+    if (threads == 0) return false;
+  } while (js__atomic_compare_exchange(&state->threads, &threads, threads - 1) == false);
+
+  js__threadsafe_function_unref(state);
+
+  return true;
 }
 
-static inline int
-js_get_value_string_utf16le(js_env_t *env, js_value_t *value, utf16_t *str, size_t len, size_t *result) {
-  napi_status status = napi_get_value_string_utf16(env, value, str, len, result);
-  return js_convert_from_status(status);
+static inline void
+js__threadsafe_function_close(js__threadsafe_function_t *state) {
+  js__atomic_store(&state->closing, 1);
+
+  js__threadsafe_function_wake(state);
 }
 
-static inline int
-js_get_value_string_latin1(js_env_t *env, js_value_t *value, latin1_t *str, size_t len, size_t *result) {
-  napi_status status = napi_get_value_string_latin1(env, value, (char *) str, len, result);
-  return js_convert_from_status(status);
+// Enter a call into Node-API on the function, unless it's closing. The
+// finalizer closes the function before waiting for calls already entered, so
+// either one sees the other.
+static inline bool
+js__threadsafe_function_enter(js__threadsafe_function_t *state) {
+  js__atomic_fetch_add(&state->entered, 1);
+
+  if (js__atomic_load(&state->closing) == 0) return true;
+
+  js__atomic_fetch_add(&state->entered, (size_t) -1);
+
+  return false;
 }
 
-static inline int
-js_get_value_external(js_env_t *env, js_value_t *value, void **result) {
-  napi_status status = napi_get_value_external(env, value, result);
-  return js_convert_from_status(status);
+static inline void
+js__threadsafe_function_leave(js__threadsafe_function_t *state) {
+  js__atomic_fetch_add(&state->entered, (size_t) -1);
 }
 
-#if NAPI_VERSION >= 5
+static inline napi_status
+js__threadsafe_function_schedule(js__threadsafe_function_t *state) {
+  if (js__atomic_load(&state->scheduled) == 1 || js__atomic_exchange(&state->scheduled, 1) == 1) return napi_ok;
 
-static inline int
-js_get_value_date(js_env_t *env, js_value_t *value, double *result) {
-  napi_status status = napi_get_date_value(env, value, result);
-  return js_convert_from_status(status);
-}
+  napi_status status = napi_closing;
 
-#endif
+  if (js__threadsafe_function_enter(state)) {
+    js__atomic_fetch_add(&state->refs, 1);
 
-static inline int
-js_get_array_length(js_env_t *env, js_value_t *value, uint32_t *result) {
-  napi_status status = napi_get_array_length(env, value, result);
-  return js_convert_from_status(status);
+    status = napi_call_threadsafe_function(state->function, NULL, napi_tsfn_nonblocking);
+
+    if (status != napi_ok) {
+      // Node-API only fails calls as the function is closing, failing them
+      // with an invalid argument once it counts no threads left.
+      js__atomic_store(&state->closing, 1);
+
+      js__threadsafe_function_unref(state);
+    }
+
+    js__threadsafe_function_leave(state);
+  }
+
+  // Calls queued from here on are delivered once the function is gone.
+  if (status != napi_ok) js__atomic_store(&state->scheduled, 0);
+
+  return status;
 }
 
-static inline int
-js_get_array_elements(js_env_t *env, js_value_t *array, js_value_t **elements, size_t len, size_t offset, uint32_t *result) {
-  uint32_t array_len;
+static inline void
+js__threadsafe_function_drain(js_env_t *env, js_value_t *function, js__threadsafe_function_t *state) {
+  size_t capacity = state->mask + 1;
+
+  js__env_t *env_state = env ? js__get_env(env) : NULL;
+
+  void **batch = (void **) js__scratch_alloc(env_state, sizeof(void *) * capacity);
 
-  napi_status status = napi_get_array_length(env, array, &array_len);
+  void *item;
 
-  if (status != napi_ok) return js_convert_from_status(status);
+  if (batch == NULL) {
+    // Out of memory, deliver the calls one by one instead.
+    js__atomic_store(&state->scheduled, 0);
 
-  uint32_t written = 0;
+    while (js__threadsafe_function_pop(state, &item)) {
+      js__atomic_fetch_add(&state->calls, 1);
 
-  for (size_t i = 0, j = offset; i < len && j < array_len; i++, j++) {
-    status = napi_get_element(env, array, j, &elements[i]);
+      state->cb(env, function, state->context, &item, 1);
+    }
 
-    if (status != napi_ok) return js_convert_from_status(status);
+    js__threadsafe_function_wake(state);
 
-    written++;
+    return;
   }
 
-  if (result) *result = written;
+  bool more;
 
-  return js_convert_from_status(status);
-}
+  do {
+    // Clear the scheduled flag before draining such that calls queued after
+    // this point are guaranteed to schedule another wakeup.
+    js__atomic_store(&state->scheduled, 0);
 
-static inline int
-js_set_array_elements(js_env_t *env, js_value_t *array, const js_value_t *elements[], size_t len, size_t offset) {
-  napi_status status = napi_ok;
+    size_t len = 0;
 
-  for (size_t i = 0; i < len; i++) {
-    status = napi_set_element(env, array, offset + i, (js_value_t *) elements[i]);
+    while (len < capacity && js__threadsafe_function_pop(state, &batch[len])) len++;
 
-    if (status != napi_ok) break;
-  }
+    more = len == capacity;
 
-  return js_convert_from_status(status);
-}
+    // Let producers waiting for room refill the queue while the batch is
+    // delivered.
+    js__threadsafe_function_wake(state);
 
-static inline int
-js_get_prototype(js_env_t *env, js_value_t *object, js_value_t **result) {
-  napi_status status = napi_get_prototype(env, object, result);
-  return js_convert_from_status(status);
-}
+    if (len) {
+      js__atomic_fetch_add(&state->calls, len);
 
-static inline int
-js_get_property_names(js_env_t *env, js_value_t *object, js_value_t **result) {
-  napi_status status = napi_get_property_names(env, object, result);
-  return js_convert_from_status(status);
-}
+      state->cb(env, function, state->context, batch, len);
+    }
 
-static inline int
-js_get_property(js_env_t *env, js_value_t *object, js_value_t *key, js_value_t **result) {
-  napi_status status = napi_get_property(env, object, key, result);
-  return js_convert_from_status(status);
-}
+    // Yield to the event loop rather than starve it if producers keep up,
+    // unless a wakeup is already pending.
+    if (more && env && js__threadsafe_function_schedule(state) == napi_ok) break;
+  } while (more);
 
-static inline int
-js_has_property(js_env_t *env, js_value_t *object, js_value_t *key, bool *result) {
-  napi_status status = napi_has_property(env, object, key, result);
-  return js_convert_from_status(status);
+  js__scratch_free(env_state, batch);
 }
 
-static inline int
-js_set_property(js_env_t *env, js_value_t *object, js_value_t *key, js_value_t *value) {
-  napi_status status = napi_set_property(env, object, key, value);
-  return js_convert_from_status(status);
-}
+static inline void
+js__on_threadsafe_function_call(napi_env env, napi_value function, void *context, void *data) {
+  js__threadsafe_function_t *state = (js__threadsafe_function_t *) context;
 
-static inline int
-js_delete_property(js_env_t *env, js_value_t *object, js_value_t *key, bool *result) {
-  napi_status status = napi_delete_property(env, object, key, result);
-  return js_convert_from_status(status);
-}
+  js__atomic_fetch_add(&state->wakeups, 1);
 
-static inline int
-js_get_named_property(js_env_t *env, js_value_t *object, const char *name, js_value_t **result) {
-  napi_status status = napi_get_named_property(env, object, name, result);
-  return js_convert_from_status(status);
-}
+  js__threadsafe_function_drain(env, function, state);
 
-static inline int
-js_has_named_property(js_env_t *env, js_value_t *object, const char *name, bool *result) {
-  napi_status status = napi_has_named_property(env, object, name, result);
-  return js_convert_from_status(status);
+  js__threadsafe_function_unref(state);
 }
 
-static inline int
-js_set_named_property(js_env_t *env, js_value_t *object, const char *name, js_value_t *value) {
-  napi_status status = napi_set_named_property(env, object, name, value);
-  return js_convert_from_status(status);
+static inline void
+js__on_threadsafe_function_finalize(napi_env env, void *data, void *hint) {
+  js__threadsafe_function_t *state = (js__threadsafe_function_t *) data;
+
+  // The function is gone once finalized, so stop producers from calling into
+  // Node-API and let those waiting for room give up.
+  js__threadsafe_function_close(state);
+
+  while (js__atomic_load(&state->entered)) uv_sleep(0);
+
+  if (state->finalize_cb) state->finalize_cb(env, state->finalize_hint, state->context);
+
+  js__threadsafe_function_unref(state);
 }
 
 static inline int
-js_delete_named_property(js_env_t *env, js_value_t *object, const char *name, bool *result) {
+js_create_threadsafe_function(js_env_t *env, js_value_t *function, size_t queue_limit, size_t initial_thread_count, js_finalize_cb finalize_cb, void *finalize_hint, void *context, js_threadsafe_function_cb cb, js_threadsafe_function_t **result) {
   napi_status status;
 
-  napi_value key;
-  status = napi_create_string_utf8(env, name, -1, &key);
+  napi_value resource_name;
+  status = napi_create_string_utf8(env, "js_threadsafe_function_t", NAPI_AUTO_LENGTH, &resource_name);
+  assert(status == napi_ok);
 
-  if (status == napi_ok) status = napi_delete_property(env, object, key, result);
+  status = napi_create_threadsafe_function(env, function, NULL, resource_name, queue_limit, initial_thread_count, finalize_hint, finalize_cb, context, cb, result);
 
   return js_convert_from_status(status);
 }
 
+/**
+ * Create a threadsafe function that coalesces calls made in quick succession
+ * into batches. Calls are queued in a lock-free queue of `queue_limit`, or
+ * `JS_THREADSAFE_FUNCTION_BATCH_CAPACITY` if 0, entries rounded up to a power
+ * of two, and the event loop is only woken up once per burst. Like any other
+ * threadsafe function, a call that finds the queue full either fails or waits
+ * for room depending on its mode.
+ *
+ * A call that succeeds always delivers its data, with a `NULL` environment if
+ * the function was aborted or torn down before the call could be drained.
+ */
 static inline int
-js_get_element(js_env_t *env, js_value_t *object, uint32_t index, js_value_t **result) {
-  napi_status status = napi_get_element(env, object, index, result);
-  return js_convert_from_status(status);
-}
+js_create_batched_threadsafe_function(js_env_t *env, js_value_t *function, size_t queue_limit, size_t initial_thread_count, js_finalize_cb finalize_cb, void *finalize_hint, void *context, js_threadsafe_function_batch_cb cb, js_threadsafe_function_t **result) {
+  napi_status status;
 
-static inline int
-js_has_element(js_env_t *env, js_value_t *object, uint32_t index, bool *result) {
-  napi_status status = napi_has_element(env, object, index, result);
-  return js_convert_from_status(status);
-}
+  // The queue needs at least two cells to tell full cells from free ones.
+  size_t capacity = 2;
 
-static inline int
-js_set_element(js_env_t *env, js_value_t *object, uint32_t index, js_value_t *value) {
-  napi_status status = napi_set_element(env, object, index, value);
-  return js_convert_from_status(status);
-}
+  while (capacity < (queue_limit ? queue_limit : JS_THREADSAFE_FUNCTION_BATCH_CAPACITY)) capacity <<= 1;
 
-static inline int
-js_delete_element(js_env_t *env, js_value_t *object, uint32_t index, bool *result) {
-  napi_status status = napi_delete_element(env, object, index, result);
-  return js_convert_from_status(status);
-}
+  js__threadsafe_function_t *state = (js__threadsafe_function_t *) malloc(sizeof(js__threadsafe_function_t) + sizeof(js__threadsafe_function_cell_t) * capacity);
 
-static inline int
-js_get_callback_info(js_env_t *env, const js_callback_info_t *info, size_t *argc, js_value_t *argv[], js_value_t **receiver, void **data) {
-  napi_status status = napi_get_cb_info(env, (js_callback_info_t *) info, argc, argv, receiver, data);
-  return js_convert_from_status(status);
-}
+  if (state == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
 
-static inline int
-js_get_typed_callback_info(const js_typed_callback_info_t *info, js_env_t **env, void **data) {
-  return 0;
-}
+    return js_pending_exception;
+  }
 
-static inline int
-js_get_new_target(js_env_t *env, const js_callback_info_t *info, js_value_t **result) {
-  napi_status status = napi_get_new_target(env, (js_callback_info_t *) info, result);
-  return js_convert_from_status(status);
-}
+  memset(state, 0, sizeof(js__threadsafe_function_t));
 
-static inline int
-js_get_arraybuffer_info(js_env_t *env, js_value_t *arraybuffer, void **data, size_t *len) {
-  napi_status status = napi_get_arraybuffer_info(env, arraybuffer, data, len);
-  return js_convert_from_status(status);
-}
+  state->context = context;
+  state->cb = cb;
+  state->finalize_cb = finalize_cb;
+  state->finalize_hint = finalize_hint;
+  state->refs = 1;
+  state->mask = capacity - 1;
+  state->cells = (js__threadsafe_function_cell_t *) &state[1];
 
-static inline int
-js_get_typedarray_info(js_env_t *env, js_value_t *typedarray, js_typedarray_type_t *type, void **data, size_t *len, js_value_t **arraybuffer, size_t *offset) {
-  napi_typedarray_type napi_type;
+  for (size_t i = 0; i < capacity; i++) {
+    state->cells[i].sequence = i;
+  }
 
-  napi_status status = napi_get_typedarray_info(env, typedarray, type == NULL ? NULL : &napi_type, len, data, arraybuffer, offset);
+  int err;
 
-  if (status == napi_ok && type) *type = js_convert_from_typedarray_type(napi_type);
+  err = uv_mutex_init(&state->lock);
+  assert(err == 0);
+
+  err = uv_cond_init(&state->drained);
+  assert(err == 0);
+
+  napi_value resource_name;
+  status = napi_create_string_utf8(env, "js_threadsafe_function_t", NAPI_AUTO_LENGTH, &resource_name);
+  assert(status == napi_ok);
+
+  // The queue is bounded by the shim, leaving at most a few wakeups in the
+  // Node-API queue.
+  status = napi_create_threadsafe_function(env, function, NULL, resource_name, 0, initial_thread_count, state, js__on_threadsafe_function_finalize, state, js__on_threadsafe_function_call, &state->function);
+
+  if (status != napi_ok) {
+    js__threadsafe_function_unref(state);
+
+    return js_convert_from_status(status);
+  }
+
+  state->refs += initial_thread_count;
+  state->threads = initial_thread_count;
+
+  *result = (js_threadsafe_function_t *) ((uintptr_t) state | 1);
 
   return 0;
 }
 
 static inline int
-js_get_dataview_info(js_env_t *env, js_value_t *dataview, void **data, size_t *len, js_value_t **arraybuffer, size_t *offset) {
-  napi_status status = napi_get_dataview_info(env, dataview, len, data, arraybuffer, offset);
+js_get_threadsafe_function_context(js_threadsafe_function_t *function, void **result) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
+
+  if (state) {
+    *result = state->context;
+
+    return 0;
+  }
+
+  napi_status status = napi_get_threadsafe_function_context(function, result);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_get_string_view(js_env_t *env, js_value_t *string, js_string_encoding_t *encoding, const void **str, size_t *len, js_string_view_t **result) {
-  size_t view_len;
+js_call_threadsafe_function(js_threadsafe_function_t *function, void *data, js_threadsafe_function_call_mode_t mode) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
 
-  napi_status status = napi_get_value_string_utf8(env, string, NULL, 0, &view_len);
+  napi_status status;
 
-  if (status == napi_ok) {
-    char *view = (char *) malloc(view_len + 1 /* NULL */);
+  if (state == NULL) {
+    status = napi_call_threadsafe_function(function, data, js_convert_to_threadsafe_function_call_mode(mode));
 
-    status = napi_get_value_string_utf8(env, string, view, view_len + 1 /* NULL */, NULL);
+    return js_convert_from_status(status);
+  }
+
+  bool queued = false;
+
+  if (js__atomic_load(&state->closing) == 0) {
+    queued = js__threadsafe_function_push(state, data);
+
+    if (queued == false && mode == js_threadsafe_function_blocking) {
+      uv_mutex_lock(&state->lock);
+
+      js__atomic_fetch_add(&state->waiters, 1);
+
+      // The JavaScript thread checks for waiters after draining, and the
+      // finalizer after closing, so retrying the push after registering as a
+      // waiter cannot miss a wakeup.
+      while (js__atomic_load(&state->closing) == 0) {
+        queued = js__threadsafe_function_push(state, data);
+
+        if (queued || js__threadsafe_function_schedule(state) != napi_ok) break;
+
+        uv_cond_wait(&state->drained, &state->lock);
+      }
 
-    if (encoding) *encoding = js_utf8;
+      js__atomic_fetch_add(&state->waiters, (size_t) -1);
 
-    if (str) *str = view;
+      uv_mutex_unlock(&state->lock);
+    }
+  }
+
+  if (queued) {
+    // Once queued, the call is delivered even if waking up the event loop
+    // fails, so it must not fail either as the caller would release its data.
+    js__threadsafe_function_schedule(state);
 
-    if (len) *len = view_len;
+    return 0;
+  }
 
-    *result = (js_string_view_t *) view;
+  if (js__atomic_load(&state->closing)) {
+    // Like Node-API, a call failing as the function is closing releases the
+    // thread of the caller.
+    status = js__threadsafe_function_release(state) ? napi_closing : napi_invalid_arg;
+  } else if (mode == js_threadsafe_function_nonblocking) {
+    status = napi_queue_full;
+  } else {
+    status = napi_generic_failure;
   }
 
   return js_convert_from_status(status);
 }
 
+/**
+ * Get the statistics of a batched threadsafe function. Other threadsafe
+ * functions don't keep any, and fail.
+ */
 static inline int
-js_release_string_view(js_env_t *env, js_string_view_t *view) {
-  free(view);
+js_get_threadsafe_function_statistics(js_threadsafe_function_t *function, js_threadsafe_function_statistics_t *result) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
+
+  if (state == NULL) return js_convert_from_status(napi_invalid_arg);
+
+  result->depth = js__atomic_load(&state->head) - js__atomic_load(&state->tail);
+  result->wakeups = js__atomic_load(&state->wakeups);
+  result->calls = js__atomic_load(&state->calls);
 
   return 0;
 }
 
 static inline int
-js_call_function(js_env_t *env, js_value_t *receiver, js_value_t *function, size_t argc, js_value_t *const argv[], js_value_t **result) {
-  napi_status status = napi_call_function(env, receiver, function, argc, argv, result);
-  return js_convert_from_status(status);
-}
-
-#if NAPI_VERSION >= 3
+js_acquire_threadsafe_function(js_threadsafe_function_t *function) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
 
-static inline int
-js_call_function_with_checkpoint(js_env_t *env, js_value_t *receiver, js_value_t *function, size_t argc, js_value_t *const argv[], js_value_t **result) {
-  napi_status status = napi_make_callback(env, NULL, receiver, function, argc, argv, result);
+  napi_status status;
 
-  if (status == napi_pending_exception) {
-    napi_status status;
+  if (state == NULL) {
+    status = napi_acquire_threadsafe_function(function);
 
-    napi_value error;
-    status = napi_get_and_clear_last_exception(env, &error);
-    assert(status == napi_ok);
+    return js_convert_from_status(status);
+  }
 
-    status = napi_fatal_exception(env, error);
-    assert(status == napi_ok);
+  if (js__threadsafe_function_enter(state) == false) return js_convert_from_status(napi_closing);
 
-    (void) (status);
+  status = napi_acquire_threadsafe_function(state->function);
 
-    return js_uncaught_exception;
+  if (status == napi_ok) {
+    js__atomic_fetch_add(&state->refs, 1);
+    js__atomic_fetch_add(&state->threads, 1);
   }
 
-  return js_convert_from_status(status);
-}
-
-#endif
+  js__threadsafe_function_leave(state);
 
-static inline int
-js_new_instance(js_env_t *env, js_value_t *constructor, size_t argc, js_value_t *const argv[], js_value_t **result) {
-  napi_status status = napi_new_instance(env, constructor, argc, argv, result);
   return js_convert_from_status(status);
 }
 
-#if NAPI_VERSION >= 7
-
 static inline int
-js_create_threadsafe_function(js_env_t *env, js_value_t *function, size_t queue_limit, size_t initial_thread_count, js_finalize_cb finalize_cb, void *finalize_hint, void *context, js_threadsafe_function_cb cb, js_threadsafe_function_t **result) {
+js_release_threadsafe_function(js_threadsafe_function_t *function, js_threadsafe_function_release_mode_t mode) {
+  js__threadsafe_function_t *state = js__threadsafe_function_state(function);
+
   napi_status status;
 
-  napi_value resource_name;
-  status = napi_create_string_utf8(env, "js_threadsafe_function_t", NAPI_AUTO_LENGTH, &resource_name);
-  assert(status == napi_ok);
+  if (state == NULL) {
+    status = napi_release_threadsafe_function(function, js_convert_to_threadsafe_function_release_mode(mode));
 
-  status = napi_create_threadsafe_function(env, function, NULL, resource_name, queue_limit, initial_thread_count, finalize_hint, finalize_cb, context, cb, result);
+    return js_convert_from_status(status);
+  }
 
-  return js_convert_from_status(status);
-}
+  // Once closing, the function may already be gone, and releasing only drops
+  // the thread of the caller.
+  if (js__threadsafe_function_enter(state)) {
+    status = napi_release_threadsafe_function(state->function, js_convert_to_threadsafe_function_release_mode(mode));
 
-static inline int
-js_get_threadsafe_function_context(js_threadsafe_function_t *function, void **result) {
-  napi_status status = napi_get_threadsafe_function_context(function, result);
-  return js_convert_from_status(status);
-}
+    js__threadsafe_function_leave(state);
 
-static inline int
-js_call_threadsafe_function(js_threadsafe_function_t *function, void *data, js_threadsafe_function_call_mode_t mode) {
-  napi_status status = napi_call_threadsafe_function(function, data, js_convert_to_threadsafe_function_call_mode(mode));
-  return js_convert_from_status(status);
-}
+    if (status != napi_ok) return js_convert_from_status(status);
 
-static inline int
-js_acquire_threadsafe_function(js_threadsafe_function_t *function) {
-  napi_status status = napi_acquire_threadsafe_function(function);
-  return js_convert_from_status(status);
-}
+    if (mode == js_threadsafe_function_abort) js__threadsafe_function_close(state);
+  }
+
+  status = js__threadsafe_function_release(state) ? napi_ok : napi_invalid_arg;
 
-static inline int
-js_release_threadsafe_function(js_threadsafe_function_t *function, js_threadsafe_function_release_mode_t mode) {
-  napi_status status = napi_release_threadsafe_function(function, js_convert_to_threadsafe_function_release_mode(mode));
   return js_convert_from_status(status);
 }
 
 static inline int
 js_ref_threadsafe_function(js_env_t *env, js_threadsafe_function_t *function) {
-  napi_status status = napi_ref_threadsafe_function(env, function);
+  napi_status status = napi_ref_threadsafe_function(env, js__threadsafe_function_handle(function));
   return js_convert_from_status(status);
 }
 
 static inline int
 js_unref_threadsafe_function(js_env_t *env, js_threadsafe_function_t *function) {
-  napi_status status = napi_unref_threadsafe_function(env, function);
+  napi_status status = napi_unref_threadsafe_function(env, js__threadsafe_function_handle(function));
   return js_convert_from_status(status);
 }
 
@@ -1704,54 +5866,120 @@ js_finish_deferred_teardown_callback(js_deferred_teardown_t *handle) {
   return js_convert_from_status(status);
 }
 
-#endif
+#endif
+
+static inline int
+js_throw(js_env_t *env, js_value_t *error) {
+  napi_status status = napi_throw(env, error);
+  return js_convert_from_status(status);
+}
+
+static inline int
+js_vformat(char **result, size_t *size, const char *message, va_list args) {
+  char buffer[JS_FORMAT_STACK_SIZE];
+
+  va_list args_copy;
+  va_copy(args_copy, args);
+
+  int res = vsnprintf(buffer, JS_FORMAT_STACK_SIZE, message, args_copy);
+
+  va_end(args_copy);
+
+  if (res < 0) return res;
+
+  *size = res + 1 /* NULL */;
+  *result = (char *) malloc(*size);
+
+  if (*result == NULL) return -1;
+
+  if (*size <= JS_FORMAT_STACK_SIZE) {
+    memcpy(*result, buffer, *size);
+  } else {
+    va_copy(args_copy, args);
+
+    vsnprintf(*result, *size, message, args_copy);
+
+    va_end(args_copy);
+  }
+
+  return 0;
+}
+
+typedef napi_status (*js__create_error_cb)(napi_env, napi_value, napi_value, napi_value *);
+
+static inline int
+js__throw_error(js_env_t *env, js__create_error_cb create, const char *code, const char *message, size_t len) {
+  napi_status status;
+
+  // Error codes are usually string literals and are looked up in the interned
+  // key cache, if enabled, rather than created anew for every error.
+  napi_value code_value = NULL;
+
+  status = code ? js__get_property_key(env, code, &code_value) : napi_ok;
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  napi_value message_value;
+  status = napi_create_string_utf8(env, message, len, &message_value);
 
-static inline int
-js_throw(js_env_t *env, js_value_t *error) {
-  napi_status status = napi_throw(env, error);
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  napi_value error;
+  status = create(env, code_value, message_value, &error);
+
+  if (status != napi_ok) return js_convert_from_status(status);
+
+  status = napi_throw(env, error);
   return js_convert_from_status(status);
 }
 
 static inline int
-js_vformat(char **result, size_t *size, const char *message, va_list args) {
+js__throw_verrorf(js_env_t *env, js__create_error_cb create, const char *code, const char *message, va_list args) {
+  char buffer[JS_FORMAT_STACK_SIZE];
+
   va_list args_copy;
   va_copy(args_copy, args);
 
-  int res = vsnprintf(NULL, 0, message, args_copy);
+  int res = vsnprintf(buffer, JS_FORMAT_STACK_SIZE, message, args_copy);
 
   va_end(args_copy);
 
-  if (res < 0) return res;
+  if (res < 0) return js_convert_from_status(napi_invalid_arg);
 
-  *size = res + 1 /* NULL */;
-  *result = (char *) malloc(*size);
+  size_t len = (size_t) res;
+
+  if (len < JS_FORMAT_STACK_SIZE) {
+    return js__throw_error(env, create, code, buffer, len);
+  }
+
+  // Only messages that don't fit on the stack are formatted twice.
+  js__env_t *state = js__get_env(env);
+
+  char *formatted = (char *) js__scratch_alloc(state, len + 1 /* NULL */);
+
+  if (formatted == NULL) return js_convert_from_status(napi_generic_failure);
 
   va_copy(args_copy, args);
 
-  vsnprintf(*result, *size, message, args_copy);
+  vsnprintf(formatted, len + 1 /* NULL */, message, args_copy);
 
   va_end(args_copy);
 
-  return 0;
+  int err = js__throw_error(env, create, code, formatted, len);
+
+  js__scratch_free(state, formatted);
+
+  return err;
 }
 
 static inline int
 js_throw_error(js_env_t *env, const char *code, const char *message) {
-  napi_status status = napi_throw_error(env, code, message);
-  return js_convert_from_status(status);
+  return js__throw_error(env, napi_create_error, code, message, NAPI_AUTO_LENGTH);
 }
 
 static inline int
 js_throw_verrorf(js_env_t *env, const char *code, const char *message, va_list args) {
-  size_t len;
-  char *formatted;
-  js_vformat(&formatted, &len, message, args);
-
-  int err = js_throw_error(env, code, formatted);
-
-  free(formatted);
-
-  return err;
+  return js__throw_verrorf(env, napi_create_error, code, message, args);
 }
 
 static inline int
@@ -1768,21 +5996,12 @@ js_throw_errorf(js_env_t *env, const char *code, const char *message, ...) {
 
 static inline int
 js_throw_type_error(js_env_t *env, const char *code, const char *message) {
-  napi_status status = napi_throw_type_error(env, code, message);
-  return js_convert_from_status(status);
+  return js__throw_error(env, napi_create_type_error, code, message, NAPI_AUTO_LENGTH);
 }
 
 static inline int
 js_throw_type_verrorf(js_env_t *env, const char *code, const char *message, va_list args) {
-  size_t len;
-  char *formatted;
-  js_vformat(&formatted, &len, message, args);
-
-  int err = js_throw_type_error(env, code, formatted);
-
-  free(formatted);
-
-  return err;
+  return js__throw_verrorf(env, napi_create_type_error, code, message, args);
 }
 
 static inline int
@@ -1799,21 +6018,12 @@ js_throw_type_errorf(js_env_t *env, const char *code, const char *message, ...)
 
 static inline int
 js_throw_range_error(js_env_t *env, const char *code, const char *message) {
-  napi_status status = napi_throw_range_error(env, code, message);
-  return js_convert_from_status(status);
+  return js__throw_error(env, napi_create_range_error, code, message, NAPI_AUTO_LENGTH);
 }
 
 static inline int
 js_throw_range_verrorf(js_env_t *env, const char *code, const char *message, va_list args) {
-  size_t len;
-  char *formatted;
-  js_vformat(&formatted, &len, message, args);
-
-  int err = js_throw_range_error(env, code, formatted);
-
-  free(formatted);
-
-  return err;
+  return js__throw_verrorf(env, napi_create_range_error, code, message, args);
 }
 
 static inline int
@@ -1828,25 +6038,14 @@ js_throw_range_errorf(js_env_t *env, const char *code, const char *message, ...)
   return err;
 }
 
-#if NAPI_VERSION >= 9
-
 static inline int
 js_throw_syntax_error(js_env_t *env, const char *code, const char *message) {
-  napi_status status = node_api_throw_syntax_error(env, code, message);
-  return js_convert_from_status(status);
+  return js__throw_error(env, js__create_syntax_error, code, message, NAPI_AUTO_LENGTH);
 }
 
 static inline int
 js_throw_syntax_verrorf(js_env_t *env, const char *code, const char *message, va_list args) {
-  size_t len;
-  char *formatted;
-  js_vformat(&formatted, &len, message, args);
-
-  int err = js_throw_syntax_error(env, code, formatted);
-
-  free(formatted);
-
-  return err;
+  return js__throw_verrorf(env, js__create_syntax_error, code, message, args);
 }
 
 static inline int
@@ -1861,8 +6060,6 @@ js_throw_syntax_errorf(js_env_t *env, const char *code, const char *message, ...
   return err;
 }
 
-#endif
-
 static inline int
 js_is_exception_pending(js_env_t *env, bool *result) {
   napi_status status = napi_is_exception_pending(env, result);
@@ -1885,12 +6082,908 @@ js_fatal_exception(js_env_t *env, js_value_t *error) {
 
 #endif
 
+/**
+ * Adjust the external memory accounted for by the module. Changes are batched
+ * and reported to the engine once they add up to `JS_EXTERNAL_MEMORY_THRESHOLD`
+ * bytes, or once the event loop has finished running callbacks, rather than
+ * every time. The `result` is the total the engine returned when last reported
+ * to, plus the changes still pending.
+ */
 static inline int
 js_adjust_external_memory(js_env_t *env, int64_t change_in_bytes, int64_t *result) {
-  napi_status status = napi_adjust_external_memory(env, change_in_bytes, result);
+  napi_status status = js__adjust_external_memory(env, change_in_bytes, result);
+  return js_convert_from_status(status);
+}
+
+/**
+ * Report any pending changes in external memory to the engine.
+ */
+static inline int
+js_flush_external_memory(js_env_t *env) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  napi_status status = js__flush_external_memory(state);
+  return js_convert_from_status(status);
+}
+
+static inline napi_value
+js__on_external_memory_entry_get(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  js__external_memory_entry_t *entry;
+  status = napi_get_cb_info(env, info, NULL, NULL, NULL, (void **) &entry);
+
+  if (status != napi_ok) return NULL;
+
+  int64_t total = entry->state ? entry->state->external_memory.total : 0;
+
+  napi_value result;
+  status = napi_create_double(env, (double) total, &result);
+
+  if (status != napi_ok) return NULL;
+
+  return result;
+}
+
+static inline void
+js__on_external_memory_entry_finalize(napi_env env, void *data, void *hint) {
+  js__external_memory_entry_t *entry = (js__external_memory_entry_t *) data;
+
+  if (--entry->refs == 0) free(entry);
+}
+
+/**
+ * The registry is shared by all modules loaded in the environment, each of
+ * which adds an accessor for its total under its file name the first time it
+ * asks for the breakdown. The totals themselves are only ever kept in C.
+ */
+static inline napi_status
+js__get_external_memory_registry(js__env_t *state, napi_value *result) {
+  napi_status status;
+
+  js_env_t *env = state->env;
+
+  napi_value global;
+  status = napi_get_global(env, &global);
+
+  if (status != napi_ok) return status;
+
+  napi_value key;
+  if (js_symbol_for(env, "js.externalMemory", NAPI_AUTO_LENGTH, &key) != 0) return napi_pending_exception;
+
+  status = napi_get_property(env, global, key, result);
+
+  if (status != napi_ok) return status;
+
+  napi_valuetype type;
+  status = napi_typeof(env, *result, &type);
+
+  if (status != napi_ok) return status;
+
+  if (type == napi_undefined) {
+    status = napi_create_object(env, result);
+
+    if (status != napi_ok) return status;
+
+    napi_property_descriptor descriptor = {NULL, key, NULL, NULL, NULL, *result, napi_default, NULL};
+
+    status = napi_define_properties(env, global, 1, &descriptor);
+
+    if (status != napi_ok) return status;
+  }
+
+  if (state->external_memory.entry) return napi_ok;
+
+  const js__node_api_t *api = js__get_node_api();
+
+  const char *module = NULL;
+
+  if (api->get_module_file_name) api->get_module_file_name(env, &module);
+
+  if (module == NULL) module = "<unknown>";
+
+  js__external_memory_entry_t *entry = (js__external_memory_entry_t *) malloc(sizeof(js__external_memory_entry_t));
+
+  if (entry == NULL) return napi_generic_failure;
+
+  entry->state = state;
+  entry->refs = 1;
+
+  napi_value getter;
+  status = napi_create_function(env, module, NAPI_AUTO_LENGTH, js__on_external_memory_entry_get, entry, &getter);
+
+  if (status == napi_ok) {
+    status = napi_wrap(env, getter, entry, js__on_external_memory_entry_finalize, NULL, NULL);
+  }
+
+  if (status != napi_ok) {
+    free(entry);
+
+    return status;
+  }
+
+  napi_value argv[3] = {*result};
+
+  status = napi_create_string_utf8(env, module, NAPI_AUTO_LENGTH, &argv[1]);
+
+  if (status != napi_ok) return status;
+
+  status = napi_create_object(env, &argv[2]);
+
+  if (status != napi_ok) return status;
+
+  napi_value enumerable;
+  status = napi_get_boolean(env, true, &enumerable);
+
+  if (status != napi_ok) return status;
+
+  napi_property_descriptor descriptors[] = {
+    {"get", NULL, NULL, NULL, NULL, getter, napi_default, NULL},
+    {"enumerable", NULL, NULL, NULL, NULL, enumerable, napi_default, NULL},
+    {"configurable", NULL, NULL, NULL, NULL, enumerable, napi_default, NULL},
+  };
+
+  status = napi_define_properties(env, argv[2], 3, descriptors);
+
+  if (status != napi_ok) return status;
+
+  napi_value object;
+  status = js__get_global_function(env, "Object", &object);
+
+  if (status != napi_ok) return status;
+
+  napi_value define_property;
+  status = napi_get_named_property(env, object, "defineProperty", &define_property);
+
+  if (status != napi_ok) return status;
+
+  napi_value ignored;
+  status = napi_call_function(env, object, define_property, 3, argv, &ignored);
+
+  if (status != napi_ok) return status;
+
+  entry->refs++;
+
+  state->external_memory.entry = entry;
+
+  return napi_ok;
+}
+
+/**
+ * Get an object that maps the file name of every module in the environment to
+ * the external memory it accounts for. The same object is available from
+ * JavaScript as `globalThis[Symbol.for('js.externalMemory')]`, which a module
+ * is added to the first time it asks for the breakdown.
+ */
+static inline int
+js_get_external_memory_breakdown(js_env_t *env, js_value_t **result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  napi_status status = js__get_external_memory_registry(state, result);
   return js_convert_from_status(status);
 }
 
+static inline int
+js_get_external_memory_statistics(js_env_t *env, js_external_memory_statistics_t *result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  result->total = state->external_memory.total;
+  result->pending = state->external_memory.pending;
+  result->adjustments = state->external_memory.adjustments;
+  result->flushes = state->external_memory.flushes;
+
+  return 0;
+}
+
+static inline int
+js_get_scratch_statistics(js_env_t *env, js_scratch_statistics_t *result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+  result->size = state->scratch.size;
+  result->used = state->scratch.len;
+  result->high_water_mark = state->scratch.high_water_mark;
+  result->overflows = state->scratch.overflows;
+
+  return 0;
+}
+
+static inline int
+js_get_property_key_statistics(js_env_t *env, js_property_key_statistics_t *result) {
+  js__env_t *state = js__get_env(env);
+
+  if (state == NULL) return js_pending_exception;
+
+#ifdef JS__PROPERTY_KEY_CACHE
+  result->size = JS__PROPERTY_KEY_CACHE;
+#else
+  result->size = 0;
+#endif
+  result->hits = state->property_keys.hits;
+  result->misses = state->property_keys.misses;
+
+  return 0;
+}
+
+#ifdef JS_TRACE
+
+/**
+ * Call tracing, enabled by defining `JS_TRACE` before including this header.
+ * Every `js_*` function below is redefined as a macro that counts the call and
+ * records its latency in a per-thread log-linear histogram. The histograms
+ * record values exactly up to 16 ns and with 8 sub-buckets per power of two
+ * above that, bounding the relative error to 12.5%.
+ *
+ * The trace state is shared by all translation units and threads of the
+ * process. Counts are read without synchronising with the threads recording
+ * them and so are only approximate while those threads are running.
+ */
+
+#define JS__TRACE_FUNCTIONS(V) \
+  V(js_get_env_loop) \
+  V(js_open_handle_scope) \
+  V(js_close_handle_scope) \
+  V(js_open_escapable_handle_scope) \
+  V(js_close_escapable_handle_scope) \
+  V(js_escape_handle) \
+  V(js_run_script) \
+  V(js_create_reference) \
+  V(js_delete_reference) \
+  V(js_reference_ref) \
+  V(js_reference_unref) \
+  V(js_get_reference_value) \
+  V(js_define_class) \
+  V(js_define_properties) \
+  V(js_define_static_class) \
+  V(js_define_static_properties) \
+  V(js_wrap) \
+  V(js_unwrap) \
+  V(js_remove_wrap) \
+  V(js_add_type_tag) \
+  V(js_check_type_tag) \
+  V(js_add_finalizer) \
+  V(js_create_int32) \
+  V(js_create_uint32) \
+  V(js_create_int64) \
+  V(js_create_double) \
+  V(js_create_bigint_int64) \
+  V(js_create_bigint_uint64) \
+  V(js_create_bigint_words) \
+  V(js_create_string_utf8) \
+  V(js_create_string_utf16le) \
+  V(js_create_string_latin1) \
+  V(js_create_external_string_utf8) \
+  V(js_create_external_string_utf16le) \
+  V(js_create_external_string_latin1) \
+  V(js_create_property_key_utf8) \
+  V(js_create_property_key_utf16le) \
+  V(js_create_property_key_latin1) \
+  V(js_create_symbol) \
+  V(js_symbol_for) \
+  V(js_create_object) \
+  V(js_create_function) \
+  V(js_create_typed_function) \
+  V(js_create_array) \
+  V(js_create_array_with_length) \
+  V(js_create_external) \
+  V(js_create_date) \
+  V(js_create_error) \
+  V(js_create_type_error) \
+  V(js_create_range_error) \
+  V(js_create_syntax_error) \
+  V(js_create_promise) \
+  V(js_resolve_deferred) \
+  V(js_reject_deferred) \
+  V(js_queue_task) \
+  V(js_cancel_task) \
+  V(js_get_task_statistics) \
+  V(js_create_arraybuffer) \
+  V(js_create_external_arraybuffer) \
+  V(js_create_unsafe_arraybuffer) \
+  V(js_create_sharedarraybuffer) \
+  V(js_create_external_sharedarraybuffer) \
+  V(js_create_mapped_arraybuffer) \
+  V(js_advise_mapped_arraybuffer) \
+  V(js_detach_arraybuffer) \
+  V(js_create_typedarray) \
+  V(js_create_pooled_typedarray) \
+  V(js_create_dataview) \
+  V(js_coerce_to_boolean) \
+  V(js_coerce_to_number) \
+  V(js_coerce_to_string) \
+  V(js_coerce_to_object) \
+  V(js_typeof) \
+  V(js_instanceof) \
+  V(js_is_undefined) \
+  V(js_is_null) \
+  V(js_is_boolean) \
+  V(js_is_number) \
+  V(js_is_int32) \
+  V(js_is_uint32) \
+  V(js_is_string) \
+  V(js_is_symbol) \
+  V(js_is_object) \
+  V(js_is_function) \
+  V(js_is_array) \
+  V(js_is_external) \
+  V(js_is_bigint) \
+  V(js_is_date) \
+  V(js_is_error) \
+  V(js_is_promise) \
+  V(js_is_arraybuffer) \
+  V(js_is_sharedarraybuffer) \
+  V(js_is_detached_arraybuffer) \
+  V(js_is_typedarray) \
+  V(js_is_int8array) \
+  V(js_is_uint8array) \
+  V(js_is_uint8clampedarray) \
+  V(js_is_int16array) \
+  V(js_is_uint16array) \
+  V(js_is_int32array) \
+  V(js_is_uint32array) \
+  V(js_is_float32array) \
+  V(js_is_float64array) \
+  V(js_is_bigint64array) \
+  V(js_is_biguint64array) \
+  V(js_is_dataview) \
+  V(js_classify_value) \
+  V(js_strict_equals) \
+  V(js_get_global) \
+  V(js_get_undefined) \
+  V(js_get_null) \
+  V(js_get_boolean) \
+  V(js_get_value_bool) \
+  V(js_get_value_int32) \
+  V(js_get_value_uint32) \
+  V(js_get_value_int64) \
+  V(js_get_value_double) \
+  V(js_get_value_bigint_int64) \
+  V(js_get_value_bigint_uint64) \
+  V(js_get_value_bigint_words) \
+  V(js_get_value_string_utf8) \
+  V(js_get_value_string_utf16le) \
+  V(js_get_value_string_latin1) \
+  V(js_get_value_external) \
+  V(js_get_value_date) \
+  V(js_get_array_length) \
+  V(js_get_array_elements) \
+  V(js_set_array_elements) \
+  V(js_encode_record) \
+  V(js_decode_record) \
+  V(js_encode_records) \
+  V(js_decode_records) \
+  V(js_get_prototype) \
+  V(js_get_property_names) \
+  V(js_get_property) \
+  V(js_has_property) \
+  V(js_set_property) \
+  V(js_delete_property) \
+  V(js_get_named_property) \
+  V(js_has_named_property) \
+  V(js_set_named_property) \
+  V(js_delete_named_property) \
+  V(js_get_element) \
+  V(js_has_element) \
+  V(js_set_element) \
+  V(js_delete_element) \
+  V(js_get_callback_info) \
+  V(js_get_typed_callback_info) \
+  V(js_get_new_target) \
+  V(js_get_arraybuffer_info) \
+  V(js_get_sharedarraybuffer_info) \
+  V(js_get_typedarray_info) \
+  V(js_get_dataview_info) \
+  V(js_get_string_view) \
+  V(js_release_string_view) \
+  V(js_call_function) \
+  V(js_call_function_with_checkpoint) \
+  V(js_new_instance) \
+  V(js_parse_json) \
+  V(js_parse_json_writer) \
+  V(js_stringify_json) \
+  V(js_create_threadsafe_function) \
+  V(js_create_batched_threadsafe_function) \
+  V(js_get_threadsafe_function_context) \
+  V(js_call_threadsafe_function) \
+  V(js_get_threadsafe_function_statistics) \
+  V(js_acquire_threadsafe_function) \
+  V(js_release_threadsafe_function) \
+  V(js_ref_threadsafe_function) \
+  V(js_unref_threadsafe_function) \
+  V(js_add_teardown_callback) \
+  V(js_remove_teardown_callback) \
+  V(js_add_deferred_teardown_callback) \
+  V(js_finish_deferred_teardown_callback) \
+  V(js_throw) \
+  V(js_vformat) \
+  V(js_throw_error) \
+  V(js_throw_verrorf) \
+  V(js_throw_errorf) \
+  V(js_throw_type_error) \
+  V(js_throw_type_verrorf) \
+  V(js_throw_type_errorf) \
+  V(js_throw_range_error) \
+  V(js_throw_range_verrorf) \
+  V(js_throw_range_errorf) \
+  V(js_throw_syntax_error) \
+  V(js_throw_syntax_verrorf) \
+  V(js_throw_syntax_errorf) \
+  V(js_is_exception_pending) \
+  V(js_get_and_clear_last_exception) \
+  V(js_fatal_exception) \
+  V(js_adjust_external_memory) \
+  V(js_flush_external_memory) \
+  V(js_get_external_memory_breakdown) \
+  V(js_get_external_memory_statistics) \
+  V(js_get_scratch_statistics) \
+  V(js_get_property_key_statistics)
+
+enum {
+#define V(name) js__trace_##name,
+  JS__TRACE_FUNCTIONS(V)
+#undef V
+  js__trace_len
+};
+
+static const char *const js__trace_names[] = {
+#define V(name) #name,
+  JS__TRACE_FUNCTIONS(V)
+#undef V
+};
+
+#define JS__TRACE_BUCKETS 496
+
+#define JS__TRACE_DEPTH 64
+
+typedef struct js__trace_thread_s js__trace_thread_t;
+
+struct js__trace_thread_s {
+  js__trace_thread_t *next;
+
+  size_t depth;
+  uint64_t stack[JS__TRACE_DEPTH];
+
+  uint64_t calls[js__trace_len];
+  uint64_t total[js__trace_len];
+  uint64_t *histograms[js__trace_len];
+};
+
+struct js__trace_s {
+  uv_mutex_t lock;
+  uv_key_t key;
+  js__trace_thread_t *threads;
+};
+
+JS__WEAK uv_once_t js__trace_once = UV_ONCE_INIT;
+
+#ifdef __cplusplus
+JS__WEAK struct js__trace_s js__trace = {};
+#else
+JS__WEAK struct js__trace_s js__trace = {0};
+#endif
+
+static inline void
+js__on_trace_init(void) {
+  int err;
+
+  err = uv_mutex_init(&js__trace.lock);
+  assert(err == 0);
+
+  err = uv_key_create(&js__trace.key);
+  assert(err == 0);
+}
+
+// The state of the calling thread as last seen by this translation unit,
+// sparing traced calls from looking it up in the shared key.
+static inline js__trace_thread_t **
+js__trace_get_current(void) {
+  static JS__THREAD_LOCAL js__trace_thread_t *thread = NULL;
+
+  return &thread;
+}
+
+static inline js__trace_thread_t *
+js__trace_get_thread(void) {
+  js__trace_thread_t **current = js__trace_get_current();
+
+  if (*current) return *current;
+
+  uv_once(&js__trace_once, js__on_trace_init);
+
+  js__trace_thread_t *thread = (js__trace_thread_t *) uv_key_get(&js__trace.key);
+
+  if (thread) return *current = thread;
+
+  // Threads are never unregistered such that their calls remain part of the
+  // trace after they exit.
+  thread = (js__trace_thread_t *) calloc(1, sizeof(js__trace_thread_t));
+
+  if (thread == NULL) return NULL;
+
+  uv_key_set(&js__trace.key, thread);
+
+  uv_mutex_lock(&js__trace.lock);
+
+  thread->next = js__trace.threads;
+  js__trace.threads = thread;
+
+  uv_mutex_unlock(&js__trace.lock);
+
+  return *current = thread;
+}
+
+static inline size_t
+js__trace_bucket(uint64_t value) {
+  if (value < 16) return (size_t) value;
+
+  int msb;
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_WIN64)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  msb = (int) index;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  msb = 63;
+  while ((value >> msb) == 0) msb--;
+#else
+  msb = 63 - __builtin_clzll(value);
+#endif
+
+  return (size_t) (msb - 2) * 8 + ((value >> (msb - 3)) & 7);
+}
+
+static inline uint64_t
+js__trace_bucket_value(size_t bucket) {
+  if (bucket < 16) return bucket;
+
+  int msb = (int) (bucket / 8) + 2;
+
+  // The highest value in the bucket
+  return ((uint64_t) (8 + bucket % 8) << (msb - 3)) + ((uint64_t) 1 << (msb - 3)) - 1;
+}
+
+static inline void
+js__trace_enter(void) {
+  js__trace_thread_t *thread = js__trace_get_thread();
+
+  if (thread == NULL) return;
+
+  if (thread->depth < JS__TRACE_DEPTH) thread->stack[thread->depth] = uv_hrtime();
+
+  thread->depth++;
+}
+
+static inline int
+js__trace_exit(int id, int result) {
+  uint64_t end = uv_hrtime();
+
+  // Set up by the matching call to `js__trace_enter()`.
+  js__trace_thread_t *thread = *js__trace_get_current();
+
+  if (thread == NULL || thread->depth == 0) return result;
+
+  thread->depth--;
+
+  if (thread->depth >= JS__TRACE_DEPTH) return result;
+
+  uint64_t elapsed = end - thread->stack[thread->depth];
+
+  thread->calls[id]++;
+  thread->total[id] += elapsed;
+
+  uint64_t *histogram = thread->histograms[id];
+
+  if (histogram == NULL) {
+    histogram = thread->histograms[id] = (uint64_t *) calloc(JS__TRACE_BUCKETS, sizeof(uint64_t));
+
+    if (histogram == NULL) return result;
+  }
+
+  histogram[js__trace_bucket(elapsed)]++;
+
+  return result;
+}
+
+/**
+ * Write the calls traced so far as JSON to `file`. Each function called at
+ * least once is listed with its number of calls along with the total, mean,
+ * and percentile latencies in nanoseconds.
+ */
+static inline int
+js_dump_trace(FILE *file) {
+  uv_once(&js__trace_once, js__on_trace_init);
+
+  uint64_t *histogram = (uint64_t *) malloc(JS__TRACE_BUCKETS * sizeof(uint64_t));
+
+  if (histogram == NULL) return -1;
+
+  static const double percentiles[] = {50, 90, 99, 99.9, 100};
+  static const char *const labels[] = {"p50", "p90", "p99", "p999", "max"};
+
+  uv_mutex_lock(&js__trace.lock);
+
+  fprintf(file, "{\"functions\":[");
+
+  bool first = true;
+
+  for (int id = 0; id < js__trace_len; id++) {
+    uint64_t calls = 0, total = 0;
+
+    memset(histogram, 0, JS__TRACE_BUCKETS * sizeof(uint64_t));
+
+    for (js__trace_thread_t *thread = js__trace.threads; thread; thread = thread->next) {
+      calls += thread->calls[id];
+      total += thread->total[id];
+
+      if (thread->histograms[id] == NULL) continue;
+
+      for (size_t i = 0; i < JS__TRACE_BUCKETS; i++) {
+        histogram[i] += thread->histograms[id][i];
+      }
+    }
+
+    if (calls == 0) continue;
+
+    fprintf(file, "%s{\"name\":\"%s\",\"calls\":%llu,\"total\":%llu,\"mean\":%llu", first ? "" : ",", js__trace_names[id], (unsigned long long) calls, (unsigned long long) total, (unsigned long long) (total / calls));
+
+    first = false;
+
+    uint64_t seen = 0;
+    size_t bucket = 0;
+
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+      uint64_t rank = (uint64_t) ceil(percentiles[i] / 100 * (double) calls);
+
+      if (rank == 0) rank = 1;
+
+      while (bucket < JS__TRACE_BUCKETS && seen + histogram[bucket] < rank) {
+        seen += histogram[bucket++];
+      }
+
+      fprintf(file, ",\"%s\":%llu", labels[i], (unsigned long long) js__trace_bucket_value(bucket));
+    }
+
+    fprintf(file, "}");
+  }
+
+  fprintf(file, "]}\n");
+
+  uv_mutex_unlock(&js__trace.lock);
+
+  free(histogram);
+
+  return ferror(file) ? -1 : 0;
+}
+
+static inline void
+js_reset_trace(void) {
+  uv_once(&js__trace_once, js__on_trace_init);
+
+  uv_mutex_lock(&js__trace.lock);
+
+  for (js__trace_thread_t *thread = js__trace.threads; thread; thread = thread->next) {
+    memset(thread->calls, 0, sizeof(thread->calls));
+    memset(thread->total, 0, sizeof(thread->total));
+
+    for (int id = 0; id < js__trace_len; id++) {
+      if (thread->histograms[id]) memset(thread->histograms[id], 0, JS__TRACE_BUCKETS * sizeof(uint64_t));
+    }
+  }
+
+  uv_mutex_unlock(&js__trace.lock);
+}
+
+// The macros below refer to the functions they replace, which the
+// preprocessor leaves unexpanded. The comma operator sequences the start of
+// the measurement before the call itself.
+
+#define js_get_env_loop(...) js__trace_exit(js__trace_js_get_env_loop, (js__trace_enter(), js_get_env_loop(__VA_ARGS__)))
+#define js_open_handle_scope(...) js__trace_exit(js__trace_js_open_handle_scope, (js__trace_enter(), js_open_handle_scope(__VA_ARGS__)))
+#define js_close_handle_scope(...) js__trace_exit(js__trace_js_close_handle_scope, (js__trace_enter(), js_close_handle_scope(__VA_ARGS__)))
+#define js_open_escapable_handle_scope(...) js__trace_exit(js__trace_js_open_escapable_handle_scope, (js__trace_enter(), js_open_escapable_handle_scope(__VA_ARGS__)))
+#define js_close_escapable_handle_scope(...) js__trace_exit(js__trace_js_close_escapable_handle_scope, (js__trace_enter(), js_close_escapable_handle_scope(__VA_ARGS__)))
+#define js_escape_handle(...) js__trace_exit(js__trace_js_escape_handle, (js__trace_enter(), js_escape_handle(__VA_ARGS__)))
+#define js_run_script(...) js__trace_exit(js__trace_js_run_script, (js__trace_enter(), js_run_script(__VA_ARGS__)))
+#define js_create_reference(...) js__trace_exit(js__trace_js_create_reference, (js__trace_enter(), js_create_reference(__VA_ARGS__)))
+#define js_delete_reference(...) js__trace_exit(js__trace_js_delete_reference, (js__trace_enter(), js_delete_reference(__VA_ARGS__)))
+#define js_reference_ref(...) js__trace_exit(js__trace_js_reference_ref, (js__trace_enter(), js_reference_ref(__VA_ARGS__)))
+#define js_reference_unref(...) js__trace_exit(js__trace_js_reference_unref, (js__trace_enter(), js_reference_unref(__VA_ARGS__)))
+#define js_get_reference_value(...) js__trace_exit(js__trace_js_get_reference_value, (js__trace_enter(), js_get_reference_value(__VA_ARGS__)))
+#define js_define_class(...) js__trace_exit(js__trace_js_define_class, (js__trace_enter(), js_define_class(__VA_ARGS__)))
+#define js_define_properties(...) js__trace_exit(js__trace_js_define_properties, (js__trace_enter(), js_define_properties(__VA_ARGS__)))
+#define js_define_static_class(...) js__trace_exit(js__trace_js_define_static_class, (js__trace_enter(), js_define_static_class(__VA_ARGS__)))
+#define js_define_static_properties(...) js__trace_exit(js__trace_js_define_static_properties, (js__trace_enter(), js_define_static_properties(__VA_ARGS__)))
+#define js_wrap(...) js__trace_exit(js__trace_js_wrap, (js__trace_enter(), js_wrap(__VA_ARGS__)))
+#define js_unwrap(...) js__trace_exit(js__trace_js_unwrap, (js__trace_enter(), js_unwrap(__VA_ARGS__)))
+#define js_remove_wrap(...) js__trace_exit(js__trace_js_remove_wrap, (js__trace_enter(), js_remove_wrap(__VA_ARGS__)))
+#define js_add_type_tag(...) js__trace_exit(js__trace_js_add_type_tag, (js__trace_enter(), js_add_type_tag(__VA_ARGS__)))
+#define js_check_type_tag(...) js__trace_exit(js__trace_js_check_type_tag, (js__trace_enter(), js_check_type_tag(__VA_ARGS__)))
+#define js_add_finalizer(...) js__trace_exit(js__trace_js_add_finalizer, (js__trace_enter(), js_add_finalizer(__VA_ARGS__)))
+#define js_create_int32(...) js__trace_exit(js__trace_js_create_int32, (js__trace_enter(), js_create_int32(__VA_ARGS__)))
+#define js_create_uint32(...) js__trace_exit(js__trace_js_create_uint32, (js__trace_enter(), js_create_uint32(__VA_ARGS__)))
+#define js_create_int64(...) js__trace_exit(js__trace_js_create_int64, (js__trace_enter(), js_create_int64(__VA_ARGS__)))
+#define js_create_double(...) js__trace_exit(js__trace_js_create_double, (js__trace_enter(), js_create_double(__VA_ARGS__)))
+#define js_create_bigint_int64(...) js__trace_exit(js__trace_js_create_bigint_int64, (js__trace_enter(), js_create_bigint_int64(__VA_ARGS__)))
+#define js_create_bigint_uint64(...) js__trace_exit(js__trace_js_create_bigint_uint64, (js__trace_enter(), js_create_bigint_uint64(__VA_ARGS__)))
+#define js_create_bigint_words(...) js__trace_exit(js__trace_js_create_bigint_words, (js__trace_enter(), js_create_bigint_words(__VA_ARGS__)))
+#define js_create_string_utf8(...) js__trace_exit(js__trace_js_create_string_utf8, (js__trace_enter(), js_create_string_utf8(__VA_ARGS__)))
+#define js_create_string_utf16le(...) js__trace_exit(js__trace_js_create_string_utf16le, (js__trace_enter(), js_create_string_utf16le(__VA_ARGS__)))
+#define js_create_string_latin1(...) js__trace_exit(js__trace_js_create_string_latin1, (js__trace_enter(), js_create_string_latin1(__VA_ARGS__)))
+#define js_create_external_string_utf8(...) js__trace_exit(js__trace_js_create_external_string_utf8, (js__trace_enter(), js_create_external_string_utf8(__VA_ARGS__)))
+#define js_create_external_string_utf16le(...) js__trace_exit(js__trace_js_create_external_string_utf16le, (js__trace_enter(), js_create_external_string_utf16le(__VA_ARGS__)))
+#define js_create_external_string_latin1(...) js__trace_exit(js__trace_js_create_external_string_latin1, (js__trace_enter(), js_create_external_string_latin1(__VA_ARGS__)))
+#define js_create_property_key_utf8(...) js__trace_exit(js__trace_js_create_property_key_utf8, (js__trace_enter(), js_create_property_key_utf8(__VA_ARGS__)))
+#define js_create_property_key_utf16le(...) js__trace_exit(js__trace_js_create_property_key_utf16le, (js__trace_enter(), js_create_property_key_utf16le(__VA_ARGS__)))
+#define js_create_property_key_latin1(...) js__trace_exit(js__trace_js_create_property_key_latin1, (js__trace_enter(), js_create_property_key_latin1(__VA_ARGS__)))
+#define js_create_symbol(...) js__trace_exit(js__trace_js_create_symbol, (js__trace_enter(), js_create_symbol(__VA_ARGS__)))
+#define js_symbol_for(...) js__trace_exit(js__trace_js_symbol_for, (js__trace_enter(), js_symbol_for(__VA_ARGS__)))
+#define js_create_object(...) js__trace_exit(js__trace_js_create_object, (js__trace_enter(), js_create_object(__VA_ARGS__)))
+#define js_create_function(...) js__trace_exit(js__trace_js_create_function, (js__trace_enter(), js_create_function(__VA_ARGS__)))
+#define js_create_typed_function(...) js__trace_exit(js__trace_js_create_typed_function, (js__trace_enter(), js_create_typed_function(__VA_ARGS__)))
+#define js_create_array(...) js__trace_exit(js__trace_js_create_array, (js__trace_enter(), js_create_array(__VA_ARGS__)))
+#define js_create_array_with_length(...) js__trace_exit(js__trace_js_create_array_with_length, (js__trace_enter(), js_create_array_with_length(__VA_ARGS__)))
+#define js_create_external(...) js__trace_exit(js__trace_js_create_external, (js__trace_enter(), js_create_external(__VA_ARGS__)))
+#define js_create_date(...) js__trace_exit(js__trace_js_create_date, (js__trace_enter(), js_create_date(__VA_ARGS__)))
+#define js_create_error(...) js__trace_exit(js__trace_js_create_error, (js__trace_enter(), js_create_error(__VA_ARGS__)))
+#define js_create_type_error(...) js__trace_exit(js__trace_js_create_type_error, (js__trace_enter(), js_create_type_error(__VA_ARGS__)))
+#define js_create_range_error(...) js__trace_exit(js__trace_js_create_range_error, (js__trace_enter(), js_create_range_error(__VA_ARGS__)))
+#define js_create_syntax_error(...) js__trace_exit(js__trace_js_create_syntax_error, (js__trace_enter(), js_create_syntax_error(__VA_ARGS__)))
+#define js_create_promise(...) js__trace_exit(js__trace_js_create_promise, (js__trace_enter(), js_create_promise(__VA_ARGS__)))
+#define js_resolve_deferred(...) js__trace_exit(js__trace_js_resolve_deferred, (js__trace_enter(), js_resolve_deferred(__VA_ARGS__)))
+#define js_reject_deferred(...) js__trace_exit(js__trace_js_reject_deferred, (js__trace_enter(), js_reject_deferred(__VA_ARGS__)))
+#define js_queue_task(...) js__trace_exit(js__trace_js_queue_task, (js__trace_enter(), js_queue_task(__VA_ARGS__)))
+#define js_cancel_task(...) js__trace_exit(js__trace_js_cancel_task, (js__trace_enter(), js_cancel_task(__VA_ARGS__)))
+#define js_get_task_statistics(...) js__trace_exit(js__trace_js_get_task_statistics, (js__trace_enter(), js_get_task_statistics(__VA_ARGS__)))
+#define js_create_arraybuffer(...) js__trace_exit(js__trace_js_create_arraybuffer, (js__trace_enter(), js_create_arraybuffer(__VA_ARGS__)))
+#define js_create_external_arraybuffer(...) js__trace_exit(js__trace_js_create_external_arraybuffer, (js__trace_enter(), js_create_external_arraybuffer(__VA_ARGS__)))
+#define js_create_unsafe_arraybuffer(...) js__trace_exit(js__trace_js_create_unsafe_arraybuffer, (js__trace_enter(), js_create_unsafe_arraybuffer(__VA_ARGS__)))
+#define js_create_sharedarraybuffer(...) js__trace_exit(js__trace_js_create_sharedarraybuffer, (js__trace_enter(), js_create_sharedarraybuffer(__VA_ARGS__)))
+#define js_create_external_sharedarraybuffer(...) js__trace_exit(js__trace_js_create_external_sharedarraybuffer, (js__trace_enter(), js_create_external_sharedarraybuffer(__VA_ARGS__)))
+#define js_create_mapped_arraybuffer(...) js__trace_exit(js__trace_js_create_mapped_arraybuffer, (js__trace_enter(), js_create_mapped_arraybuffer(__VA_ARGS__)))
+#define js_advise_mapped_arraybuffer(...) js__trace_exit(js__trace_js_advise_mapped_arraybuffer, (js__trace_enter(), js_advise_mapped_arraybuffer(__VA_ARGS__)))
+#define js_detach_arraybuffer(...) js__trace_exit(js__trace_js_detach_arraybuffer, (js__trace_enter(), js_detach_arraybuffer(__VA_ARGS__)))
+#define js_create_typedarray(...) js__trace_exit(js__trace_js_create_typedarray, (js__trace_enter(), js_create_typedarray(__VA_ARGS__)))
+#define js_create_pooled_typedarray(...) js__trace_exit(js__trace_js_create_pooled_typedarray, (js__trace_enter(), js_create_pooled_typedarray(__VA_ARGS__)))
+#define js_create_dataview(...) js__trace_exit(js__trace_js_create_dataview, (js__trace_enter(), js_create_dataview(__VA_ARGS__)))
+#define js_coerce_to_boolean(...) js__trace_exit(js__trace_js_coerce_to_boolean, (js__trace_enter(), js_coerce_to_boolean(__VA_ARGS__)))
+#define js_coerce_to_number(...) js__trace_exit(js__trace_js_coerce_to_number, (js__trace_enter(), js_coerce_to_number(__VA_ARGS__)))
+#define js_coerce_to_string(...) js__trace_exit(js__trace_js_coerce_to_string, (js__trace_enter(), js_coerce_to_string(__VA_ARGS__)))
+#define js_coerce_to_object(...) js__trace_exit(js__trace_js_coerce_to_object, (js__trace_enter(), js_coerce_to_object(__VA_ARGS__)))
+#define js_typeof(...) js__trace_exit(js__trace_js_typeof, (js__trace_enter(), js_typeof(__VA_ARGS__)))
+#define js_instanceof(...) js__trace_exit(js__trace_js_instanceof, (js__trace_enter(), js_instanceof(__VA_ARGS__)))
+#define js_is_undefined(...) js__trace_exit(js__trace_js_is_undefined, (js__trace_enter(), js_is_undefined(__VA_ARGS__)))
+#define js_is_null(...) js__trace_exit(js__trace_js_is_null, (js__trace_enter(), js_is_null(__VA_ARGS__)))
+#define js_is_boolean(...) js__trace_exit(js__trace_js_is_boolean, (js__trace_enter(), js_is_boolean(__VA_ARGS__)))
+#define js_is_number(...) js__trace_exit(js__trace_js_is_number, (js__trace_enter(), js_is_number(__VA_ARGS__)))
+#define js_is_int32(...) js__trace_exit(js__trace_js_is_int32, (js__trace_enter(), js_is_int32(__VA_ARGS__)))
+#define js_is_uint32(...) js__trace_exit(js__trace_js_is_uint32, (js__trace_enter(), js_is_uint32(__VA_ARGS__)))
+#define js_is_string(...) js__trace_exit(js__trace_js_is_string, (js__trace_enter(), js_is_string(__VA_ARGS__)))
+#define js_is_symbol(...) js__trace_exit(js__trace_js_is_symbol, (js__trace_enter(), js_is_symbol(__VA_ARGS__)))
+#define js_is_object(...) js__trace_exit(js__trace_js_is_object, (js__trace_enter(), js_is_object(__VA_ARGS__)))
+#define js_is_function(...) js__trace_exit(js__trace_js_is_function, (js__trace_enter(), js_is_function(__VA_ARGS__)))
+#define js_is_array(...) js__trace_exit(js__trace_js_is_array, (js__trace_enter(), js_is_array(__VA_ARGS__)))
+#define js_is_external(...) js__trace_exit(js__trace_js_is_external, (js__trace_enter(), js_is_external(__VA_ARGS__)))
+#define js_is_bigint(...) js__trace_exit(js__trace_js_is_bigint, (js__trace_enter(), js_is_bigint(__VA_ARGS__)))
+#define js_is_date(...) js__trace_exit(js__trace_js_is_date, (js__trace_enter(), js_is_date(__VA_ARGS__)))
+#define js_is_error(...) js__trace_exit(js__trace_js_is_error, (js__trace_enter(), js_is_error(__VA_ARGS__)))
+#define js_is_promise(...) js__trace_exit(js__trace_js_is_promise, (js__trace_enter(), js_is_promise(__VA_ARGS__)))
+#define js_is_arraybuffer(...) js__trace_exit(js__trace_js_is_arraybuffer, (js__trace_enter(), js_is_arraybuffer(__VA_ARGS__)))
+#define js_is_sharedarraybuffer(...) js__trace_exit(js__trace_js_is_sharedarraybuffer, (js__trace_enter(), js_is_sharedarraybuffer(__VA_ARGS__)))
+#define js_is_detached_arraybuffer(...) js__trace_exit(js__trace_js_is_detached_arraybuffer, (js__trace_enter(), js_is_detached_arraybuffer(__VA_ARGS__)))
+#define js_is_typedarray(...) js__trace_exit(js__trace_js_is_typedarray, (js__trace_enter(), js_is_typedarray(__VA_ARGS__)))
+#define js_is_int8array(...) js__trace_exit(js__trace_js_is_int8array, (js__trace_enter(), js_is_int8array(__VA_ARGS__)))
+#define js_is_uint8array(...) js__trace_exit(js__trace_js_is_uint8array, (js__trace_enter(), js_is_uint8array(__VA_ARGS__)))
+#define js_is_uint8clampedarray(...) js__trace_exit(js__trace_js_is_uint8clampedarray, (js__trace_enter(), js_is_uint8clampedarray(__VA_ARGS__)))
+#define js_is_int16array(...) js__trace_exit(js__trace_js_is_int16array, (js__trace_enter(), js_is_int16array(__VA_ARGS__)))
+#define js_is_uint16array(...) js__trace_exit(js__trace_js_is_uint16array, (js__trace_enter(), js_is_uint16array(__VA_ARGS__)))
+#define js_is_int32array(...) js__trace_exit(js__trace_js_is_int32array, (js__trace_enter(), js_is_int32array(__VA_ARGS__)))
+#define js_is_uint32array(...) js__trace_exit(js__trace_js_is_uint32array, (js__trace_enter(), js_is_uint32array(__VA_ARGS__)))
+#define js_is_float32array(...) js__trace_exit(js__trace_js_is_float32array, (js__trace_enter(), js_is_float32array(__VA_ARGS__)))
+#define js_is_float64array(...) js__trace_exit(js__trace_js_is_float64array, (js__trace_enter(), js_is_float64array(__VA_ARGS__)))
+#define js_is_bigint64array(...) js__trace_exit(js__trace_js_is_bigint64array, (js__trace_enter(), js_is_bigint64array(__VA_ARGS__)))
+#define js_is_biguint64array(...) js__trace_exit(js__trace_js_is_biguint64array, (js__trace_enter(), js_is_biguint64array(__VA_ARGS__)))
+#define js_is_dataview(...) js__trace_exit(js__trace_js_is_dataview, (js__trace_enter(), js_is_dataview(__VA_ARGS__)))
+#define js_classify_value(...) js__trace_exit(js__trace_js_classify_value, (js__trace_enter(), js_classify_value(__VA_ARGS__)))
+#define js_strict_equals(...) js__trace_exit(js__trace_js_strict_equals, (js__trace_enter(), js_strict_equals(__VA_ARGS__)))
+#define js_get_global(...) js__trace_exit(js__trace_js_get_global, (js__trace_enter(), js_get_global(__VA_ARGS__)))
+#define js_get_undefined(...) js__trace_exit(js__trace_js_get_undefined, (js__trace_enter(), js_get_undefined(__VA_ARGS__)))
+#define js_get_null(...) js__trace_exit(js__trace_js_get_null, (js__trace_enter(), js_get_null(__VA_ARGS__)))
+#define js_get_boolean(...) js__trace_exit(js__trace_js_get_boolean, (js__trace_enter(), js_get_boolean(__VA_ARGS__)))
+#define js_get_value_bool(...) js__trace_exit(js__trace_js_get_value_bool, (js__trace_enter(), js_get_value_bool(__VA_ARGS__)))
+#define js_get_value_int32(...) js__trace_exit(js__trace_js_get_value_int32, (js__trace_enter(), js_get_value_int32(__VA_ARGS__)))
+#define js_get_value_uint32(...) js__trace_exit(js__trace_js_get_value_uint32, (js__trace_enter(), js_get_value_uint32(__VA_ARGS__)))
+#define js_get_value_int64(...) js__trace_exit(js__trace_js_get_value_int64, (js__trace_enter(), js_get_value_int64(__VA_ARGS__)))
+#define js_get_value_double(...) js__trace_exit(js__trace_js_get_value_double, (js__trace_enter(), js_get_value_double(__VA_ARGS__)))
+#define js_get_value_bigint_int64(...) js__trace_exit(js__trace_js_get_value_bigint_int64, (js__trace_enter(), js_get_value_bigint_int64(__VA_ARGS__)))
+#define js_get_value_bigint_uint64(...) js__trace_exit(js__trace_js_get_value_bigint_uint64, (js__trace_enter(), js_get_value_bigint_uint64(__VA_ARGS__)))
+#define js_get_value_bigint_words(...) js__trace_exit(js__trace_js_get_value_bigint_words, (js__trace_enter(), js_get_value_bigint_words(__VA_ARGS__)))
+#define js_get_value_string_utf8(...) js__trace_exit(js__trace_js_get_value_string_utf8, (js__trace_enter(), js_get_value_string_utf8(__VA_ARGS__)))
+#define js_get_value_string_utf16le(...) js__trace_exit(js__trace_js_get_value_string_utf16le, (js__trace_enter(), js_get_value_string_utf16le(__VA_ARGS__)))
+#define js_get_value_string_latin1(...) js__trace_exit(js__trace_js_get_value_string_latin1, (js__trace_enter(), js_get_value_string_latin1(__VA_ARGS__)))
+#define js_get_value_external(...) js__trace_exit(js__trace_js_get_value_external, (js__trace_enter(), js_get_value_external(__VA_ARGS__)))
+#define js_get_value_date(...) js__trace_exit(js__trace_js_get_value_date, (js__trace_enter(), js_get_value_date(__VA_ARGS__)))
+#define js_get_array_length(...) js__trace_exit(js__trace_js_get_array_length, (js__trace_enter(), js_get_array_length(__VA_ARGS__)))
+#define js_get_array_elements(...) js__trace_exit(js__trace_js_get_array_elements, (js__trace_enter(), js_get_array_elements(__VA_ARGS__)))
+#define js_set_array_elements(...) js__trace_exit(js__trace_js_set_array_elements, (js__trace_enter(), js_set_array_elements(__VA_ARGS__)))
+#define js_encode_record(...) js__trace_exit(js__trace_js_encode_record, (js__trace_enter(), js_encode_record(__VA_ARGS__)))
+#define js_decode_record(...) js__trace_exit(js__trace_js_decode_record, (js__trace_enter(), js_decode_record(__VA_ARGS__)))
+#define js_encode_records(...) js__trace_exit(js__trace_js_encode_records, (js__trace_enter(), js_encode_records(__VA_ARGS__)))
+#define js_decode_records(...) js__trace_exit(js__trace_js_decode_records, (js__trace_enter(), js_decode_records(__VA_ARGS__)))
+#define js_get_prototype(...) js__trace_exit(js__trace_js_get_prototype, (js__trace_enter(), js_get_prototype(__VA_ARGS__)))
+#define js_get_property_names(...) js__trace_exit(js__trace_js_get_property_names, (js__trace_enter(), js_get_property_names(__VA_ARGS__)))
+#define js_get_property(...) js__trace_exit(js__trace_js_get_property, (js__trace_enter(), js_get_property(__VA_ARGS__)))
+#define js_has_property(...) js__trace_exit(js__trace_js_has_property, (js__trace_enter(), js_has_property(__VA_ARGS__)))
+#define js_set_property(...) js__trace_exit(js__trace_js_set_property, (js__trace_enter(), js_set_property(__VA_ARGS__)))
+#define js_delete_property(...) js__trace_exit(js__trace_js_delete_property, (js__trace_enter(), js_delete_property(__VA_ARGS__)))
+#define js_get_named_property(...) js__trace_exit(js__trace_js_get_named_property, (js__trace_enter(), js_get_named_property(__VA_ARGS__)))
+#define js_has_named_property(...) js__trace_exit(js__trace_js_has_named_property, (js__trace_enter(), js_has_named_property(__VA_ARGS__)))
+#define js_set_named_property(...) js__trace_exit(js__trace_js_set_named_property, (js__trace_enter(), js_set_named_property(__VA_ARGS__)))
+#define js_delete_named_property(...) js__trace_exit(js__trace_js_delete_named_property, (js__trace_enter(), js_delete_named_property(__VA_ARGS__)))
+#define js_get_element(...) js__trace_exit(js__trace_js_get_element, (js__trace_enter(), js_get_element(__VA_ARGS__)))
+#define js_has_element(...) js__trace_exit(js__trace_js_has_element, (js__trace_enter(), js_has_element(__VA_ARGS__)))
+#define js_set_element(...) js__trace_exit(js__trace_js_set_element, (js__trace_enter(), js_set_element(__VA_ARGS__)))
+#define js_delete_element(...) js__trace_exit(js__trace_js_delete_element, (js__trace_enter(), js_delete_element(__VA_ARGS__)))
+#define js_get_callback_info(...) js__trace_exit(js__trace_js_get_callback_info, (js__trace_enter(), js_get_callback_info(__VA_ARGS__)))
+#define js_get_typed_callback_info(...) js__trace_exit(js__trace_js_get_typed_callback_info, (js__trace_enter(), js_get_typed_callback_info(__VA_ARGS__)))
+#define js_get_new_target(...) js__trace_exit(js__trace_js_get_new_target, (js__trace_enter(), js_get_new_target(__VA_ARGS__)))
+#define js_get_arraybuffer_info(...) js__trace_exit(js__trace_js_get_arraybuffer_info, (js__trace_enter(), js_get_arraybuffer_info(__VA_ARGS__)))
+#define js_get_sharedarraybuffer_info(...) js__trace_exit(js__trace_js_get_sharedarraybuffer_info, (js__trace_enter(), js_get_sharedarraybuffer_info(__VA_ARGS__)))
+#define js_get_typedarray_info(...) js__trace_exit(js__trace_js_get_typedarray_info, (js__trace_enter(), js_get_typedarray_info(__VA_ARGS__)))
+#define js_get_dataview_info(...) js__trace_exit(js__trace_js_get_dataview_info, (js__trace_enter(), js_get_dataview_info(__VA_ARGS__)))
+#define js_get_string_view(...) js__trace_exit(js__trace_js_get_string_view, (js__trace_enter(), js_get_string_view(__VA_ARGS__)))
+#define js_release_string_view(...) js__trace_exit(js__trace_js_release_string_view, (js__trace_enter(), js_release_string_view(__VA_ARGS__)))
+#define js_call_function(...) js__trace_exit(js__trace_js_call_function, (js__trace_enter(), js_call_function(__VA_ARGS__)))
+#define js_call_function_with_checkpoint(...) js__trace_exit(js__trace_js_call_function_with_checkpoint, (js__trace_enter(), js_call_function_with_checkpoint(__VA_ARGS__)))
+#define js_new_instance(...) js__trace_exit(js__trace_js_new_instance, (js__trace_enter(), js_new_instance(__VA_ARGS__)))
+#define js_parse_json(...) js__trace_exit(js__trace_js_parse_json, (js__trace_enter(), js_parse_json(__VA_ARGS__)))
+#define js_parse_json_writer(...) js__trace_exit(js__trace_js_parse_json_writer, (js__trace_enter(), js_parse_json_writer(__VA_ARGS__)))
+#define js_stringify_json(...) js__trace_exit(js__trace_js_stringify_json, (js__trace_enter(), js_stringify_json(__VA_ARGS__)))
+#define js_create_threadsafe_function(...) js__trace_exit(js__trace_js_create_threadsafe_function, (js__trace_enter(), js_create_threadsafe_function(__VA_ARGS__)))
+#define js_create_batched_threadsafe_function(...) js__trace_exit(js__trace_js_create_batched_threadsafe_function, (js__trace_enter(), js_create_batched_threadsafe_function(__VA_ARGS__)))
+#define js_get_threadsafe_function_context(...) js__trace_exit(js__trace_js_get_threadsafe_function_context, (js__trace_enter(), js_get_threadsafe_function_context(__VA_ARGS__)))
+#define js_call_threadsafe_function(...) js__trace_exit(js__trace_js_call_threadsafe_function, (js__trace_enter(), js_call_threadsafe_function(__VA_ARGS__)))
+#define js_get_threadsafe_function_statistics(...) js__trace_exit(js__trace_js_get_threadsafe_function_statistics, (js__trace_enter(), js_get_threadsafe_function_statistics(__VA_ARGS__)))
+#define js_acquire_threadsafe_function(...) js__trace_exit(js__trace_js_acquire_threadsafe_function, (js__trace_enter(), js_acquire_threadsafe_function(__VA_ARGS__)))
+#define js_release_threadsafe_function(...) js__trace_exit(js__trace_js_release_threadsafe_function, (js__trace_enter(), js_release_threadsafe_function(__VA_ARGS__)))
+#define js_ref_threadsafe_function(...) js__trace_exit(js__trace_js_ref_threadsafe_function, (js__trace_enter(), js_ref_threadsafe_function(__VA_ARGS__)))
+#define js_unref_threadsafe_function(...) js__trace_exit(js__trace_js_unref_threadsafe_function, (js__trace_enter(), js_unref_threadsafe_function(__VA_ARGS__)))
+#define js_add_teardown_callback(...) js__trace_exit(js__trace_js_add_teardown_callback, (js__trace_enter(), js_add_teardown_callback(__VA_ARGS__)))
+#define js_remove_teardown_callback(...) js__trace_exit(js__trace_js_remove_teardown_callback, (js__trace_enter(), js_remove_teardown_callback(__VA_ARGS__)))
+#define js_add_deferred_teardown_callback(...) js__trace_exit(js__trace_js_add_deferred_teardown_callback, (js__trace_enter(), js_add_deferred_teardown_callback(__VA_ARGS__)))
+#define js_finish_deferred_teardown_callback(...) js__trace_exit(js__trace_js_finish_deferred_teardown_callback, (js__trace_enter(), js_finish_deferred_teardown_callback(__VA_ARGS__)))
+#define js_throw(...) js__trace_exit(js__trace_js_throw, (js__trace_enter(), js_throw(__VA_ARGS__)))
+#define js_vformat(...) js__trace_exit(js__trace_js_vformat, (js__trace_enter(), js_vformat(__VA_ARGS__)))
+#define js_throw_error(...) js__trace_exit(js__trace_js_throw_error, (js__trace_enter(), js_throw_error(__VA_ARGS__)))
+#define js_throw_verrorf(...) js__trace_exit(js__trace_js_throw_verrorf, (js__trace_enter(), js_throw_verrorf(__VA_ARGS__)))
+#define js_throw_errorf(...) js__trace_exit(js__trace_js_throw_errorf, (js__trace_enter(), js_throw_errorf(__VA_ARGS__)))
+#define js_throw_type_error(...) js__trace_exit(js__trace_js_throw_type_error, (js__trace_enter(), js_throw_type_error(__VA_ARGS__)))
+#define js_throw_type_verrorf(...) js__trace_exit(js__trace_js_throw_type_verrorf, (js__trace_enter(), js_throw_type_verrorf(__VA_ARGS__)))
+#define js_throw_type_errorf(...) js__trace_exit(js__trace_js_throw_type_errorf, (js__trace_enter(), js_throw_type_errorf(__VA_ARGS__)))
+#define js_throw_range_error(...) js__trace_exit(js__trace_js_throw_range_error, (js__trace_enter(), js_throw_range_error(__VA_ARGS__)))
+#define js_throw_range_verrorf(...) js__trace_exit(js__trace_js_throw_range_verrorf, (js__trace_enter(), js_throw_range_verrorf(__VA_ARGS__)))
+#define js_throw_range_errorf(...) js__trace_exit(js__trace_js_throw_range_errorf, (js__trace_enter(), js_throw_range_errorf(__VA_ARGS__)))
+#define js_throw_syntax_error(...) js__trace_exit(js__trace_js_throw_syntax_error, (js__trace_enter(), js_throw_syntax_error(__VA_ARGS__)))
+#define js_throw_syntax_verrorf(...) js__trace_exit(js__trace_js_throw_syntax_verrorf, (js__trace_enter(), js_throw_syntax_verrorf(__VA_ARGS__)))
+#define js_throw_syntax_errorf(...) js__trace_exit(js__trace_js_throw_syntax_errorf, (js__trace_enter(), js_throw_syntax_errorf(__VA_ARGS__)))
+#define js_is_exception_pending(...) js__trace_exit(js__trace_js_is_exception_pending, (js__trace_enter(), js_is_exception_pending(__VA_ARGS__)))
+#define js_get_and_clear_last_exception(...) js__trace_exit(js__trace_js_get_and_clear_last_exception, (js__trace_enter(), js_get_and_clear_last_exception(__VA_ARGS__)))
+#define js_fatal_exception(...) js__trace_exit(js__trace_js_fatal_exception, (js__trace_enter(), js_fatal_exception(__VA_ARGS__)))
+#define js_adjust_external_memory(...) js__trace_exit(js__trace_js_adjust_external_memory, (js__trace_enter(), js_adjust_external_memory(__VA_ARGS__)))
+#define js_flush_external_memory(...) js__trace_exit(js__trace_js_flush_external_memory, (js__trace_enter(), js_flush_external_memory(__VA_ARGS__)))
+#define js_get_external_memory_breakdown(...) js__trace_exit(js__trace_js_get_external_memory_breakdown, (js__trace_enter(), js_get_external_memory_breakdown(__VA_ARGS__)))
+#define js_get_external_memory_statistics(...) js__trace_exit(js__trace_js_get_external_memory_statistics, (js__trace_enter(), js_get_external_memory_statistics(__VA_ARGS__)))
+#define js_get_scratch_statistics(...) js__trace_exit(js__trace_js_get_scratch_statistics, (js__trace_enter(), js_get_scratch_statistics(__VA_ARGS__)))
+#define js_get_property_key_statistics(...) js__trace_exit(js__trace_js_get_property_key_statistics, (js__trace_enter(), js_get_property_key_statistics(__VA_ARGS__)))
+
+#endif // JS_TRACE
+
 #ifdef __cplusplus
 }
 #endif
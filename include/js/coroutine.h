@@ -0,0 +1,673 @@
+#ifndef JS_COROUTINE_H
+#define JS_COROUTINE_H
+
+#include <coroutine>
+#include <exception>
+#include <stdint.h>
+#include <utility>
+
+#include <js.h>
+#include <uv.h>
+
+/**
+ * Coroutines for asynchronous addon code. A `js::task<T>` is started right
+ * away when called and runs until its first suspension, after which it's
+ * resumed on the thread owning the environment once the awaited operation has
+ * completed:
+ *
+ *     static js::task<js_value_t *>
+ *     compute(js_env_t *env, js_callback_info_t *info) {
+ *       uint64_t sum = 0;
+ *
+ *       int err = co_await js::queue_work(env, [&] { sum = ...; });
+ *       if (err < 0) co_return NULL;
+ *
+ *       js_value_t *result;
+ *       err = js_create_int64(env, (int64_t) sum, &result);
+ *       if (err < 0) co_return NULL;
+ *
+ *       co_return result;
+ *     }
+ *
+ *     js_create_function(env, "compute", -1, js::async_function<compute>, NULL, &fn);
+ *
+ * Operations report errors the same way as `js_*` functions, by returning a
+ * negative error code or a `NULL` value with a pending exception. A task that
+ * returns `NULL` rejects its promise with the pending exception.
+ *
+ * Every resumption runs in its own handle scope, so values created before a
+ * suspension must not be used after it unless they're kept alive by a
+ * reference. Awaiters live in the coroutine frame and so need no allocations
+ * of their own, and must be awaited from a `js::task`.
+ *
+ * Coroutines require C++20, which targets including this header must enable
+ * themselves.
+ */
+
+namespace js {
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+template <typename T>
+struct task_result {
+  T value{};
+
+  void
+  return_value(T result) {
+    value = std::move(result);
+  }
+
+  T
+  take() {
+    return std::move(value);
+  }
+};
+
+template <>
+struct task_result<void> {
+  void
+  return_void() {}
+
+  void
+  take() {}
+};
+
+/**
+ * The async context of a task, created the first time the task is resumed
+ * from a libuv callback and reused for every later resumption. Resuming runs
+ * the coroutine within a handle scope and a callback scope, such that
+ * microtasks queued by the coroutine are run once it suspends again.
+ */
+class async_context {
+public:
+  async_context() = default;
+
+  async_context(const async_context &) = delete;
+
+  async_context &
+  operator=(const async_context &) = delete;
+
+  ~async_context() {
+    if (context_ == NULL) return;
+
+    napi_async_destroy(env_, context_);
+    napi_delete_reference(env_, resource_);
+  }
+
+  void
+  resume(js_env_t *env, std::coroutine_handle<> handle) {
+    js_handle_scope_t *scope;
+    int err = js_open_handle_scope(env, &scope);
+
+    napi_status status = napi_generic_failure;
+
+    napi_value resource;
+    napi_callback_scope callback_scope;
+
+    if (err == 0) {
+      status = context_ ? napi_get_reference_value(env, resource_, &resource) : init(env, &resource);
+
+      if (status == napi_ok) status = napi_open_callback_scope(env, resource, context_, &callback_scope);
+    }
+
+    // Finishing the coroutine may destroy the frame holding the context, so
+    // it must not be used past this point.
+    handle.resume();
+
+    if (status == napi_ok) napi_close_callback_scope(env, callback_scope);
+
+    if (err == 0) js_close_handle_scope(env, scope);
+  }
+
+private:
+  napi_status
+  init(js_env_t *env, napi_value *resource) {
+    napi_status status;
+
+    napi_value name;
+    status = napi_create_string_utf8(env, "js_coroutine", NAPI_AUTO_LENGTH, &name);
+    if (status != napi_ok) return status;
+
+    status = napi_create_object(env, resource);
+    if (status != napi_ok) return status;
+
+    status = napi_create_reference(env, *resource, 1, &resource_);
+    if (status != napi_ok) return status;
+
+    status = napi_async_init(env, *resource, name, &context_);
+
+    if (status != napi_ok) {
+      napi_delete_reference(env, resource_);
+
+      context_ = NULL;
+
+      return status;
+    }
+
+    env_ = env;
+
+    return napi_ok;
+  }
+
+  js_env_t *env_ = NULL;
+  napi_async_context context_ = NULL;
+  napi_ref resource_ = NULL;
+};
+
+template <typename T>
+struct task_promise : task_result<T> {
+  std::coroutine_handle<> continuation;
+
+  async_context context;
+
+  struct final_awaiter {
+    bool
+    await_ready() noexcept {
+      return false;
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<task_promise> handle) noexcept {
+      std::coroutine_handle<> continuation = handle.promise().continuation;
+
+      return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void
+    await_resume() noexcept {}
+  };
+
+  task<T>
+  get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+  }
+
+  std::suspend_never
+  initial_suspend() noexcept {
+    return {};
+  }
+
+  final_awaiter
+  final_suspend() noexcept {
+    return {};
+  }
+
+  void
+  unhandled_exception() noexcept {
+    std::terminate();
+  }
+};
+
+/**
+ * Base of awaiters suspending on the event loop. While suspended, they keep
+ * the environment from being torn down, and cancel the operation if it is.
+ */
+class loop_awaiter {
+public:
+  bool
+  await_ready() noexcept {
+    return false;
+  }
+
+  int
+  await_resume() noexcept {
+    if (status_ == 0) return 0;
+
+    js_throw_error(env_, uv_err_name(status_), uv_strerror(status_));
+
+    return js_pending_exception;
+  }
+
+protected:
+  using cancel_cb = void (*)(loop_awaiter *);
+
+  loop_awaiter(js_env_t *env, cancel_cb cancel) : env_(env), cancel_(cancel) {}
+
+  loop_awaiter(const loop_awaiter &) = delete;
+
+  loop_awaiter &
+  operator=(const loop_awaiter &) = delete;
+
+  template <typename T>
+  uv_loop_t *
+  suspend(std::coroutine_handle<task_promise<T>> handle) {
+    uv_loop_t *loop;
+
+    if (js_get_env_loop(env_, &loop) != 0) {
+      status_ = UV_EINVAL;
+
+      return NULL;
+    }
+
+    handle_ = handle;
+    context_ = &handle.promise().context;
+
+    return loop;
+  }
+
+  void
+  hold() {
+#if NAPI_VERSION >= 8
+    js_add_deferred_teardown_callback(env_, on_teardown, this, &teardown_);
+#endif
+  }
+
+  void
+  release() {
+#if NAPI_VERSION >= 8
+    if (teardown_) js_finish_deferred_teardown_callback(teardown_);
+
+    teardown_ = NULL;
+#endif
+
+    context_->resume(env_, handle_);
+  }
+
+  js_env_t *env_;
+  std::coroutine_handle<> handle_;
+  async_context *context_ = NULL;
+  int status_ = 0;
+
+private:
+#if NAPI_VERSION >= 8
+  static void
+  on_teardown(js_deferred_teardown_t *handle, void *data) {
+    loop_awaiter *awaiter = static_cast<loop_awaiter *>(data);
+
+    awaiter->cancel_(awaiter);
+  }
+
+  js_deferred_teardown_t *teardown_ = NULL;
+#endif
+
+  cancel_cb cancel_;
+};
+
+template <typename F>
+class work_awaiter : public loop_awaiter {
+public:
+  work_awaiter(js_env_t *env, F &&fn) : loop_awaiter(env, cancel), fn_(std::forward<F>(fn)) {}
+
+  template <typename T>
+  bool
+  await_suspend(std::coroutine_handle<task_promise<T>> handle) noexcept {
+    uv_loop_t *loop = suspend(handle);
+
+    if (loop == NULL) return false;
+
+    req_.data = this;
+
+    status_ = uv_queue_work(loop, &req_, on_work, on_after_work);
+
+    if (status_ < 0) return false;
+
+    hold();
+
+    return true;
+  }
+
+private:
+  static void
+  on_work(uv_work_t *req) {
+    static_cast<work_awaiter *>(req->data)->fn_();
+  }
+
+  static void
+  on_after_work(uv_work_t *req, int status) {
+    work_awaiter *awaiter = static_cast<work_awaiter *>(req->data);
+
+    awaiter->status_ = status;
+
+    awaiter->release();
+  }
+
+  static void
+  cancel(loop_awaiter *awaiter) {
+    uv_cancel(reinterpret_cast<uv_req_t *>(&static_cast<work_awaiter *>(awaiter)->req_));
+  }
+
+  F fn_;
+  uv_work_t req_;
+};
+
+class timer_awaiter : public loop_awaiter {
+public:
+  timer_awaiter(js_env_t *env, uint64_t timeout) : loop_awaiter(env, cancel), timeout_(timeout) {}
+
+  template <typename T>
+  bool
+  await_suspend(std::coroutine_handle<task_promise<T>> handle) noexcept {
+    uv_loop_t *loop = suspend(handle);
+
+    if (loop == NULL) return false;
+
+    status_ = uv_timer_init(loop, &timer_);
+
+    if (status_ < 0) return false;
+
+    timer_.data = this;
+
+    status_ = uv_timer_start(&timer_, on_timeout, timeout_, 0);
+
+    // The handle must be closed before the frame is resumed and the timer goes
+    // out of scope, so resume from the close callback even on failure.
+    if (status_ < 0) uv_close(reinterpret_cast<uv_handle_t *>(&timer_), on_close);
+
+    hold();
+
+    return true;
+  }
+
+private:
+  static void
+  on_timeout(uv_timer_t *handle) {
+    uv_close(reinterpret_cast<uv_handle_t *>(handle), on_close);
+  }
+
+  static void
+  on_close(uv_handle_t *handle) {
+    static_cast<timer_awaiter *>(handle->data)->release();
+  }
+
+  static void
+  cancel(loop_awaiter *awaiter) {
+    timer_awaiter *timer = static_cast<timer_awaiter *>(awaiter);
+
+    if (uv_is_closing(reinterpret_cast<uv_handle_t *>(&timer->timer_))) return;
+
+    timer->status_ = UV_ECANCELED;
+
+    uv_close(reinterpret_cast<uv_handle_t *>(&timer->timer_), on_close);
+  }
+
+  uint64_t timeout_;
+  uv_timer_t timer_;
+};
+
+class promise_awaiter {
+public:
+  promise_awaiter(js_env_t *env, js_value_t *promise) : env_(env), promise_(promise) {}
+
+  promise_awaiter(const promise_awaiter &) = delete;
+
+  promise_awaiter &
+  operator=(const promise_awaiter &) = delete;
+
+  bool
+  await_ready() noexcept {
+    bool is_promise;
+    err_ = js_is_promise(env_, promise_, &is_promise);
+    if (err_ < 0) return true;
+
+    // Like in JavaScript, awaiting anything but a promise resumes right away
+    // with the value itself.
+    if (is_promise) return false;
+
+    value_ = promise_;
+
+    return true;
+  }
+
+  bool
+  await_suspend(std::coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+
+    js_value_t *then;
+    err_ = js_get_named_property(env_, promise_, "then", &then);
+    if (err_ < 0) return false;
+
+    js_value_t *argv[2];
+
+    err_ = js_create_function(env_, "onfulfilled", -1, on_fulfilled, this, &argv[0]);
+    if (err_ < 0) return false;
+
+    err_ = js_create_function(env_, "onrejected", -1, on_rejected, this, &argv[1]);
+    if (err_ < 0) return false;
+
+    err_ = js_call_function(env_, promise_, then, 2, argv, NULL);
+    if (err_ < 0) return false;
+
+    return true;
+  }
+
+  js_value_t *
+  await_resume() noexcept {
+    if (err_ < 0) return NULL;
+
+    if (rejected_) {
+      js_throw(env_, value_);
+
+      return NULL;
+    }
+
+    return value_;
+  }
+
+private:
+  static js_value_t *
+  on_fulfilled(js_env_t *env, js_callback_info_t *info) {
+    return on_settled(env, info, false);
+  }
+
+  static js_value_t *
+  on_rejected(js_env_t *env, js_callback_info_t *info) {
+    return on_settled(env, info, true);
+  }
+
+  static js_value_t *
+  on_settled(js_env_t *env, js_callback_info_t *info, bool rejected) {
+    size_t argc = 1;
+    js_value_t *argv[1];
+    void *data;
+
+    if (js_get_callback_info(env, info, &argc, argv, NULL, &data) != 0) return NULL;
+
+    promise_awaiter *awaiter = static_cast<promise_awaiter *>(data);
+
+    awaiter->value_ = argv[0];
+    awaiter->rejected_ = rejected;
+
+    // The reaction already runs in a handle scope and at a microtask
+    // checkpoint, so the coroutine is resumed right here.
+    awaiter->handle_.resume();
+
+    return NULL;
+  }
+
+  js_env_t *env_;
+  js_value_t *promise_;
+  js_value_t *value_ = NULL;
+  bool rejected_ = false;
+  int err_ = 0;
+  std::coroutine_handle<> handle_;
+};
+
+} // namespace detail
+
+template <typename T>
+class task {
+public:
+  using promise_type = detail::task_promise<T>;
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  task(const task &) = delete;
+
+  task &
+  operator=(const task &) = delete;
+
+  ~task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool
+  await_ready() noexcept {
+    return handle_.done();
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> continuation) noexcept {
+    handle_.promise().continuation = continuation;
+  }
+
+  T
+  await_resume() {
+    return handle_.promise().take();
+  }
+
+private:
+  friend promise_type;
+
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+/**
+ * A coroutine that owns itself, destroying its frame when it finishes.
+ */
+struct detached {
+  struct promise_type {
+    detached
+    get_return_object() noexcept {
+      return {};
+    }
+
+    std::suspend_never
+    initial_suspend() noexcept {
+      return {};
+    }
+
+    std::suspend_never
+    final_suspend() noexcept {
+      return {};
+    }
+
+    void
+    return_void() noexcept {}
+
+    void
+    unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+inline detached
+settle(js_env_t *env, js_deferred_t *deferred, task<js_value_t *> coroutine) {
+  js_value_t *value = co_await coroutine;
+
+  if (deferred == NULL) {
+    if (value == NULL) js_get_and_clear_last_exception(env, &value);
+  } else if (value) {
+    js_resolve_deferred(env, deferred, value);
+  } else {
+    js_get_and_clear_last_exception(env, &value);
+
+    js_reject_deferred(env, deferred, value);
+  }
+}
+
+} // namespace detail
+
+/**
+ * Run `fn` on the threadpool, resuming once it has returned. Resolves to 0, or
+ * to `js_pending_exception` if the work couldn't be queued or was cancelled by
+ * the environment being torn down.
+ */
+template <typename F>
+inline detail::work_awaiter<F>
+queue_work(js_env_t *env, F &&fn) {
+  return detail::work_awaiter<F>(env, std::forward<F>(fn));
+}
+
+/**
+ * Resume after `timeout` milliseconds. Resolves to 0, or to
+ * `js_pending_exception` if the timer couldn't be started or was cancelled by
+ * the environment being torn down.
+ */
+inline detail::timer_awaiter
+sleep(js_env_t *env, uint64_t timeout) {
+  return detail::timer_awaiter(env, timeout);
+}
+
+/**
+ * Resume once `promise` has settled. Resolves to the fulfillment value, or to
+ * `NULL` with the rejection reason pending as an exception. Values other than
+ * promises are resolved to right away.
+ */
+inline detail::promise_awaiter
+await(js_env_t *env, js_value_t *promise) {
+  return detail::promise_awaiter(env, promise);
+}
+
+/**
+ * Create a promise settled with the outcome of `coroutine`, which keeps running
+ * on its own. A task must always be either awaited or spawned, as destroying it
+ * while suspended would leave the awaited operation with a dangling frame.
+ */
+inline int
+spawn(js_env_t *env, task<js_value_t *> &&coroutine, js_value_t **result) {
+  int err;
+
+  // A task that failed before its first suspension has left its exception
+  // pending, which must be set aside while the promise is created.
+  bool pending;
+  err = js_is_exception_pending(env, &pending);
+  if (err < 0) pending = false;
+
+  js_value_t *exception = NULL;
+
+  if (pending) js_get_and_clear_last_exception(env, &exception);
+
+  js_deferred_t *deferred;
+  err = js_create_promise(env, &deferred, result);
+
+  if (err == 0) {
+    if (exception) js_throw(env, exception);
+
+    detail::settle(env, deferred, std::move(coroutine));
+
+    return 0;
+  }
+
+  // Let the task run to completion even if its outcome can't be reported, but
+  // leave its exception pending in place of the one from creating the promise.
+  detail::settle(env, NULL, std::move(coroutine));
+
+  if (exception) {
+    js_value_t *ignored;
+    js_get_and_clear_last_exception(env, &ignored);
+
+    js_throw(env, exception);
+  }
+
+  return err;
+}
+
+/**
+ * A `js_function_cb` returning a promise for the task returned by `fn`, which
+ * is rejected if the task fails before its first suspension. The callback info
+ * is only valid until the task first suspends.
+ */
+template <task<js_value_t *> (*fn)(js_env_t *, js_callback_info_t *)>
+inline js_value_t *
+async_function(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  js_deferred_t *deferred;
+  int err = js_create_promise(env, &deferred, &result);
+  if (err < 0) return NULL;
+
+  detail::settle(env, deferred, fn(env, info));
+
+  return result;
+}
+
+} // namespace js
+
+#endif // JS_COROUTINE_H
@@ -0,0 +1,311 @@
+#ifndef JS_FUNCTION_H
+#define JS_FUNCTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <js.h>
+
+/**
+ * Bindings for plain C++ functions, with the marshalling of arguments and
+ * results derived from the signature of the function at compile time:
+ *
+ *     static int32_t
+ *     add(int32_t a, int32_t b) {
+ *       return a + b;
+ *     }
+ *
+ *     js::create_function<add>(env, "add", &fn);
+ *
+ * A function may take a `js_env_t *` as its first parameter, which isn't
+ * exposed to JavaScript, to create values or throw. Parameters and results may
+ * be `bool`, integers, floating point numbers, and `js_value_t *` for values of
+ * any type. Results may also be `void`.
+ *
+ * The binding generates both an untyped `js_function_cb` and a typed callback
+ * for `js_create_typed_function()`, along with the `js_callback_signature_t`
+ * describing it. Arguments that fail to convert throw a `TypeError` from the
+ * untyped callback, which the typed callback falls back to for those.
+ */
+
+namespace js {
+
+namespace detail {
+
+template <typename T, typename = void>
+struct marshall;
+
+template <>
+struct marshall<bool> {
+  static constexpr int type = js_boolean;
+
+  static constexpr const char *expected = "Expected a boolean";
+
+  static int
+  get(js_env_t *env, js_value_t *value, bool *result) {
+    return js_get_value_bool(env, value, result);
+  }
+
+  static int
+  create(js_env_t *env, bool value, js_value_t **result) {
+    return js_get_boolean(env, value, result);
+  }
+};
+
+template <typename T>
+struct marshall<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+  static constexpr int type = std::is_signed_v<T>
+                                ? (sizeof(T) == 1 ? js_int8 : sizeof(T) == 2 ? js_int16 : sizeof(T) == 4 ? js_int32 : js_int64)
+                                : (sizeof(T) == 1 ? js_uint8 : sizeof(T) == 2 ? js_uint16 : sizeof(T) == 4 ? js_uint32 : js_uint64);
+
+  static constexpr const char *expected = "Expected a number";
+
+  // Conversions match those of the typed function trampoline such that both
+  // callbacks agree on every value.
+
+  static int
+  get(js_env_t *env, js_value_t *value, T *result) {
+    int err;
+
+    if constexpr (sizeof(T) <= 4 && std::is_signed_v<T>) {
+      int32_t integer;
+      err = js_get_value_int32(env, value, &integer);
+      *result = (T) integer;
+    } else if constexpr (sizeof(T) <= 4) {
+      uint32_t integer;
+      err = js_get_value_uint32(env, value, &integer);
+      *result = (T) integer;
+    } else {
+      int64_t integer;
+      err = js_get_value_int64(env, value, &integer);
+      *result = (T) integer;
+    }
+
+    return err;
+  }
+
+  static int
+  create(js_env_t *env, T value, js_value_t **result) {
+    if constexpr (sizeof(T) <= 4 && std::is_signed_v<T>) {
+      return js_create_int32(env, (int32_t) value, result);
+    } else if constexpr (sizeof(T) <= 4) {
+      return js_create_uint32(env, (uint32_t) value, result);
+    } else if constexpr (std::is_signed_v<T>) {
+      return js_create_int64(env, (int64_t) value, result);
+    } else {
+      return js_create_double(env, (double) value, result);
+    }
+  }
+};
+
+template <typename T>
+struct marshall<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  // Only doubles are passed in the registers the typed function trampoline
+  // expects, so other floating point types always use the untyped callback.
+  static constexpr int type = std::is_same_v<T, double> ? js_float64 : js_float32;
+
+  static constexpr const char *expected = "Expected a number";
+
+  static int
+  get(js_env_t *env, js_value_t *value, T *result) {
+    double number;
+    int err = js_get_value_double(env, value, &number);
+    *result = (T) number;
+
+    return err;
+  }
+
+  static int
+  create(js_env_t *env, T value, js_value_t **result) {
+    return js_create_double(env, (double) value, result);
+  }
+};
+
+template <>
+struct marshall<js_value_t *> {
+  // Values are passed through as is. Typed functions can't return them, so
+  // functions returning values always use the untyped callback.
+  static constexpr int type = js_object;
+
+  static constexpr const char *expected = NULL;
+
+  static int
+  get(js_env_t *env, js_value_t *value, js_value_t **result) {
+    *result = value;
+
+    return 0;
+  }
+
+  static int
+  create(js_env_t *env, js_value_t *value, js_value_t **result) {
+    *result = value;
+
+    return 0;
+  }
+};
+
+template <typename R>
+struct result_type {
+  static constexpr int type = marshall<R>::type;
+};
+
+template <>
+struct result_type<void> {
+  static constexpr int type = js_undefined;
+};
+
+template <typename F>
+struct function_traits;
+
+template <typename R, typename... A>
+struct function_traits<R (*)(A...)> {
+  static constexpr bool takes_env = false;
+
+  template <auto fn, typename... T>
+  static R
+  call(js_env_t *env, T... args) {
+    return fn(args...);
+  }
+
+  template <template <typename...> typename V>
+  using args = V<A...>;
+
+  using result = R;
+};
+
+template <typename R, typename... A>
+struct function_traits<R (*)(js_env_t *, A...)> {
+  static constexpr bool takes_env = true;
+
+  template <auto fn, typename... T>
+  static R
+  call(js_env_t *env, T... args) {
+    return fn(env, args...);
+  }
+
+  template <template <typename...> typename V>
+  using args = V<A...>;
+
+  using result = R;
+};
+
+template <auto fn, typename R, typename... A>
+struct function_binding {
+  using traits = function_traits<decltype(fn)>;
+
+  static constexpr size_t args_len = sizeof...(A);
+
+  // The receiver comes first in a typed signature.
+  static inline int signature_args[] = {js_object, marshall<A>::type...};
+
+  static constexpr js_callback_signature_t signature = {
+    0,
+    result_type<R>::type,
+    args_len + 1,
+    signature_args,
+  };
+
+  template <size_t... I>
+  static js_value_t *
+  call(js_env_t *env, js_value_t *const argv[], std::index_sequence<I...>) {
+    int err;
+
+    std::tuple<A...> args;
+
+    if constexpr (args_len > 0) {
+      size_t failed = 0;
+
+      // Convert every argument, stopping at the first that fails.
+      bool converted = ((marshall<A>::get(env, argv[I], &std::get<I>(args)) == 0 || (failed = I, false)) && ...);
+
+      if (!converted) {
+        bool pending;
+        err = js_is_exception_pending(env, &pending);
+
+        if (err == 0 && !pending) {
+          const char *expected[] = {marshall<A>::expected...};
+
+          js_throw_type_errorf(env, NULL, "%s for argument %zu", expected[failed], failed);
+        }
+
+        return NULL;
+      }
+    }
+
+    if constexpr (std::is_void_v<R>) {
+      traits::template call<fn>(env, std::get<I>(args)...);
+
+      return NULL;
+    } else {
+      R value = traits::template call<fn>(env, std::get<I>(args)...);
+
+      // Only functions given the environment can have thrown.
+      if constexpr (traits::takes_env) {
+        bool pending;
+        err = js_is_exception_pending(env, &pending);
+        if (err < 0 || pending) return NULL;
+      }
+
+      js_value_t *result;
+      err = marshall<R>::create(env, value, &result);
+      if (err < 0) return NULL;
+
+      return result;
+    }
+  }
+
+  static js_value_t *
+  callback(js_env_t *env, js_callback_info_t *info) {
+    size_t argc = args_len;
+    js_value_t *argv[args_len > 0 ? args_len : 1];
+
+    int err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+    if (err < 0) return NULL;
+
+    return call(env, argv, std::index_sequence_for<A...>());
+  }
+
+  static R
+  typed_callback(js_value_t *receiver, A... args, js_typed_callback_info_t *info) {
+    js_env_t *env = NULL;
+
+    if constexpr (traits::takes_env) js_get_typed_callback_info(info, &env, NULL);
+
+    return traits::template call<fn>(env, args...);
+  }
+};
+
+template <auto fn>
+struct binding_of {
+  template <typename... A>
+  using with_args = function_binding<fn, typename function_traits<decltype(fn)>::result, A...>;
+
+  using type = typename function_traits<decltype(fn)>::template args<with_args>;
+};
+
+} // namespace detail
+
+/**
+ * The binding of `fn`, exposing its untyped `callback`, its `typed_callback`,
+ * and the `signature` of the latter.
+ */
+template <auto fn>
+using function_binding = typename detail::binding_of<fn>::type;
+
+/**
+ * Create a function calling `fn`, using the typed callback where supported.
+ */
+template <auto fn>
+inline int
+create_function(js_env_t *env, const char *name, js_value_t **result) {
+  using binding = function_binding<fn>;
+
+  return js_create_typed_function(env, name, -1, binding::callback, &binding::signature, reinterpret_cast<const void *>(&binding::typed_callback), NULL, result);
+}
+
+} // namespace js
+
+#endif // JS_FUNCTION_H
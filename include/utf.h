@@ -5,7 +5,32 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#ifndef UTF_NO_SIMD
+#if defined(__AVX2__)
+#define UTF_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF_SSE2
+#endif
+#if (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#define UTF_NEON
+#endif
+#endif
+
+#if defined(UTF_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(UTF_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(UTF_NEON)
+#include <arm_neon.h>
+#endif
 
 #ifndef __cplusplus
 typedef uint16_t char16_t;
@@ -15,6 +40,534 @@ typedef unsigned char utf8_t;
 typedef char16_t utf16_t;
 typedef unsigned char latin1_t;
 
+/**
+ * Return the length of the longest prefix of `data` that is made up of whole
+ * blocks of ASCII characters. The remainder, if any, starts with a block that
+ * is either shorter than a full block or contains a non-ASCII character.
+ */
+static inline size_t
+utf__ascii_prefix(const utf8_t *data, size_t len) {
+  size_t i = 0;
+
+#if defined(UTF_AVX2)
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &data[i]);
+
+    if (_mm256_movemask_epi8(v)) return i;
+  }
+#endif
+
+#if defined(UTF_SSE2)
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+    if (_mm_movemask_epi8(v)) return i;
+  }
+#elif defined(UTF_NEON)
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8(&data[i]);
+
+    if (vmaxvq_u8(v) >= 0x80) return i;
+  }
+#endif
+
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, &data[i], sizeof(uint64_t));
+
+    if (word & 0x8080808080808080ull) return i;
+  }
+
+  return i;
+}
+
+/**
+ * Check if `data` only contains ASCII characters, in which case it is also
+ * valid Latin-1.
+ */
+static inline bool
+utf8_is_ascii(const utf8_t *data, size_t len) {
+  for (size_t i = utf__ascii_prefix(data, len); i < len; i++) {
+    if (data[i] >= 0x80) return false;
+  }
+
+  return true;
+}
+
+/**
+ * Check if `data` is well-formed UTF-8, rejecting overlong encodings,
+ * surrogates, and code points above U+10FFFF.
+ */
+static inline bool
+utf8_validate(const utf8_t *data, size_t len) {
+  size_t i = 0;
+
+  while (i < len) {
+    i += utf__ascii_prefix(&data[i], len - i);
+
+    for (size_t end = i + 16; i < len && i < end;) {
+      utf8_t c = data[i];
+
+      if (c < 0x80) {
+        i += 1;
+      } else if (c < 0xc2) {
+        return false;
+      } else if (c < 0xe0) {
+        if (i + 1 >= len || (data[i + 1] & 0xc0) != 0x80) return false;
+
+        i += 2;
+      } else if (c < 0xf0) {
+        if (i + 2 >= len) return false;
+
+        utf8_t c1 = data[i + 1], c2 = data[i + 2];
+
+        if ((c1 & 0xc0) != 0x80 || (c2 & 0xc0) != 0x80) return false;
+        if (c == 0xe0 && c1 < 0xa0) return false;
+        if (c == 0xed && c1 > 0x9f) return false;
+
+        i += 3;
+      } else if (c < 0xf5) {
+        if (i + 3 >= len) return false;
+
+        utf8_t c1 = data[i + 1], c2 = data[i + 2], c3 = data[i + 3];
+
+        if ((c1 & 0xc0) != 0x80 || (c2 & 0xc0) != 0x80 || (c3 & 0xc0) != 0x80) return false;
+        if (c == 0xf0 && c1 < 0x90) return false;
+        if (c == 0xf4 && c1 > 0x8f) return false;
+
+        i += 4;
+      } else {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Check if every code unit of `data` fits in a single byte, in which case the
+ * string can be represented as Latin-1.
+ */
+static inline bool
+utf16le_is_latin1(const utf16_t *data, size_t len) {
+  size_t i = 0;
+
+#if defined(UTF_AVX2)
+  for (; i + 16 <= len; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &data[i]);
+
+    if (!_mm256_testz_si256(v, _mm256_set1_epi16((short) 0xff00))) return false;
+  }
+#endif
+
+#if defined(UTF_SSE2)
+  for (; i + 8 <= len; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+    v = _mm_and_si128(v, _mm_set1_epi16((short) 0xff00));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff) return false;
+  }
+#elif defined(UTF_NEON)
+  for (; i + 8 <= len; i += 8) {
+    uint16x8_t v = vld1q_u16((const uint16_t *) &data[i]);
+
+    if (vmaxvq_u16(v) > 0xff) return false;
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (data[i] > 0xff) return false;
+  }
+
+  return true;
+}
+
+/**
+ * Return the number of UTF-16 code units needed to represent the UTF-8 string
+ * `data`, which must be valid.
+ */
+static inline size_t
+utf16le_length_from_utf8(const utf8_t *data, size_t len) {
+  size_t i = 0, result = 0;
+
+  // Every byte that is not a continuation byte starts a code point, and every
+  // 4 byte sequence needs a surrogate pair. The counts are accumulated per lane
+  // and flushed before the 8 bit lanes can overflow.
+
+#if defined(UTF_AVX2)
+  while (i + 32 <= len) {
+    __m256i count = _mm256_setzero_si256();
+
+    for (size_t n = 0; n < 127 && i + 32 <= len; n++, i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *) &data[i]);
+
+      count = _mm256_sub_epi8(count, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65)));
+      count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8((char) 0xf0)), v));
+    }
+
+    __m256i sum = _mm256_sad_epu8(count, _mm256_setzero_si256());
+
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+    result += (size_t) _mm_cvtsi128_si32(half) + (size_t) _mm_cvtsi128_si32(_mm_srli_si128(half, 8));
+  }
+#endif
+
+#if defined(UTF_SSE2)
+  while (i + 16 <= len) {
+    __m128i count = _mm_setzero_si128();
+
+    for (size_t n = 0; n < 127 && i + 16 <= len; n++, i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+      count = _mm_sub_epi8(count, _mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+      count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8((char) 0xf0)), v));
+    }
+
+    __m128i sum = _mm_sad_epu8(count, _mm_setzero_si128());
+
+    result += (size_t) _mm_cvtsi128_si32(sum) + (size_t) _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+  }
+#elif defined(UTF_NEON)
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8(&data[i]);
+
+    uint8x16_t leading = vandq_u8(vcgtq_s8(vreinterpretq_s8_u8(v), vdupq_n_s8(-65)), vdupq_n_u8(1));
+    uint8x16_t surrogates = vandq_u8(vcgeq_u8(v, vdupq_n_u8(0xf0)), vdupq_n_u8(1));
+
+    result += vaddvq_u8(vaddq_u8(leading, surrogates));
+  }
+#endif
+
+  for (; i < len; i++) {
+    utf8_t c = data[i];
+
+    result += (c & 0xc0) != 0x80;
+    result += c >= 0xf0;
+  }
+
+  return result;
+}
+
+static inline size_t
+utf__length_from_utf16le(const utf16_t *data, size_t len, size_t *i) {
+  utf16_t c = data[*i];
+
+  if (c < 0x80) return *i += 1, 1;
+  if (c < 0x800) return *i += 1, 2;
+
+  if ((c & 0xfc00) == 0xd800 && *i + 1 < len && (data[*i + 1] & 0xfc00) == 0xdc00) {
+    return *i += 2, 4;
+  }
+
+  return *i += 1, 3;
+}
+
+/**
+ * Return the number of bytes needed to represent the UTF-16 string `data` as
+ * UTF-8. Unpaired surrogates are counted as U+FFFD REPLACEMENT CHARACTER.
+ */
+static inline size_t
+utf8_length_from_utf16le(const utf16_t *data, size_t len) {
+  size_t i = 0, result = 0;
+
+  while (i < len) {
+#if defined(UTF_SSE2)
+    // Each code unit outside the surrogate range needs 3 bytes, less one if it
+    // is below U+0800 and another if it is ASCII. Blocks containing surrogates
+    // are left to the scalar loop.
+    while (i + 8 <= len) {
+      __m128i count = _mm_setzero_si128();
+
+      size_t n = 0;
+
+      for (; n < 8192 && i + 8 <= len; n++, i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+        __m128i upper = _mm_and_si128(v, _mm_set1_epi16((short) 0xf800));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(upper, _mm_set1_epi16((short) 0xd800)))) break;
+
+        count = _mm_sub_epi16(count, _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short) 0xff80)), _mm_setzero_si128()));
+        count = _mm_sub_epi16(count, _mm_cmpeq_epi16(upper, _mm_setzero_si128()));
+      }
+
+      __m128i sum = _mm_madd_epi16(count, _mm_set1_epi16(1));
+
+      sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+      sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+
+      result += n * 8 * 3 - (size_t) _mm_cvtsi128_si32(sum);
+
+      if (n < 8192) break;
+    }
+#elif defined(UTF_NEON)
+    for (; i + 8 <= len; i += 8) {
+      uint16x8_t v = vld1q_u16((const uint16_t *) &data[i]);
+
+      uint16x8_t upper = vandq_u16(v, vdupq_n_u16(0xf800));
+
+      if (vmaxvq_u16(vceqq_u16(upper, vdupq_n_u16(0xd800)))) break;
+
+      uint16x8_t wide = vandq_u16(vcgeq_u16(v, vdupq_n_u16(0x80)), vdupq_n_u16(1));
+      uint16x8_t wider = vandq_u16(vcgeq_u16(v, vdupq_n_u16(0x800)), vdupq_n_u16(1));
+
+      result += 8 + vaddvq_u16(vaddq_u16(wide, wider));
+    }
+#endif
+
+    for (size_t end = i + 8; i < len && i < end;) {
+      result += utf__length_from_utf16le(data, len, &i);
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Transcode the UTF-8 string `data`, which must be valid, to UTF-16 and return
+ * the number of code units written. `result` must have room for at least
+ * `utf16le_length_from_utf8(data, len)` code units.
+ */
+static inline size_t
+utf8_convert_to_utf16le(const utf8_t *data, size_t len, utf16_t *result) {
+  size_t i = 0, j = 0;
+
+  while (i < len) {
+#if defined(UTF_SSE2)
+    for (; i + 16 <= len; i += 16, j += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+      if (_mm_movemask_epi8(v)) break;
+
+      _mm_storeu_si128((__m128i *) &result[j], _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+      _mm_storeu_si128((__m128i *) &result[j + 8], _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+    }
+#elif defined(UTF_NEON)
+    for (; i + 16 <= len; i += 16, j += 16) {
+      uint8x16_t v = vld1q_u8(&data[i]);
+
+      if (vmaxvq_u8(v) >= 0x80) break;
+
+      vst1q_u16((uint16_t *) &result[j], vmovl_u8(vget_low_u8(v)));
+      vst1q_u16((uint16_t *) &result[j + 8], vmovl_u8(vget_high_u8(v)));
+    }
+#endif
+
+    for (size_t end = i + 16; i < len && i < end;) {
+      utf8_t c = data[i];
+
+      if (c < 0x80) {
+        result[j++] = c;
+
+        i += 1;
+      } else if (c < 0xc0) {
+        i += 1;
+      } else if (c < 0xe0) {
+        if (i + 1 >= len) return j;
+
+        result[j++] = (utf16_t) (((c & 0x1f) << 6) | (data[i + 1] & 0x3f));
+
+        i += 2;
+      } else if (c < 0xf0) {
+        if (i + 2 >= len) return j;
+
+        result[j++] = (utf16_t) (((c & 0x0f) << 12) | ((data[i + 1] & 0x3f) << 6) | (data[i + 2] & 0x3f));
+
+        i += 3;
+      } else {
+        if (i + 3 >= len) return j;
+
+        uint32_t code = ((c & 0x07) << 18) | ((data[i + 1] & 0x3f) << 12) | ((data[i + 2] & 0x3f) << 6) | (data[i + 3] & 0x3f);
+
+        code -= 0x10000;
+
+        result[j++] = (utf16_t) (0xd800 | (code >> 10));
+        result[j++] = (utf16_t) (0xdc00 | (code & 0x3ff));
+
+        i += 4;
+      }
+    }
+  }
+
+  return j;
+}
+
+/**
+ * Transcode the UTF-16 string `data` to UTF-8 and return the number of bytes
+ * written. Unpaired surrogates are replaced by U+FFFD REPLACEMENT CHARACTER.
+ * `result` must have room for at least `utf8_length_from_utf16le(data, len)`
+ * bytes.
+ */
+static inline size_t
+utf16le_convert_to_utf8(const utf16_t *data, size_t len, utf8_t *result) {
+  size_t i = 0, j = 0;
+
+  while (i < len) {
+#if defined(UTF_SSE2)
+    for (; i + 8 <= len; i += 8, j += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *) &data[i]);
+
+      __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short) 0xff80)), _mm_setzero_si128());
+
+      if (_mm_movemask_epi8(ascii) != 0xffff) break;
+
+      _mm_storel_epi64((__m128i *) &result[j], _mm_packus_epi16(v, v));
+    }
+#elif defined(UTF_NEON)
+    for (; i + 8 <= len; i += 8, j += 8) {
+      uint16x8_t v = vld1q_u16((const uint16_t *) &data[i]);
+
+      if (vmaxvq_u16(v) >= 0x80) break;
+
+      vst1_u8(&result[j], vmovn_u16(v));
+    }
+#endif
+
+    for (size_t end = i + 8; i < len && i < end;) {
+      uint32_t c = data[i++];
+
+      if (c < 0x80) {
+        result[j++] = (utf8_t) c;
+      } else if (c < 0x800) {
+        result[j++] = (utf8_t) (0xc0 | (c >> 6));
+        result[j++] = (utf8_t) (0x80 | (c & 0x3f));
+      } else {
+        if ((c & 0xf800) == 0xd800) {
+          if ((c & 0xfc00) == 0xd800 && i < len && (data[i] & 0xfc00) == 0xdc00) {
+            c = 0x10000 + ((c - 0xd800) << 10) + (data[i++] - 0xdc00);
+
+            result[j++] = (utf8_t) (0xf0 | (c >> 18));
+            result[j++] = (utf8_t) (0x80 | ((c >> 12) & 0x3f));
+            result[j++] = (utf8_t) (0x80 | ((c >> 6) & 0x3f));
+            result[j++] = (utf8_t) (0x80 | (c & 0x3f));
+
+            continue;
+          }
+
+          c = 0xfffd;
+        }
+
+        result[j++] = (utf8_t) (0xe0 | (c >> 12));
+        result[j++] = (utf8_t) (0x80 | ((c >> 6) & 0x3f));
+        result[j++] = (utf8_t) (0x80 | (c & 0x3f));
+      }
+    }
+  }
+
+  return j;
+}
+
+/**
+ * Narrow the UTF-16 string `data`, which must satisfy `utf16le_is_latin1()`,
+ * to Latin-1 and return the number of bytes written. `result` may alias
+ * `data`, in which case the string is narrowed in place.
+ */
+static inline size_t
+utf16le_convert_to_latin1(const utf16_t *data, size_t len, latin1_t *result) {
+  size_t i = 0;
+
+#if defined(UTF_SSE2)
+  for (; i + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *) &data[i]);
+    __m128i b = _mm_loadu_si128((const __m128i *) &data[i + 8]);
+
+    _mm_storeu_si128((__m128i *) &result[i], _mm_packus_epi16(a, b));
+  }
+#elif defined(UTF_NEON)
+  for (; i + 16 <= len; i += 16) {
+    uint16x8_t a = vld1q_u16((const uint16_t *) &data[i]);
+    uint16x8_t b = vld1q_u16((const uint16_t *) &data[i + 8]);
+
+    vst1q_u8(&result[i], vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+  }
+#endif
+
+  for (; i < len; i++) {
+    result[i] = (latin1_t) data[i];
+  }
+
+  return len;
+}
+
+/**
+ * Narrow the longest prefix of the UTF-16 string `data` that is representable
+ * in Latin-1 and return its length, which equals `len` if the entire string is
+ * representable. `result` may alias `data`, in which case the prefix is
+ * narrowed in place and can be restored with `latin1_convert_to_utf16le()`.
+ */
+static inline size_t
+utf16le_convert_to_latin1_prefix(const utf16_t *data, size_t len, latin1_t *result) {
+  size_t i = 0;
+
+#if defined(UTF_SSE2)
+  for (; i + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *) &data[i]);
+    __m128i b = _mm_loadu_si128((const __m128i *) &data[i + 8]);
+
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16((short) 0xff00));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xffff) break;
+
+    _mm_storeu_si128((__m128i *) &result[i], _mm_packus_epi16(a, b));
+  }
+#elif defined(UTF_NEON)
+  for (; i + 16 <= len; i += 16) {
+    uint16x8_t a = vld1q_u16((const uint16_t *) &data[i]);
+    uint16x8_t b = vld1q_u16((const uint16_t *) &data[i + 8]);
+
+    if (vmaxvq_u16(vmaxq_u16(a, b)) > 0xff) break;
+
+    vst1q_u8(&result[i], vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+  }
+#endif
+
+  for (; i < len && data[i] <= 0xff; i++) {
+    result[i] = (latin1_t) data[i];
+  }
+
+  return i;
+}
+
+/**
+ * Widen the Latin-1 string `data` to UTF-16 and return the number of code
+ * units written. `result` may alias `data`, in which case the string is
+ * widened in place.
+ */
+static inline size_t
+latin1_convert_to_utf16le(const latin1_t *data, size_t len, utf16_t *result) {
+  size_t i = len;
+
+  // Work backwards such that, when widening in place, no byte is overwritten
+  // before it has been read.
+
+#if defined(UTF_SSE2)
+  for (; i >= 16; i -= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &data[i - 16]);
+
+    _mm_storeu_si128((__m128i *) &result[i - 8], _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+    _mm_storeu_si128((__m128i *) &result[i - 16], _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+  }
+#elif defined(UTF_NEON)
+  for (; i >= 16; i -= 16) {
+    uint8x16_t v = vld1q_u8(&data[i - 16]);
+
+    vst1q_u16((uint16_t *) &result[i - 8], vmovl_high_u8(v));
+    vst1q_u16((uint16_t *) &result[i - 16], vmovl_u8(vget_low_u8(v)));
+  }
+#endif
+
+  while (i > 0) {
+    i--;
+
+    result[i] = data[i];
+  }
+
+  return len;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,128 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <js/coroutine.h>
+#include <stdint.h>
+
+static js::task<int64_t>
+addon_sum(js_env_t *env, uint32_t n) {
+  int64_t sum = 0;
+
+  int err = co_await js::queue_work(env, [&] {
+    for (uint32_t i = 0; i < n; i++) sum += i;
+  });
+  assert(err == 0);
+
+  err = co_await js::sleep(env, 1);
+  assert(err == 0);
+
+  co_return sum;
+}
+
+static js::task<js_value_t *>
+addon_run(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  uint32_t n;
+  err = js_get_value_uint32(env, argv[0], &n);
+  assert(err == 0);
+
+  js_value_t *value = co_await js::await(env, argv[1]);
+  if (value == NULL) co_return NULL;
+
+  int64_t offset;
+  err = js_get_value_int64(env, value, &offset);
+  assert(err == 0);
+
+  int64_t sum = co_await addon_sum(env, n);
+
+  js_value_t *result;
+  err = js_create_int64(env, sum + offset, &result);
+  assert(err == 0);
+
+  co_return result;
+}
+
+static js::task<js_value_t *>
+addon_sleep(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  uint32_t timeout;
+  err = js_get_value_uint32(env, argv[0], &timeout);
+  assert(err == 0);
+
+  err = co_await js::sleep(env, timeout);
+  if (err < 0) co_return NULL;
+
+  js_value_t *result;
+  err = js_get_undefined(env, &result);
+  assert(err == 0);
+
+  co_return result;
+}
+
+static js::task<js_value_t *>
+addon_fail(js_env_t *env, js_callback_info_t *info) {
+  js_throw_error(env, NULL, "boom");
+
+  co_return NULL;
+}
+
+static js_value_t *
+addon_spawn_fail(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  int err = js::spawn(env, addon_fail(env, info), &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  js_value_t *fn;
+  err = js_create_function(env, "run", -1, js::async_function<addon_run>, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "run", fn);
+  assert(err == 0);
+
+  err = js_create_function(env, "sleep", -1, js::async_function<addon_sleep>, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "sleep", fn);
+  assert(err == 0);
+
+  err = js_create_function(env, "fail", -1, js::async_function<addon_fail>, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "fail", fn);
+  assert(err == 0);
+
+  err = js_create_function(env, "spawnFail", -1, addon_spawn_fail, NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "spawnFail", fn);
+  assert(err == 0);
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
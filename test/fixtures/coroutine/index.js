@@ -0,0 +1,57 @@
+const assert = require('assert')
+const asyncHooks = require('async_hooks')
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads')
+
+if (isMainThread) {
+  const [filename] = process.argv.slice(2)
+
+  const addon = require(filename)
+
+  async function main() {
+    // A task creates a single async context, however often it's resumed.
+    let contexts = 0
+
+    const hook = asyncHooks
+      .createHook({
+        init(id, type) {
+          if (type === 'js_coroutine') contexts++
+        }
+      })
+      .enable()
+
+    assert.strictEqual(await addon.run(1000, Promise.resolve(42)), 499500 + 42)
+
+    hook.disable()
+
+    assert.strictEqual(contexts, 1)
+
+    const error = new Error('rejected')
+
+    await assert.rejects(addon.run(1000, Promise.reject(error)), (err) => err === error)
+
+    // Tasks failing before their first suspension reject their promise.
+    await assert.rejects(addon.fail(), { message: 'boom' })
+    await assert.rejects(addon.spawnFail(), { message: 'boom' })
+
+    const results = await Promise.all(Array.from({ length: 100 }, (_, i) => addon.run(i, i)))
+
+    for (const [i, result] of results.entries()) assert.strictEqual(result, (i * (i - 1)) / 2 + i)
+
+    // Terminating a worker cancels the coroutines suspended in it.
+    const worker = new Worker(__filename, { workerData: { filename } })
+
+    await new Promise((resolve) => worker.on('message', resolve))
+
+    assert.strictEqual(await worker.terminate(), 1)
+
+    console.log('Settled %d coroutines', results.length + 4)
+  }
+
+  main()
+} else {
+  const addon = require(workerData.filename)
+
+  addon.sleep(60 * 1000)
+
+  parentPort.postMessage('sleeping')
+}
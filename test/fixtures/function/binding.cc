@@ -0,0 +1,139 @@
+// Call typed callbacks through the trampoline, and allow more arguments than
+// it has casts for, which must then use the untyped callback.
+#define JS_TYPED_FUNCTION_TRAMPOLINE
+#define JS_TYPED_FUNCTION_MAX_ARGS 8
+
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <js/function.h>
+#include <stdint.h>
+
+static int32_t
+addon_add(int32_t a, int32_t b) {
+  return a + b;
+}
+
+static double
+addon_scale(double value, uint8_t factor) {
+  return value * factor;
+}
+
+static bool
+addon_is_even(int64_t value) {
+  return value % 2 == 0;
+}
+
+static uint32_t addon_calls = 0;
+
+static void
+addon_count(void) {
+  addon_calls++;
+}
+
+static uint32_t
+addon_get_calls(void) {
+  return addon_calls;
+}
+
+static js_value_t *
+addon_identity(js_value_t *value) {
+  return value;
+}
+
+static int32_t
+addon_checked_divide(js_env_t *env, int32_t a, int32_t b) {
+  if (b == 0) {
+    js_throw_range_error(env, NULL, "Division by zero");
+
+    return 0;
+  }
+
+  return a / b;
+}
+
+// Typed functions that report which of their callbacks was called, 1 for the
+// typed callback and 0 for the untyped callback.
+
+static js_value_t *
+addon_untyped(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  int err = js_create_int32(env, 0, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static int32_t
+addon_typed_int32(js_value_t *receiver, int32_t value, js_typed_callback_info_t *info) {
+  return 1;
+}
+
+static int32_t
+addon_typed_string(js_value_t *receiver, js_value_t *value, js_typed_callback_info_t *info) {
+  return 1;
+}
+
+static int32_t
+addon_typed_many(js_value_t *receiver, int32_t a, int32_t b, int32_t c, int32_t d, js_typed_callback_info_t *info) {
+  return 1;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js::create_function<fn>(env, name, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("add", addon_add)
+  V("scale", addon_scale)
+  V("isEven", addon_is_even)
+  V("count", addon_count)
+  V("getCalls", addon_get_calls)
+  V("identity", addon_identity)
+  V("checkedDivide", addon_checked_divide)
+#undef V
+
+  // The binding can also be passed to js_create_typed_function() directly.
+  using binding = js::function_binding<addon_add>;
+
+  static_assert(binding::signature.result == js_int32);
+  static_assert(binding::signature.args_len == 3);
+
+  js_value_t *fn;
+  err = js_create_typed_function(env, "add", -1, binding::callback, &binding::signature, reinterpret_cast<const void *>(&binding::typed_callback), NULL, &fn);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "typedAdd", fn);
+  assert(err == 0);
+
+  static int int32_args[] = {js_object, js_int32};
+  static int string_args[] = {js_object, js_string};
+  static int many_args[] = {js_object, js_int32, js_int32, js_int32, js_int32};
+
+  static const js_callback_signature_t int32_signature = {0, js_int32, 2, int32_args};
+  static const js_callback_signature_t string_signature = {0, js_int32, 2, string_args};
+  static const js_callback_signature_t many_signature = {0, js_int32, 5, many_args};
+
+#define V(name, signature, typed) \
+  err = js_create_typed_function(env, name, -1, addon_untyped, &signature, reinterpret_cast<const void *>(&typed), NULL, &fn); \
+  assert(err == 0); \
+  err = js_set_named_property(env, exports, name, fn); \
+  assert(err == 0);
+
+  V("pathInt32", int32_signature, addon_typed_int32)
+  V("pathString", string_signature, addon_typed_string)
+  V("pathMany", many_signature, addon_typed_many)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
@@ -0,0 +1,44 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+// Call every function often enough for the typed callbacks to be used, where
+// supported.
+for (let i = 0; i < 10000; i++) {
+  assert.strictEqual(addon.add(i, 1), i + 1)
+  assert.strictEqual(addon.typedAdd(i, 2), i + 2)
+  assert.strictEqual(addon.scale(i + 0.5, 2), 2 * i + 1)
+  assert.strictEqual(addon.isEven(i), i % 2 === 0)
+  assert.strictEqual(addon.identity(i), i)
+  assert.strictEqual(addon.checkedDivide(i, 1), i)
+
+  addon.count()
+}
+
+assert.strictEqual(addon.getCalls(), 10000)
+
+const value = {}
+
+assert.strictEqual(addon.identity(value), value)
+
+assert.throws(() => addon.add('1', 2), { name: 'TypeError', message: 'Expected a number for argument 0' })
+assert.throws(() => addon.isEven(), { name: 'TypeError', message: 'Expected a number for argument 0' })
+assert.throws(() => addon.checkedDivide(1, 0), { name: 'RangeError', message: 'Division by zero' })
+
+// Arguments that can't be passed to the typed callback without truncating or
+// reinterpreting them use the untyped callback instead.
+for (let i = 0; i < 10000; i++) {
+  assert.strictEqual(addon.pathInt32(1.5), 0)
+  assert.strictEqual(addon.pathInt32(2 ** 32), 0)
+  assert.strictEqual(addon.pathInt32('1'), 0)
+  assert.strictEqual(addon.pathString(1), 0)
+  assert.strictEqual(addon.pathString({}), 0)
+  assert.strictEqual(addon.pathMany(1, 2, 3, 4), 0)
+}
+
+assert.ok([0, 1].includes(addon.pathInt32(1)))
+assert.ok([0, 1].includes(addon.pathString('1')))
+
+console.log('Called bound functions')
@@ -0,0 +1,83 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static js_value_t *
+addon_map(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  char path[4096];
+  err = js_get_value_string_utf8(env, argv[0], (utf8_t *) path, sizeof(path), NULL);
+  assert(err == 0);
+
+  uint32_t mode;
+  err = js_get_value_uint32(env, argv[1], &mode);
+  assert(err == 0);
+
+  js_value_t *result;
+  err = js_create_mapped_arraybuffer(env, path, (js_mapping_mode_t) mode, js_mapping_advice_sequential, NULL, NULL, &result);
+  if (err < 0) return NULL;
+
+  return result;
+}
+
+static js_value_t *
+addon_advise(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 4;
+  js_value_t *argv[4];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 4);
+
+  uint32_t offset, len, advice;
+
+  err = js_get_value_uint32(env, argv[1], &offset);
+  assert(err == 0);
+
+  err = js_get_value_uint32(env, argv[2], &len);
+  assert(err == 0);
+
+  err = js_get_value_uint32(env, argv[3], &advice);
+  assert(err == 0);
+
+  err = js_advise_mapped_arraybuffer(env, argv[0], offset, len, (js_mapping_advice_t) advice);
+  if (err < 0) return NULL;
+
+  return NULL;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("map", addon_map)
+  V("advise", addon_advise)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
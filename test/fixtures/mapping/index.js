@@ -0,0 +1,64 @@
+const assert = require('assert')
+const fs = require('fs')
+const os = require('os')
+const path = require('path')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+// Mirrors js_mapping_mode_t and js_mapping_advice_t.
+const mode = { readOnly: 0, copyOnWrite: 1 }
+const advice = { normal: 0, willNeed: 3, dontNeed: 4 }
+
+const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'mapping-'))
+
+try {
+  const file = path.join(dir, 'data')
+  const contents = Buffer.alloc(64 * 1024, 'abcdefgh')
+
+  fs.writeFileSync(file, contents)
+  fs.chmodSync(file, 0o444)
+
+  for (const m of [mode.readOnly, mode.copyOnWrite]) {
+    const buffer = addon.map(file, m)
+    const view = new Uint8Array(buffer)
+
+    assert.strictEqual(buffer.byteLength, contents.length)
+    assert.ok(Buffer.from(buffer).equals(contents))
+
+    // Writing to the mapping, even of a read-only file, only ever changes
+    // private copies of the pages written to.
+    view.fill(0x7a, 0, 4096)
+
+    assert.strictEqual(view[0], 0x7a)
+    assert.ok(fs.readFileSync(file).equals(contents))
+
+    addon.advise(buffer, 0, buffer.byteLength, advice.willNeed)
+
+    // Dropping the pages discards the writes, reading them from the file again.
+    if (process.platform === 'linux') {
+      addon.advise(buffer, 0, 4096, advice.dontNeed)
+
+      assert.ok(Buffer.from(buffer).equals(contents))
+    }
+
+    assert.throws(() => addon.advise(buffer, 1, buffer.byteLength, advice.normal), { name: 'RangeError', message: 'Range is out of bounds' })
+  }
+
+  // Memory that isn't a mapping must not have its pages dropped, which is
+  // refused for any memory without type tags.
+  assert.throws(() => addon.advise(new ArrayBuffer(16), 0, 16, advice.dontNeed), { message: /^(ArrayBuffer is not a mapped file|Dropping pages is not supported)$/ })
+
+  const empty = path.join(dir, 'empty')
+
+  fs.writeFileSync(empty, '')
+
+  assert.strictEqual(addon.map(empty, mode.readOnly).byteLength, 0)
+
+  assert.throws(() => addon.map(path.join(dir, 'missing'), mode.readOnly), { code: 'ENOENT' })
+
+  console.log('Mapped %d bytes of a read-only file', contents.length)
+} finally {
+  fs.rmSync(dir, { recursive: true, force: true })
+}
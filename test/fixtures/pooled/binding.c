@@ -0,0 +1,65 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdint.h>
+#include <string.h>
+
+static const size_t addon_element_size[] = {1, 1, 1, 2, 2, 4, 4, 4, 8, 8, 8};
+
+// Create a pooled typed array and fill its bytes from native code.
+static js_value_t *
+addon_create(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 3;
+  js_value_t *argv[3];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 3);
+
+  uint32_t type;
+  err = js_get_value_uint32(env, argv[0], &type);
+  assert(err == 0);
+
+  assert(type < sizeof(addon_element_size) / sizeof(addon_element_size[0]));
+
+  int64_t len;
+  err = js_get_value_int64(env, argv[1], &len);
+  assert(err == 0);
+
+  uint32_t fill;
+  err = js_get_value_uint32(env, argv[2], &fill);
+  assert(err == 0);
+
+  void *data;
+  js_value_t *result;
+  err = js_create_pooled_typedarray(env, (js_typedarray_type_t) type, (size_t) len, &data, &result);
+  if (err < 0) return NULL;
+
+  memset(data, (int) fill, (size_t) len * addon_element_size[type]);
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("create", addon_create)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
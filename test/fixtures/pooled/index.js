@@ -0,0 +1,61 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+const uint8 = 1
+const float64 = 8
+
+// Small typed arrays are carved from a shared pool, aligned for any element
+// type, and don't overlap.
+const a = addon.create(uint8, 3, 0xaa)
+const b = addon.create(float64, 2, 0xbb)
+const c = addon.create(uint8, 5, 0xcc)
+
+assert.strictEqual(a.buffer, b.buffer)
+assert.strictEqual(b.buffer, c.buffer)
+
+for (const array of [a, b, c]) assert.strictEqual(array.byteOffset % 8, 0)
+
+assert.deepStrictEqual([...a], [0xaa, 0xaa, 0xaa])
+assert.deepStrictEqual([...new Uint8Array(b.buffer, b.byteOffset, b.byteLength)], new Array(16).fill(0xbb))
+assert.deepStrictEqual([...c], [0xcc, 0xcc, 0xcc, 0xcc, 0xcc])
+
+// Releasing the pool by transferring one of its views detaches every other
+// view, after which a fresh pool is used rather than the detached memory.
+const pool = a.buffer
+
+structuredClone(pool, { transfer: [pool] })
+
+assert.strictEqual(pool.byteLength, 0)
+assert.strictEqual(c.length, 0)
+
+const d = addon.create(uint8, 4, 0xdd)
+
+assert.notStrictEqual(d.buffer, pool)
+assert.strictEqual(d.byteOffset, 0)
+assert.deepStrictEqual([...d], [0xdd, 0xdd, 0xdd, 0xdd])
+
+const e = addon.create(float64, 1, 0xee)
+
+assert.strictEqual(e.buffer, d.buffer)
+assert.strictEqual(e.byteOffset, 8)
+assert.deepStrictEqual([...d], [0xdd, 0xdd, 0xdd, 0xdd])
+
+// A new pool is also used once the current one is exhausted.
+const arrays = Array.from({ length: 4 }, () => addon.create(uint8, 4095, 0x11))
+
+assert.notStrictEqual(arrays[0].buffer, arrays[3].buffer)
+assert.ok(arrays.every((array) => array.every((byte) => byte === 0x11)))
+assert.deepStrictEqual([...d], [0xdd, 0xdd, 0xdd, 0xdd])
+
+// Larger typed arrays have an ArrayBuffer of their own.
+const f = addon.create(uint8, 4096, 0xff)
+
+assert.strictEqual(f.byteOffset, 0)
+assert.strictEqual(f.buffer.byteLength, 4096)
+
+assert.throws(() => addon.create(float64, 2 ** 61, 0), { name: 'RangeError', message: 'Invalid typed array length' })
+
+console.log('Created typed arrays from %d pools', new Set([a, d, ...arrays].map((array) => array.buffer)).size)
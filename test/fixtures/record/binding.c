@@ -0,0 +1,141 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Moved in bulk when there's more than one record, as every field is numeric.
+typedef struct {
+  uint32_t id;
+  int8_t delta;
+  bool active;
+  double score;
+} addon_point_t;
+
+static const js_schema_field_t addon_point_fields[] = {
+  JS_SCHEMA_FIELD(addon_point_t, id, js_uint32),
+  JS_SCHEMA_FIELD(addon_point_t, delta, js_int8),
+  JS_SCHEMA_FIELD(addon_point_t, active, js_boolean),
+  JS_SCHEMA_FIELD(addon_point_t, score, js_float64),
+};
+
+static const js_schema_t addon_point_schema = JS_SCHEMA(addon_point_t, addon_point_fields);
+
+// Always moved one record at a time.
+typedef struct {
+  uint32_t id;
+  char name[16];
+  int64_t serial;
+} addon_entry_t;
+
+static const js_schema_field_t addon_entry_fields[] = {
+  JS_SCHEMA_FIELD(addon_entry_t, id, js_uint32),
+  JS_SCHEMA_FIELD(addon_entry_t, name, js_string),
+  JS_SCHEMA_FIELD(addon_entry_t, serial, js_bigint64),
+};
+
+static const js_schema_t addon_entry_schema = JS_SCHEMA(addon_entry_t, addon_entry_fields);
+
+static js_value_t *
+addon_create_points(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  uint32_t len;
+  err = js_get_value_uint32(env, argv[0], &len);
+  assert(err == 0);
+
+  addon_point_t *points = (addon_point_t *) calloc(len ? len : 1, sizeof(addon_point_t));
+  assert(points);
+
+  for (uint32_t i = 0; i < len; i++) {
+    points[i].id = UINT32_MAX - i;
+    points[i].delta = (int8_t) (INT8_MIN + i);
+    points[i].active = i % 2 == 0;
+    points[i].score = i * 0.25;
+  }
+
+  js_value_t *result;
+  err = js_encode_records(env, &addon_point_schema, points, len, &result);
+
+  free(points);
+
+  if (err < 0) return NULL;
+
+  return result;
+}
+
+// Decode the first `len` elements of an array and encode them again.
+static js_value_t *
+addon_round_trip(js_env_t *env, js_callback_info_t *info, const js_schema_t *schema) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  uint32_t len;
+  err = js_get_value_uint32(env, argv[1], &len);
+  assert(err == 0);
+
+  void *records = calloc(len ? len : 1, schema->size);
+  assert(records);
+
+  js_value_t *result = NULL;
+
+  err = js_decode_records(env, schema, argv[0], records, len);
+
+  if (err == 0) {
+    err = js_encode_records(env, schema, records, len, &result);
+    if (err < 0) result = NULL;
+  }
+
+  free(records);
+
+  return result;
+}
+
+static js_value_t *
+addon_round_trip_points(js_env_t *env, js_callback_info_t *info) {
+  return addon_round_trip(env, info, &addon_point_schema);
+}
+
+static js_value_t *
+addon_round_trip_entries(js_env_t *env, js_callback_info_t *info) {
+  return addon_round_trip(env, info, &addon_entry_schema);
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("createPoints", addon_create_points)
+  V("roundTripPoints", addon_round_trip_points)
+  V("roundTripEntries", addon_round_trip_entries)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
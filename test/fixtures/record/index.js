@@ -0,0 +1,70 @@
+const assert = require('assert')
+const { execFileSync } = require('child_process')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+// A single record is always moved on its own, while more records of a numeric
+// schema are moved in bulk. Both must agree.
+
+const points = Array.from({ length: 10 }, (_, i) => ({ id: i, delta: i * 3 - 15, active: i % 2 === 0, score: i / 4 }))
+
+assert.deepStrictEqual(addon.roundTripPoints(points, 1), points.slice(0, 1))
+assert.deepStrictEqual(addon.roundTripPoints(points, points.length), points)
+
+// Integers wrap around like they do when converted by Node-API.
+const wrapped = { id: 2 ** 32 + 1, delta: 130, active: true, score: NaN }
+
+assert.deepStrictEqual(addon.roundTripPoints([wrapped], 1), [{ id: 1, delta: -126, active: true, score: NaN }])
+assert.deepStrictEqual(addon.roundTripPoints([wrapped, wrapped], 2)[0], addon.roundTripPoints([wrapped], 1)[0])
+
+assert.deepStrictEqual(addon.createPoints(0), [])
+assert.deepStrictEqual(addon.createPoints(1), addon.createPoints(4).slice(0, 1))
+assert.deepStrictEqual(addon.createPoints(2)[1], { id: 2 ** 32 - 2, delta: -127, active: false, score: 0.25 })
+
+for (const len of [1, 2]) {
+  const valid = points.slice(0, len)
+
+  assert.throws(() => addon.roundTripPoints(valid.slice(1), len), { name: 'TypeError', message: 'Expected an object' })
+  assert.throws(() => addon.roundTripPoints([...valid.slice(1), null], len), { name: 'TypeError', message: 'Expected an object' })
+  assert.throws(() => addon.roundTripPoints([...valid.slice(1), { ...points[0], score: '1' }], len), { name: 'TypeError', message: 'Expected a number' })
+  assert.throws(() => addon.roundTripPoints([...valid.slice(1), { ...points[0], active: 1 }], len), { name: 'TypeError', message: 'Expected a boolean' })
+
+  const error = new Error('getter')
+
+  assert.throws(
+    () =>
+      addon.roundTripPoints(
+        [
+          ...valid.slice(1),
+          {
+            get id() {
+              throw error
+            }
+          }
+        ],
+        len
+      ),
+    (err) => err === error
+  )
+}
+
+// Strings are truncated to fit their character array.
+const entries = [
+  { id: 1, name: 'hello', serial: -5n },
+  { id: 2, name: 'a'.repeat(20), serial: 2n ** 62n }
+]
+
+assert.deepStrictEqual(addon.roundTripEntries(entries, entries.length), [entries[0], { ...entries[1], name: 'a'.repeat(15) }])
+
+assert.throws(() => addon.roundTripEntries([entries[0], { ...entries[1], serial: 2 }], 2), { name: 'TypeError', message: 'Expected a bigint' })
+assert.throws(() => addon.roundTripEntries([entries[0]], 2), { name: 'TypeError', message: 'Expected an object' })
+
+// Without code generation from strings, records are always moved one at a
+// time.
+if (!process.execArgv.includes('--disallow-code-generation-from-strings')) {
+  execFileSync(process.execPath, ['--disallow-code-generation-from-strings', __filename, filename], { stdio: 'inherit' })
+
+  console.log('Moved records in bulk and one at a time')
+}
@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static js_value_t *
+addon_create(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  uint32_t len;
+  err = js_get_value_uint32(env, argv[0], &len);
+  assert(err == 0);
+
+  uint8_t *data;
+  js_value_t *result;
+  err = js_create_sharedarraybuffer(env, len, (void **) &data, &result);
+  if (err < 0) return NULL;
+
+  for (uint32_t i = 0; i < len; i++) data[i] = (uint8_t) i;
+
+  return result;
+}
+
+static js_value_t *
+addon_fill(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  uint32_t value;
+  err = js_get_value_uint32(env, argv[1], &value);
+  assert(err == 0);
+
+  void *data;
+  size_t len;
+  err = js_get_sharedarraybuffer_info(env, argv[0], &data, &len);
+  if (err < 0) return NULL;
+
+  memset(data, (int) value, len);
+
+  js_value_t *result;
+  err = js_create_uint32(env, (uint32_t) len, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_is_shared(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  bool is_sharedarraybuffer;
+  err = js_is_sharedarraybuffer(env, argv[0], &is_sharedarraybuffer);
+  assert(err == 0);
+
+  js_value_t *result;
+  err = js_get_boolean(env, is_sharedarraybuffer, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static void
+addon_external_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  free(data);
+}
+
+static js_value_t *
+addon_create_external(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  void *data = malloc(64);
+  assert(data);
+
+  js_value_t *result;
+  err = js_create_external_sharedarraybuffer(env, data, 64, addon_external_finalize, NULL, &result);
+
+  if (err < 0) {
+    // The memory was never handed over, so it's still ours to release.
+    free(data);
+
+    return NULL;
+  }
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("create", addon_create)
+  V("fill", addon_fill)
+  V("isShared", addon_is_shared)
+  V("createExternal", addon_create_external)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
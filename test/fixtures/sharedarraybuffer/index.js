@@ -0,0 +1,26 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+const buffer = addon.create(16)
+
+assert.ok(buffer instanceof SharedArrayBuffer)
+assert.ok(addon.isShared(buffer))
+assert.ok(!addon.isShared(new ArrayBuffer(16)))
+
+const view = new Uint8Array(buffer)
+
+assert.deepStrictEqual([...view], Array.from({ length: 16 }, (_, i) => i))
+
+// The memory is shared between native code and every view of the buffer.
+assert.strictEqual(addon.fill(buffer, 7), 16)
+assert.ok(view.every((value) => value === 7))
+
+assert.throws(() => addon.fill(new ArrayBuffer(16), 7), { name: 'TypeError', message: 'Expected a SharedArrayBuffer' })
+
+// Node-API can't back a SharedArrayBuffer with memory allocated elsewhere.
+assert.throws(() => addon.createExternal(), { message: 'External SharedArrayBuffers are not supported' })
+
+console.log('Shared %d bytes with native code', buffer.byteLength)
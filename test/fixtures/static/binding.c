@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static int32_t addon_step = 2;
+
+static void
+addon_counter_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  free(data);
+}
+
+static js_value_t *
+addon_counter_constructor(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+  js_value_t *receiver;
+
+  err = js_get_callback_info(env, info, &argc, argv, &receiver, NULL);
+  assert(err == 0);
+
+  int32_t *count = (int32_t *) malloc(sizeof(int32_t));
+  assert(count);
+
+  *count = 0;
+
+  if (argc > 0) {
+    err = js_get_value_int32(env, argv[0], count);
+    assert(err == 0);
+  }
+
+  err = js_wrap(env, receiver, count, addon_counter_finalize, NULL, NULL);
+  assert(err == 0);
+
+  return receiver;
+}
+
+static js_value_t *
+addon_counter_increment(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  js_value_t *receiver;
+  void *data;
+
+  err = js_get_callback_info(env, info, NULL, NULL, &receiver, &data);
+  assert(err == 0);
+
+  int32_t *count;
+  err = js_unwrap(env, receiver, (void **) &count);
+  if (err < 0) return NULL;
+
+  *count += *(int32_t *) data;
+
+  return NULL;
+}
+
+static js_value_t *
+addon_counter_get_value(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  js_value_t *receiver;
+
+  err = js_get_callback_info(env, info, NULL, NULL, &receiver, NULL);
+  assert(err == 0);
+
+  int32_t *count;
+  err = js_unwrap(env, receiver, (void **) &count);
+  if (err < 0) return NULL;
+
+  js_value_t *result;
+  err = js_create_int32(env, *count, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_counter_get_step(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  int err = js_create_int32(env, addon_step, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_counter_set_step(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  err = js_get_value_int32(env, argv[0], &addon_step);
+  assert(err == 0);
+
+  return NULL;
+}
+
+static const js_static_property_descriptor_t addon_counter_properties[] = {
+  JS_STATIC_METHOD("increment", addon_counter_increment, js_writable | js_configurable, &addon_step),
+  JS_STATIC_ACCESSOR("value", addon_counter_get_value, NULL, js_enumerable, NULL),
+  JS_STATIC_ACCESSOR("step", addon_counter_get_step, addon_counter_set_step, js_static, NULL),
+};
+
+static js_value_t *
+addon_hello(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  int err = js_create_string_utf8(env, (const utf8_t *) "Hello", -1, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static const js_static_property_descriptor_t addon_properties[] = {
+  JS_STATIC_METHOD("hello", addon_hello, js_enumerable, NULL),
+  JS_STATIC_ACCESSOR("step", addon_counter_get_step, NULL, js_enumerable, NULL),
+};
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  js_value_t *counter;
+  err = js_define_static_class(env, "Counter", -1, addon_counter_constructor, NULL, addon_counter_properties, sizeof(addon_counter_properties) / sizeof(addon_counter_properties[0]), &counter);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "Counter", counter);
+  assert(err == 0);
+
+  err = js_define_static_properties(env, exports, addon_properties, sizeof(addon_properties) / sizeof(addon_properties[0]));
+  assert(err == 0);
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
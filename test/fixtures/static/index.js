@@ -0,0 +1,54 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+const { Counter } = addon
+
+assert.strictEqual(Counter.name, 'Counter')
+
+const counter = new Counter(1)
+
+assert.ok(counter instanceof Counter)
+assert.strictEqual(counter.value, 1)
+
+counter.increment()
+counter.increment()
+
+assert.strictEqual(counter.value, 5)
+
+// Static properties are defined on the class, with instance properties on its
+// prototype.
+assert.strictEqual(Counter.step, 2)
+
+Counter.step = 10
+counter.increment()
+
+assert.strictEqual(counter.value, 15)
+assert.strictEqual(addon.step, 10)
+
+assert.deepStrictEqual(Object.keys(Counter.prototype), ['value'])
+assert.ok(Object.hasOwn(Counter, 'step'))
+
+const increment = Object.getOwnPropertyDescriptor(Counter.prototype, 'increment')
+
+assert.strictEqual(increment.writable, true)
+assert.strictEqual(increment.enumerable, false)
+assert.strictEqual(increment.configurable, true)
+
+// The attributes of the table are kept on objects as well.
+assert.strictEqual(addon.hello(), 'Hello')
+
+const hello = Object.getOwnPropertyDescriptor(addon, 'hello')
+
+assert.strictEqual(hello.writable, false)
+assert.strictEqual(hello.enumerable, true)
+assert.strictEqual(hello.configurable, false)
+
+assert.throws(() => {
+  'use strict'
+  addon.step = 0
+}, TypeError)
+
+console.log('Defined %s and %d properties from static tables', Counter.name, Object.keys(addon).length)
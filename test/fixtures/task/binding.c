@@ -0,0 +1,191 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <uv.h>
+
+static uv_once_t addon_guard = UV_ONCE_INIT;
+
+static uv_mutex_t addon_lock;
+
+// The number of tasks whose `complete` callback has yet to be called, across
+// all environments. Guarded by the lock.
+static int64_t addon_outstanding = 0;
+
+static void
+addon_on_init(void) {
+  int err = uv_mutex_init(&addon_lock);
+  assert(err == 0);
+}
+
+static int64_t
+addon_count_outstanding(int64_t delta) {
+  uv_mutex_lock(&addon_lock);
+
+  int64_t count = addon_outstanding += delta;
+
+  uv_mutex_unlock(&addon_lock);
+
+  return count;
+}
+
+typedef struct {
+  uint32_t n;
+  int64_t sum;
+} addon_sum_t;
+
+static void
+addon_sum_work(void *data) {
+  addon_sum_t *task = (addon_sum_t *) data;
+
+  for (uint32_t i = 0; i < task->n; i++) task->sum += i;
+}
+
+static js_value_t *
+addon_sum_complete(js_env_t *env, bool cancelled, void *data) {
+  addon_sum_t *task = (addon_sum_t *) data;
+
+  int64_t sum = task->sum;
+
+  free(task);
+
+  addon_count_outstanding(-1);
+
+  if (env == NULL || cancelled) return NULL;
+
+  js_value_t *result;
+  int err = js_create_int64(env, sum, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_sum(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  addon_sum_t *task = (addon_sum_t *) malloc(sizeof(addon_sum_t));
+  assert(task);
+
+  task->sum = 0;
+
+  err = js_get_value_uint32(env, argv[0], &task->n);
+  assert(err == 0);
+
+  addon_count_outstanding(1);
+
+  js_value_t *promise;
+  err = js_queue_task(env, addon_sum_work, addon_sum_complete, task, NULL, &promise);
+  assert(err == 0);
+
+  return promise;
+}
+
+static void
+addon_sleep_work(void *data) {
+  uv_sleep(*(uint32_t *) data);
+}
+
+static js_value_t *
+addon_sleep_complete(js_env_t *env, bool cancelled, void *data) {
+  free(data);
+
+  addon_count_outstanding(-1);
+
+  if (env == NULL) return NULL;
+
+  // Exceptions thrown while completing a cancelled task are discarded along
+  // with its result.
+  if (cancelled) {
+    js_throw_error(env, NULL, "Ignored");
+
+    return NULL;
+  }
+
+  js_value_t *result;
+  int err = js_get_undefined(env, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_sleep(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  uint32_t *timeout = (uint32_t *) malloc(sizeof(uint32_t));
+  assert(timeout);
+
+  err = js_get_value_uint32(env, argv[0], timeout);
+  assert(err == 0);
+
+  bool cancel;
+  err = js_get_value_bool(env, argv[1], &cancel);
+  assert(err == 0);
+
+  addon_count_outstanding(1);
+
+  js_task_t *task;
+  js_value_t *promise;
+  err = js_queue_task(env, addon_sleep_work, addon_sleep_complete, timeout, &task, &promise);
+  assert(err == 0);
+
+  if (cancel) {
+    err = js_cancel_task(env, task, NULL);
+    assert(err == 0);
+  }
+
+  return promise;
+}
+
+static js_value_t *
+addon_get_outstanding(js_env_t *env, js_callback_info_t *info) {
+  js_value_t *result;
+  int err = js_create_int64(env, addon_count_outstanding(0), &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  uv_once(&addon_guard, addon_on_init);
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("sum", addon_sum)
+  V("sleep", addon_sleep)
+  V("getOutstanding", addon_get_outstanding)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
@@ -0,0 +1,48 @@
+const assert = require('assert')
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads')
+
+const threads = Number(process.env.UV_THREADPOOL_SIZE) || 4
+
+if (isMainThread) {
+  const [filename] = process.argv.slice(2)
+
+  const addon = require(filename)
+
+  // Promises that are never settled let the process exit early, so only
+  // succeed once every assertion has run.
+  process.exitCode = 1
+
+  async function main() {
+    const results = await Promise.all(Array.from({ length: 100 }, (_, i) => addon.sum(i + 1)))
+
+    for (const [i, result] of results.entries()) assert.strictEqual(result, ((i + 1) * i) / 2)
+
+    // Tasks waiting for a thread can be cancelled, which rejects their promise.
+    const busy = Array.from({ length: threads }, () => addon.sleep(100, false))
+
+    await assert.rejects(addon.sleep(0, true), { code: 'ECANCELED' })
+
+    await Promise.all(busy)
+
+    // Terminating a worker completes the tasks still in flight in it.
+    const worker = new Worker(__filename, { workerData: { filename } })
+
+    await new Promise((resolve) => worker.on('message', resolve))
+
+    assert.strictEqual(await worker.terminate(), 1)
+
+    assert.strictEqual(addon.getOutstanding(), 0)
+
+    console.log('Settled %d tasks', results.length + busy.length + 1)
+
+    process.exitCode = 0
+  }
+
+  main()
+} else {
+  const addon = require(workerData.filename)
+
+  for (let i = 0; i < threads * 2; i++) addon.sleep(100, false)
+
+  parentPort.postMessage('sleeping')
+}
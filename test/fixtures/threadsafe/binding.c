@@ -0,0 +1,258 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <uv.h>
+
+#define ADDON_MAX_PRODUCERS 16
+
+// A small queue such that producers keep running into it being full.
+#define ADDON_QUEUE_LIMIT 16
+
+typedef struct {
+  js_threadsafe_function_t *function;
+  js_deferred_t *deferred;
+
+  uv_thread_t threads[ADDON_MAX_PRODUCERS];
+  uint32_t producers;
+  uint32_t calls;
+  bool blocking;
+
+  uv_mutex_t lock;
+
+  // Guarded by the lock, and all counting calls.
+  int64_t queued;
+  int64_t refused;
+  int64_t delivered;
+  int64_t dropped;
+  int64_t batches;
+
+  // The sums of the values passed by queued calls, and of those received.
+  int64_t sent;
+  int64_t received;
+
+  size_t wakeups;
+  size_t drained;
+} addon_run_t;
+
+static addon_run_t addon_run;
+
+static void
+addon_produce(void *data) {
+  addon_run_t *run = (addon_run_t *) data;
+
+  int err = 0;
+
+  for (uint32_t i = 0; i < run->calls && err == 0; i++) {
+    uint32_t *value = (uint32_t *) malloc(sizeof(uint32_t));
+    assert(value);
+
+    *value = i + 1;
+
+    // Nonblocking calls fail while the queue is full, so retry those. Blocking
+    // calls only fail once the function is closing.
+    do {
+      err = js_call_threadsafe_function(run->function, value, run->blocking ? js_threadsafe_function_blocking : js_threadsafe_function_nonblocking);
+
+      if (err != 0 && !run->blocking) uv_sleep(0);
+    } while (err != 0 && !run->blocking);
+
+    uv_mutex_lock(&run->lock);
+
+    if (err == 0) {
+      run->queued++;
+      run->sent += i + 1;
+    } else {
+      run->refused++;
+    }
+
+    uv_mutex_unlock(&run->lock);
+
+    // A failed call leaves the data with the caller.
+    if (err != 0) free(value);
+  }
+
+  // A call that failed as the function is closing already released the thread.
+  if (err == 0) {
+    err = js_release_threadsafe_function(run->function, js_threadsafe_function_release);
+    assert(err == 0);
+  }
+}
+
+static void
+addon_on_batch(js_env_t *env, js_value_t *function, void *context, void *const data[], size_t len) {
+  addon_run_t *run = (addon_run_t *) context;
+
+  uv_mutex_lock(&run->lock);
+
+  // Calls still queued once the function is gone are handed back without an
+  // environment.
+  if (env) {
+    run->delivered += len;
+    run->batches++;
+  } else {
+    run->dropped += len;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    run->received += *(uint32_t *) data[i];
+
+    free(data[i]);
+  }
+
+  uv_mutex_unlock(&run->lock);
+}
+
+static void
+addon_on_finalize(js_env_t *env, void *data, void *finalize_hint) {
+  addon_run_t *run = (addon_run_t *) data;
+
+  int err;
+
+  js_threadsafe_function_statistics_t stats = {0};
+  err = js_get_threadsafe_function_statistics(run->function, &stats);
+  assert(err == 0);
+
+  run->wakeups = stats.wakeups;
+  run->drained = stats.calls;
+
+  js_value_t *result;
+  err = js_get_undefined(env, &result);
+  assert(err == 0);
+
+  err = js_resolve_deferred(env, run->deferred, result);
+  assert(err == 0);
+}
+
+static js_value_t *
+addon_start(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 3;
+  js_value_t *argv[3];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 3);
+
+  addon_run_t *run = &addon_run;
+
+  run->queued = run->refused = run->delivered = run->dropped = run->batches = 0;
+  run->sent = run->received = 0;
+  run->wakeups = run->drained = 0;
+
+  err = js_get_value_uint32(env, argv[0], &run->producers);
+  assert(err == 0);
+
+  assert(run->producers <= ADDON_MAX_PRODUCERS);
+
+  err = js_get_value_uint32(env, argv[1], &run->calls);
+  assert(err == 0);
+
+  err = js_get_value_bool(env, argv[2], &run->blocking);
+  assert(err == 0);
+
+  js_value_t *promise;
+  err = js_create_promise(env, &run->deferred, &promise);
+  assert(err == 0);
+
+  // The JavaScript thread holds on to the function as well, until stopped.
+  err = js_create_batched_threadsafe_function(env, NULL, ADDON_QUEUE_LIMIT, run->producers + 1, addon_on_finalize, run, run, addon_on_batch, &run->function);
+  assert(err == 0);
+
+  for (uint32_t i = 0; i < run->producers; i++) {
+    err = uv_thread_create(&run->threads[i], addon_produce, run);
+    assert(err == 0);
+  }
+
+  return promise;
+}
+
+static js_value_t *
+addon_stop(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  bool abort;
+  err = js_get_value_bool(env, argv[0], &abort);
+  assert(err == 0);
+
+  err = js_release_threadsafe_function(addon_run.function, abort ? js_threadsafe_function_abort : js_threadsafe_function_release);
+  assert(err == 0);
+
+  return NULL;
+}
+
+static js_value_t *
+addon_join(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  addon_run_t *run = &addon_run;
+
+  for (uint32_t i = 0; i < run->producers; i++) {
+    err = uv_thread_join(&run->threads[i]);
+    assert(err == 0);
+  }
+
+  js_value_t *result;
+  err = js_create_object(env, &result);
+  assert(err == 0);
+
+#define V(name, value) \
+  { \
+    js_value_t *val; \
+    err = js_create_int64(env, (int64_t) (value), &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, result, name, val); \
+    assert(err == 0); \
+  }
+
+  V("queued", run->queued)
+  V("refused", run->refused)
+  V("delivered", run->delivered)
+  V("dropped", run->dropped)
+  V("batches", run->batches)
+  V("sent", run->sent)
+  V("received", run->received)
+  V("wakeups", run->wakeups)
+  V("drained", run->drained)
+#undef V
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  err = uv_mutex_init(&addon_run.lock);
+  assert(err == 0);
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("start", addon_start)
+  V("stop", addon_stop)
+  V("join", addon_join)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
@@ -0,0 +1,62 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+const producers = 8
+
+// Promises that are never settled let the process exit early, so only succeed
+// once every assertion has run.
+process.exitCode = 1
+
+async function run(calls, blocking, abort) {
+  const finalized = addon.start(producers, calls, blocking)
+
+  if (abort) await new Promise((resolve) => setTimeout(resolve, 10))
+
+  addon.stop(abort)
+
+  await finalized
+
+  // Calls still queued in Node-API are handed back right after finalizing.
+  await new Promise((resolve) => setImmediate(resolve))
+
+  const stats = addon.join()
+
+  // Every call that succeeded is delivered exactly once, and no call that
+  // failed ever is.
+  assert.strictEqual(stats.delivered + stats.dropped, stats.queued)
+  assert.strictEqual(stats.received, stats.sent)
+
+  assert.ok(stats.batches <= stats.delivered)
+  assert.ok(stats.wakeups >= stats.batches)
+  assert.strictEqual(stats.drained, stats.delivered)
+
+  return stats
+}
+
+async function main() {
+  const calls = 10000
+
+  for (const blocking of [true, false]) {
+    const stats = await run(calls, blocking, false)
+
+    assert.strictEqual(stats.queued, producers * calls)
+    assert.strictEqual(stats.refused, 0)
+    assert.strictEqual(stats.dropped, 0)
+    assert.strictEqual(stats.sent, (producers * calls * (calls + 1)) / 2)
+  }
+
+  // Aborting makes blocked producers give up, each failing a single call.
+  const stats = await run(1000000, true, true)
+
+  assert.ok(stats.refused > 0)
+  assert.ok(stats.refused <= producers)
+
+  console.log('Delivered %d calls in %d batches before aborting', stats.delivered, stats.batches)
+
+  process.exitCode = 0
+}
+
+main()
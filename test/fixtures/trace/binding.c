@@ -0,0 +1,98 @@
+#define JS_TRACE
+
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static js_value_t *
+addon_count(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 1;
+  js_value_t *argv[1];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 1);
+
+  uint32_t n;
+  err = js_get_value_uint32(env, argv[0], &n);
+  assert(err == 0);
+
+  js_value_t *result = NULL;
+
+  for (uint32_t i = 0; i < n; i++) {
+    err = js_create_uint32(env, i, &result);
+    assert(err == 0);
+  }
+
+  return result;
+}
+
+// Return what `js_dump_trace()` writes, without tracing any calls of its own
+// before doing so.
+static js_value_t *
+addon_dump(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  FILE *file = tmpfile();
+  assert(file);
+
+  err = js_dump_trace(file);
+  assert(err == 0);
+
+  long len = ftell(file);
+  assert(len > 0);
+
+  rewind(file);
+
+  char *dump = (char *) malloc((size_t) len);
+  assert(dump);
+
+  size_t read = fread(dump, 1, (size_t) len, file);
+  assert(read == (size_t) len);
+
+  fclose(file);
+
+  js_value_t *result;
+  err = js_create_string_utf8(env, (utf8_t *) dump, (size_t) len, &result);
+  assert(err == 0);
+
+  free(dump);
+
+  return result;
+}
+
+static js_value_t *
+addon_reset(js_env_t *env, js_callback_info_t *info) {
+  js_reset_trace();
+
+  return NULL;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+#define V(name, fn) \
+  { \
+    js_value_t *val; \
+    err = js_create_function(env, name, -1, fn, NULL, &val); \
+    assert(err == 0); \
+    err = js_set_named_property(env, exports, name, val); \
+    assert(err == 0); \
+  }
+
+  V("count", addon_count)
+  V("dump", addon_dump)
+  V("reset", addon_reset)
+#undef V
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
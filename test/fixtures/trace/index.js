@@ -0,0 +1,43 @@
+const assert = require('assert')
+
+const [filename] = process.argv.slice(2)
+
+const addon = require(filename)
+
+const dump = () => JSON.parse(addon.dump())
+
+// Setting up the exports is traced as well.
+assert.ok(dump().functions.some((fn) => fn.name === 'js_create_function' && fn.calls === 3))
+
+addon.reset()
+
+assert.deepStrictEqual(dump(), { functions: [] })
+
+assert.strictEqual(addon.count(100), 99)
+assert.strictEqual(addon.count(50), 49)
+
+const { functions } = dump()
+
+// Only functions called since the reset are listed, in the order they're
+// declared, including the string created for the previous dump.
+assert.deepStrictEqual(
+  functions.map((fn) => [fn.name, fn.calls]),
+  [
+    ['js_create_uint32', 150],
+    ['js_create_string_utf8', 1],
+    ['js_get_value_uint32', 2],
+    ['js_get_callback_info', 2]
+  ]
+)
+
+for (const fn of functions) {
+  assert.deepStrictEqual(Object.keys(fn), ['name', 'calls', 'total', 'mean', 'p50', 'p90', 'p99', 'p999', 'max'])
+
+  assert.strictEqual(fn.mean, Math.floor(fn.total / fn.calls))
+  assert.ok(fn.p50 <= fn.p90 && fn.p90 <= fn.p99 && fn.p99 <= fn.p999 && fn.p999 <= fn.max)
+
+  // The maximum is the upper bound of its bucket, so is at least the mean.
+  assert.ok(fn.max >= fn.mean)
+}
+
+console.log('Traced %d calls', functions.reduce((calls, fn) => calls + fn.calls, 0))
@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <bare.h>
+#include <js.h>
+#include <stdint.h>
+#include <uv.h>
+
+static uv_once_t addon_guard = UV_ONCE_INIT;
+
+static uv_mutex_t addon_lock;
+
+// Guarded by the lock, as environments load the addon from several threads.
+static int64_t addon_instances = 0;
+
+static void
+addon_on_init(void) {
+  int err = uv_mutex_init(&addon_lock);
+  assert(err == 0);
+}
+
+static js_value_t *
+addon_run(js_env_t *env, js_callback_info_t *info) {
+  int err;
+
+  size_t argc = 2;
+  js_value_t *argv[2];
+
+  err = js_get_callback_info(env, info, &argc, argv, NULL, NULL);
+  assert(err == 0);
+
+  assert(argc == 2);
+
+  uint32_t iterations;
+  err = js_get_value_uint32(env, argv[1], &iterations);
+  assert(err == 0);
+
+  js_property_key_statistics_t before = {0};
+  err = js_get_property_key_statistics(env, &before);
+  assert(err == 0);
+
+  int64_t sum = 0;
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    js_handle_scope_t *scope;
+    err = js_open_handle_scope(env, &scope);
+    assert(err == 0);
+
+    js_value_t *value;
+    err = js_get_named_property(env, argv[0], "value", &value);
+    assert(err == 0);
+
+    int32_t n;
+    err = js_get_value_int32(env, value, &n);
+    assert(err == 0);
+
+    sum += n;
+
+    err = js_close_handle_scope(env, scope);
+    assert(err == 0);
+  }
+
+  js_property_key_statistics_t after = {0};
+  err = js_get_property_key_statistics(env, &after);
+  assert(err == 0);
+
+  // The key cache is per environment, so its lookups only account for the
+  // calls made from this environment.
+  if (after.size) assert(after.hits + after.misses - before.hits - before.misses == iterations);
+
+  js_value_t *result;
+  err = js_create_int64(env, sum, &result);
+  assert(err == 0);
+
+  return result;
+}
+
+static js_value_t *
+addon_exports(js_env_t *env, js_value_t *exports) {
+  int err;
+
+  uv_once(&addon_guard, addon_on_init);
+
+  uv_mutex_lock(&addon_lock);
+
+  int64_t count = ++addon_instances;
+
+  uv_mutex_unlock(&addon_lock);
+
+  js_value_t *instance;
+  err = js_create_int64(env, count, &instance);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "instance", instance);
+  assert(err == 0);
+
+  js_value_t *run;
+  err = js_create_function(env, "run", -1, addon_run, NULL, &run);
+  assert(err == 0);
+
+  err = js_set_named_property(env, exports, "run", run);
+  assert(err == 0);
+
+  return exports;
+}
+
+BARE_MODULE(addon, addon_exports)
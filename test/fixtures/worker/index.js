@@ -0,0 +1,46 @@
+const assert = require('assert')
+const os = require('os')
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads')
+
+const iterations = 100000
+
+if (isMainThread) {
+  const [filename, concurrency = os.availableParallelism()] = process.argv.slice(2)
+
+  const addon = require(filename)
+
+  assert.strictEqual(addon.run({ value: 3 }, iterations), 3 * iterations)
+
+  const workers = []
+
+  for (let i = 0; i < concurrency; i++) {
+    workers.push(
+      new Promise((resolve, reject) => {
+        const worker = new Worker(__filename, { workerData: { filename, value: i } })
+
+        worker.on('message', resolve).on('error', reject)
+      })
+    )
+  }
+
+  Promise.all(workers).then((results) => {
+    const instances = new Set([addon.instance])
+
+    for (const [i, { instance, sum }] of results.entries()) {
+      assert.strictEqual(sum, i * iterations)
+
+      instances.add(instance)
+    }
+
+    // The module is initialized once per environment.
+    assert.strictEqual(instances.size, workers.length + 1)
+
+    console.log('Loaded in %d workers', workers.length)
+  })
+} else {
+  const { filename, value } = workerData
+
+  const addon = require(filename)
+
+  parentPort.postMessage({ instance: addon.instance, sum: addon.run({ value }, iterations) })
+}